@@ -13,18 +13,22 @@ REPAST_HPC_SRC += $(DIR)/AgentId.cpp
 		REPAST_HPC_SRC += $(DIR)/NCDataSetBuilder.cpp
 		REPAST_HPC_SRC += $(DIR)/NCDataSet.cpp
 		REPAST_HPC_SRC += $(DIR)/NetworkBuilder.cpp
+		REPAST_HPC_SRC += $(DIR)/Profiler.cpp
 		REPAST_HPC_SRC += $(DIR)/Properties.cpp
 		REPAST_HPC_SRC += $(DIR)/Random.cpp
+		REPAST_HPC_SRC += $(DIR)/RandomStream.cpp
 		REPAST_HPC_SRC += $(DIR)/RelativeLocation.cpp
 		REPAST_HPC_SRC += $(DIR)/RepastErrors.cpp
 		REPAST_HPC_SRC += $(DIR)/RepastProcess.cpp
 		REPAST_HPC_SRC += $(DIR)/Schedule.cpp
 		REPAST_HPC_SRC += $(DIR)/SharedBaseGrid.cpp
 		REPAST_HPC_SRC += $(DIR)/SharedContext.cpp
+		REPAST_HPC_SRC += $(DIR)/SpaceFillingCurve.cpp
 		REPAST_HPC_SRC += $(DIR)/spatial_math.cpp
 		REPAST_HPC_SRC += $(DIR)/SRManager.cpp
 		REPAST_HPC_SRC += $(DIR)/SVDataSetBuilder.cpp
 		REPAST_HPC_SRC += $(DIR)/SVDataSet.cpp
+		REPAST_HPC_SRC += $(DIR)/ThreadPool.cpp
 		REPAST_HPC_SRC += $(DIR)/Utilities.cpp
 		REPAST_HPC_SRC += $(DIR)/ValueLayer.cpp
 		REPAST_HPC_SRC += $(DIR)/ValueLayerND.cpp
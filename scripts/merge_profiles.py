@@ -0,0 +1,18 @@
+#!/usr/bin/env python
+
+import sys, json
+
+def run(output_file, input_files):
+    events = []
+    for f in input_files:
+        with open(f) as trace:
+            events.extend(json.load(trace)["traceEvents"])
+    events.sort(key=lambda e: (e["ts"], e["pid"], e["tid"]))
+    with open(output_file, "w") as out:
+        json.dump({"traceEvents": events}, out)
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        print("Usage: merge_profiles.py [output file] [rank trace file]...")
+    else:
+        run(sys.argv[1], sys.argv[2:])
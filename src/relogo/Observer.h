@@ -716,11 +716,10 @@ template<typename AgentType>
 void Observer::get(AgentSet<AgentType>& agentSet) {
   int typeId = getTypeId<AgentType> ();
 	if (typeId != NO_TYPE_ID) {
-		for (SharedContext<RelogoAgent>::const_local_iterator iter = context.localBegin(); iter != context.localEnd(); ++iter) {
-			AgentId id = iter->get()->getId();
-			if (id.agentType() == typeId) {
-				agentSet.add(static_cast<AgentType*> (iter->get()));
-			}
+		SharedContext<RelogoAgent>::const_state_aware_bytype_iterator end = context.byTypeEnd(SharedContext<RelogoAgent>::LOCAL, typeId);
+		for (SharedContext<RelogoAgent>::const_state_aware_bytype_iterator iter = context.byTypeBegin(SharedContext<RelogoAgent>::LOCAL, typeId);
+				iter != end; ++iter) {
+			agentSet.add(static_cast<AgentType*> (iter->get()));
 		}
 	}
 }
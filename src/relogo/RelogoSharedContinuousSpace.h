@@ -71,10 +71,10 @@ RelogoSharedContinuousSpace<GPTransformer, Adder>::RelogoSharedContinuousSpace(s
 
 template<typename GPTransformer, typename Adder>
 void RelogoSharedContinuousSpace<GPTransformer, Adder>::synchMoveTo(const repast::AgentId& id, const repast::Point<double>& pt) {
-	RelogoAgent* agent = repast::SharedBaseGrid<RelogoAgent, GPTransformer, Adder, double>::GridBaseType::get(id);
+	RelogoAgent* agent = repast::SharedContinuousSpace<RelogoAgent, GPTransformer, Adder>::GridBaseType::get(id);
 	if (agent != 0) {
 		agent->_location = pt;
-		repast::SharedBaseGrid<RelogoAgent, GPTransformer, Adder, double>::GridBaseType::moveTo(id, pt.coords());
+		repast::SharedContinuousSpace<RelogoAgent, GPTransformer, Adder>::GridBaseType::moveTo(id, pt.coords());
 	}
 }
 
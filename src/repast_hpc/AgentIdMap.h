@@ -0,0 +1,515 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  AgentIdMap.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: jtm
+ */
+
+#ifndef AGENTIDMAP_H_
+#define AGENTIDMAP_H_
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include <boost/cstdint.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/type_traits/is_convertible.hpp>
+#include <boost/utility/enable_if.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "AgentId.h"
+
+namespace repast {
+
+template<typename V>
+class AgentIdMap;
+
+/**
+ * Iterator over the entries of an AgentIdMap.
+ */
+template<typename Value>
+class AgentIdMapIterator: public boost::iterator_facade<AgentIdMapIterator<Value>, Value, boost::forward_traversal_tag> {
+
+private:
+	struct enabler {
+	};
+
+	friend class boost::iterator_core_access;
+	template<typename > friend class AgentIdMapIterator;
+	template<typename > friend class AgentIdMap;
+
+	const signed char* ctrl;
+	const signed char* ctrlEnd;
+	Value* slot;
+
+	AgentIdMapIterator(const signed char* control, const signed char* controlEnd, Value* slotPtr) :
+			ctrl(control), ctrlEnd(controlEnd), slot(slotPtr) {
+		skipEmpty();
+	}
+
+	void skipEmpty() {
+		while (ctrl != ctrlEnd && *ctrl < 0) {
+			++ctrl;
+			++slot;
+		}
+	}
+
+	void increment() {
+		++ctrl;
+		++slot;
+		skipEmpty();
+	}
+
+	template<typename OtherValue>
+	bool equal(const AgentIdMapIterator<OtherValue>& other) const {
+		return slot == other.slot;
+	}
+
+	Value& dereference() const {
+		return *slot;
+	}
+
+public:
+	AgentIdMapIterator() :
+			ctrl(0), ctrlEnd(0), slot(0) {
+	}
+
+	template<typename OtherValue>
+	AgentIdMapIterator(const AgentIdMapIterator<OtherValue>& other,
+			typename boost::enable_if<boost::is_convertible<OtherValue*, Value*>, enabler>::type = enabler()) :
+			ctrl(other.ctrl), ctrlEnd(other.ctrlEnd), slot(other.slot) {
+	}
+};
+
+/**
+ * Hash map keyed by AgentId, for the agent lookups made by contexts and
+ * projections. Unlike boost::unordered_map, which allocates a node for every
+ * entry, this keeps its entries in a single array and resolves collisions by
+ * open addressing: a parallel array holds one control byte per entry, either
+ * a 7 bit fragment of the key's hash or a marker for an empty or erased entry,
+ * and a lookup compares the fragments of 16 entries at a time (with SSE2 where
+ * available) before comparing any keys. The hash is derived from the hashcode
+ * that an AgentId computes when it is created.
+ *
+ * The interface is the subset of boost::unordered_map used in Repast HPC.
+ * As with unordered_map, erasing an entry invalidates only the iterators to
+ * that entry, and inserting may invalidate all iterators. Unlike unordered_map,
+ * inserting may also move the entries, so references and pointers to entries
+ * are invalidated along with the iterators. Iteration is in storage order.
+ *
+ * @tparam V the type of the mapped values
+ */
+template<typename V>
+class AgentIdMap {
+
+public:
+	typedef AgentId key_type;
+	typedef V mapped_type;
+	typedef std::pair<const AgentId, V> value_type;
+	typedef size_t size_type;
+	typedef AgentIdMapIterator<value_type> iterator;
+	typedef AgentIdMapIterator<const value_type> const_iterator;
+
+private:
+	static const size_t GROUP_SIZE = 16;
+	static const signed char EMPTY = -128;
+	static const signed char DELETED = -2;
+	static const signed char SENTINEL = -1;
+
+	signed char* ctrl;
+	value_type* slots;
+	size_t capacity_, size_, deleted_;
+
+	static boost::uint64_t hashOf(const AgentId& id) {
+		// splitmix64 finalizer, as AgentId's own hashcode is weak in the low bits
+		boost::uint64_t z = (boost::uint64_t) id.hashcode() + 0x9E3779B97F4A7C15ULL;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	static size_t maxLoad(size_t capacity) {
+		return capacity <= GROUP_SIZE ? capacity : capacity - capacity / 8;
+	}
+
+	size_t groupCount() const {
+		return capacity_ <= GROUP_SIZE ? 1 : capacity_ / GROUP_SIZE;
+	}
+
+	static unsigned int matchByte(const signed char* group, signed char value);
+	static unsigned int matchEmpty(const signed char* group);
+	static unsigned int matchEmptyOrDeleted(const signed char* group);
+
+	size_t findIndex(const AgentId& id, boost::uint64_t hash) const;
+	// claims an entry for the hash; sets *claimedDeleted, if given, to whether the entry was DELETED
+	size_t insertIndex(boost::uint64_t hash, bool* claimedDeleted = 0);
+	void prepareInsert();
+	void rehash(size_t newCapacity);
+	void eraseIndex(size_t index);
+	void destroyAll();
+
+public:
+	AgentIdMap();
+	AgentIdMap(const AgentIdMap& other);
+	~AgentIdMap();
+
+	AgentIdMap& operator=(const AgentIdMap& other);
+
+	iterator begin() {
+		return iterator(ctrl, ctrl + capacity_, slots);
+	}
+
+	iterator end() {
+		return iterator(ctrl + capacity_, ctrl + capacity_, slots + capacity_);
+	}
+
+	const_iterator begin() const {
+		return const_iterator(ctrl, ctrl + capacity_, slots);
+	}
+
+	const_iterator end() const {
+		return const_iterator(ctrl + capacity_, ctrl + capacity_, slots + capacity_);
+	}
+
+	size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	iterator find(const AgentId& id);
+	const_iterator find(const AgentId& id) const;
+
+	size_t count(const AgentId& id) const {
+		return find(id) == end() ? 0 : 1;
+	}
+
+	/**
+	 * Gets the value for the id, inserting a default constructed
+	 * value if the id is not present.
+	 */
+	V& operator[](const AgentId& id);
+
+	/**
+	 * Inserts the entry if its id is not present.
+	 *
+	 * @return an iterator to the entry with the id and whether
+	 * it was inserted
+	 */
+	std::pair<iterator, bool> insert(const value_type& value);
+
+	/**
+	 * Erases the entry at the iterator.
+	 *
+	 * @return an iterator to the next entry
+	 */
+	iterator erase(const_iterator pos);
+
+	/**
+	 * Erases the entry with the id, if any.
+	 *
+	 * @return the number of entries erased
+	 */
+	size_t erase(const AgentId& id);
+
+	/**
+	 * Erases all the entries, keeping the storage.
+	 */
+	void clear();
+
+	void swap(AgentIdMap& other);
+};
+
+template<typename V>
+const size_t AgentIdMap<V>::GROUP_SIZE;
+template<typename V>
+const signed char AgentIdMap<V>::EMPTY;
+template<typename V>
+const signed char AgentIdMap<V>::DELETED;
+template<typename V>
+const signed char AgentIdMap<V>::SENTINEL;
+
+template<typename V>
+AgentIdMap<V>::AgentIdMap() :
+		ctrl(0), slots(0), capacity_(0), size_(0), deleted_(0) {
+}
+
+template<typename V>
+AgentIdMap<V>::AgentIdMap(const AgentIdMap& other) :
+		ctrl(0), slots(0), capacity_(0), size_(0), deleted_(0) {
+	for (const_iterator iter = other.begin(); iter != other.end(); ++iter)
+		insert(*iter);
+}
+
+template<typename V>
+AgentIdMap<V>::~AgentIdMap() {
+	destroyAll();
+	delete[] ctrl;
+	::operator delete(slots);
+}
+
+template<typename V>
+AgentIdMap<V>& AgentIdMap<V>::operator=(const AgentIdMap& other) {
+	if (this != &other) {
+		AgentIdMap<V> copy(other);
+		swap(copy);
+	}
+	return *this;
+}
+
+template<typename V>
+void AgentIdMap<V>::swap(AgentIdMap& other) {
+	std::swap(ctrl, other.ctrl);
+	std::swap(slots, other.slots);
+	std::swap(capacity_, other.capacity_);
+	std::swap(size_, other.size_);
+	std::swap(deleted_, other.deleted_);
+}
+
+#ifdef __SSE2__
+
+template<typename V>
+unsigned int AgentIdMap<V>::matchByte(const signed char* group, signed char value) {
+	__m128i ctrlBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+	return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(value), ctrlBytes));
+}
+
+template<typename V>
+unsigned int AgentIdMap<V>::matchEmpty(const signed char* group) {
+	return matchByte(group, EMPTY);
+}
+
+template<typename V>
+unsigned int AgentIdMap<V>::matchEmptyOrDeleted(const signed char* group) {
+	__m128i ctrlBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+	return (unsigned int) _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(SENTINEL), ctrlBytes));
+}
+
+#else
+
+template<typename V>
+unsigned int AgentIdMap<V>::matchByte(const signed char* group, signed char value) {
+	unsigned int mask = 0;
+	for (size_t i = 0; i < GROUP_SIZE; i++)
+		if (group[i] == value) mask |= 1u << i;
+	return mask;
+}
+
+template<typename V>
+unsigned int AgentIdMap<V>::matchEmpty(const signed char* group) {
+	return matchByte(group, EMPTY);
+}
+
+template<typename V>
+unsigned int AgentIdMap<V>::matchEmptyOrDeleted(const signed char* group) {
+	unsigned int mask = 0;
+	for (size_t i = 0; i < GROUP_SIZE; i++)
+		if (group[i] < SENTINEL) mask |= 1u << i;
+	return mask;
+}
+
+#endif
+
+template<typename V>
+size_t AgentIdMap<V>::findIndex(const AgentId& id, boost::uint64_t hash) const {
+	if (size_ == 0) return capacity_;
+	size_t groups = groupCount();
+	size_t group = (size_t) (hash >> 7) & (groups - 1);
+	signed char fragment = (signed char) (hash & 0x7F);
+	for (size_t probe = 1; probe <= groups; probe++) {
+		const signed char* groupCtrl = ctrl + group * GROUP_SIZE;
+		unsigned int matches = matchByte(groupCtrl, fragment);
+		while (matches != 0) {
+			size_t index = group * GROUP_SIZE + __builtin_ctz(matches);
+			if (slots[index].first == id) return index;
+			matches &= matches - 1;
+		}
+		if (matchEmpty(groupCtrl) != 0) break;
+		group = (group + probe) & (groups - 1);
+	}
+	return capacity_;
+}
+
+template<typename V>
+size_t AgentIdMap<V>::insertIndex(boost::uint64_t hash, bool* claimedDeleted) {
+	size_t groups = groupCount();
+	size_t group = (size_t) (hash >> 7) & (groups - 1);
+	for (size_t probe = 1;; probe++) {
+		unsigned int available = matchEmptyOrDeleted(ctrl + group * GROUP_SIZE);
+		if (available != 0) {
+			size_t index = group * GROUP_SIZE + __builtin_ctz(available);
+			bool wasDeleted = (ctrl[index] == DELETED);
+			if (wasDeleted) deleted_--;
+			if (claimedDeleted != 0) *claimedDeleted = wasDeleted;
+			ctrl[index] = (signed char) (hash & 0x7F);
+			size_++;
+			return index;
+		}
+		group = (group + probe) & (groups - 1);
+	}
+}
+
+template<typename V>
+void AgentIdMap<V>::prepareInsert() {
+	if (size_ + deleted_ + 1 <= maxLoad(capacity_)) return;
+	if (capacity_ == 0) rehash(4);
+	// if erased entries take up most of the room, clearing them is enough
+	else if (size_ + 1 <= maxLoad(capacity_) / 2) rehash(capacity_);
+	else rehash(capacity_ * 2);
+}
+
+template<typename V>
+void AgentIdMap<V>::rehash(size_t newCapacity) {
+	signed char* oldCtrl = ctrl;
+	value_type* oldSlots = slots;
+	size_t oldCapacity = capacity_;
+
+	size_t ctrlSize = newCapacity < GROUP_SIZE ? GROUP_SIZE : newCapacity;
+	ctrl = new signed char[ctrlSize];
+	std::memset(ctrl, EMPTY, newCapacity);
+	std::memset(ctrl + newCapacity, SENTINEL, ctrlSize - newCapacity);
+	slots = static_cast<value_type*>(::operator new(newCapacity * sizeof(value_type)));
+	capacity_ = newCapacity;
+	size_ = 0;
+	deleted_ = 0;
+
+	for (size_t i = 0; i < oldCapacity; i++) {
+		if (oldCtrl[i] >= 0) {
+			size_t index = insertIndex(hashOf(oldSlots[i].first));
+			new (slots + index) value_type(std::move(oldSlots[i]));
+			oldSlots[i].~value_type();
+		}
+	}
+	delete[] oldCtrl;
+	::operator delete(oldSlots);
+}
+
+template<typename V>
+void AgentIdMap<V>::eraseIndex(size_t index) {
+	slots[index].~value_type();
+	size_--;
+	// An entry can be marked empty, ending probes, only if no probe has passed
+	// its group; a group that has an empty entry has never been full, so no probe
+	// has passed it. Otherwise it is marked deleted.
+	size_t group = groupCount() == 1 ? 0 : index / GROUP_SIZE;
+	if (groupCount() == 1 || matchEmpty(ctrl + group * GROUP_SIZE) != 0) {
+		ctrl[index] = EMPTY;
+	} else {
+		ctrl[index] = DELETED;
+		deleted_++;
+	}
+}
+
+template<typename V>
+void AgentIdMap<V>::destroyAll() {
+	for (size_t i = 0; i < capacity_; i++) {
+		if (ctrl[i] >= 0) slots[i].~value_type();
+	}
+}
+
+template<typename V>
+typename AgentIdMap<V>::iterator AgentIdMap<V>::find(const AgentId& id) {
+	size_t index = findIndex(id, hashOf(id));
+	return iterator(ctrl + index, ctrl + capacity_, slots + index);
+}
+
+template<typename V>
+typename AgentIdMap<V>::const_iterator AgentIdMap<V>::find(const AgentId& id) const {
+	size_t index = findIndex(id, hashOf(id));
+	return const_iterator(ctrl + index, ctrl + capacity_, slots + index);
+}
+
+template<typename V>
+V& AgentIdMap<V>::operator[](const AgentId& id) {
+	return insert(value_type(id, V())).first->second;
+}
+
+template<typename V>
+std::pair<typename AgentIdMap<V>::iterator, bool> AgentIdMap<V>::insert(const value_type& value) {
+	boost::uint64_t hash = hashOf(value.first);
+	size_t index = findIndex(value.first, hash);
+	if (index != capacity_) return std::make_pair(iterator(ctrl + index, ctrl + capacity_, slots + index), false);
+
+	prepareInsert();
+	bool claimedDeleted;
+	index = insertIndex(hash, &claimedDeleted);
+	try {
+		new (slots + index) value_type(value);
+	} catch (...) {
+		// a DELETED entry must stay so, since probes may have passed its group
+		if (claimedDeleted) {
+			ctrl[index] = DELETED;
+			deleted_++;
+		} else {
+			ctrl[index] = EMPTY;
+		}
+		size_--;
+		throw;
+	}
+	return std::make_pair(iterator(ctrl + index, ctrl + capacity_, slots + index), true);
+}
+
+template<typename V>
+typename AgentIdMap<V>::iterator AgentIdMap<V>::erase(const_iterator pos) {
+	size_t index = pos.slot - slots;
+	eraseIndex(index);
+	return iterator(ctrl + index + 1, ctrl + capacity_, slots + index + 1);
+}
+
+template<typename V>
+size_t AgentIdMap<V>::erase(const AgentId& id) {
+	size_t index = findIndex(id, hashOf(id));
+	if (index == capacity_) return 0;
+	eraseIndex(index);
+	return 1;
+}
+
+template<typename V>
+void AgentIdMap<V>::clear() {
+	destroyAll();
+	if (capacity_ > 0) std::memset(ctrl, EMPTY, capacity_);
+	size_ = 0;
+	deleted_ = 0;
+}
+
+}
+
+#endif /* AGENTIDMAP_H_ */
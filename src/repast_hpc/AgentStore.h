@@ -0,0 +1,390 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  AgentStore.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: jtm
+ */
+
+#ifndef AGENTSTORE_H_
+#define AGENTSTORE_H_
+
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#include <boost/noncopyable.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+
+namespace repast {
+
+/**
+ * Allocates agents of a single concrete type from large slabs of contiguous
+ * memory rather than individually from the heap. The address of an agent
+ * does not change while it exists, and the slot of a destroyed agent is
+ * reused by the next agent created. Iterating over an AgentStore visits its
+ * agents in memory order, which is much kinder to the cache than iterating
+ * over a Context when the agents are small and numerous.
+ *
+ * Agents created by a store are added to a Context with
+ * Context::addAgent(agent, store); the context then returns them to the
+ * store, instead of deleting them, when they are removed. The reference
+ * count that the context's shared_ptr needs for each agent is also allocated
+ * from the store, so adding a stored agent to a context makes no heap
+ * allocation of its own. The context keeps a single reference to the store
+ * and releases it only after its own agents and projections, so the store
+ * outlives the agents it has in the context; shared_ptrs to stored agents
+ * must not be kept after the context is destroyed.
+ *
+ * An AgentStore is not thread safe.
+ *
+ * @tparam A the concrete agent type
+ */
+template<typename A>
+class AgentStore: public boost::noncopyable {
+
+private:
+	typedef typename std::aligned_storage<sizeof(A), std::alignment_of<A>::value>::type Slot;
+	static const size_t BLOCK_ALIGNMENT = 16;
+
+	struct Slab {
+		Slot* slots;
+		std::vector<bool> live;
+	};
+
+	size_t slabSize;
+	size_t count;
+	std::vector<Slab> slabs;
+	std::map<const char*, size_t> slabIndex;
+	std::vector<Slot*> freeSlots;
+
+	// raw memory for fixed size blocks, such as shared_ptr reference counts
+	std::vector<char*> blockChunks;
+	size_t chunkUsed, chunkCapacity;
+	std::map<size_t, std::vector<void*> > freeBlocks;
+
+	void addSlab();
+	std::pair<size_t, size_t> locate(const A* agent) const;
+
+public:
+
+	/**
+	 * Iterates over the agents in a store in memory order. Dereferences
+	 * into A*.
+	 */
+	class const_iterator: public boost::iterator_facade<const_iterator, A*, boost::forward_traversal_tag, A*> {
+
+	private:
+		friend class boost::iterator_core_access;
+		friend class AgentStore;
+
+		const AgentStore* store;
+		size_t slab;
+		size_t slot;
+
+		const_iterator(const AgentStore* agentStore, size_t slabIdx, size_t slotIdx) :
+				store(agentStore), slab(slabIdx), slot(slotIdx) {
+			skipFree();
+		}
+
+		void skipFree() {
+			while (slab < store->slabs.size() && !store->slabs[slab].live[slot]) {
+				if (++slot == store->slabSize) {
+					slot = 0;
+					slab++;
+				}
+			}
+		}
+
+		void increment() {
+			if (++slot == store->slabSize) {
+				slot = 0;
+				slab++;
+			}
+			skipFree();
+		}
+
+		bool equal(const const_iterator& other) const {
+			return slab == other.slab && slot == other.slot;
+		}
+
+		A* dereference() const {
+			return reinterpret_cast<A*>(store->slabs[slab].slots + slot);
+		}
+
+	public:
+		const_iterator() :
+				store(0), slab(0), slot(0) {
+		}
+	};
+
+	/**
+	 * Creates an AgentStore.
+	 *
+	 * @param agentsPerSlab the number of agents in each slab of memory
+	 */
+	AgentStore(size_t agentsPerSlab = 4096);
+
+	/**
+	 * Destroys this store and any agents still in it.
+	 */
+	~AgentStore();
+
+	/**
+	 * Creates an agent in this store, passing the arguments to its
+	 * constructor.
+	 *
+	 * @return the new agent
+	 */
+	template<typename ... Args>
+	A* create(Args&&... args);
+
+	/**
+	 * Destroys an agent created by this store. This must not be used for
+	 * agents that have been added to a Context, which returns them to the
+	 * store itself.
+	 *
+	 * @param agent the agent to destroy
+	 */
+	void destroy(A* agent);
+
+	/**
+	 * Gets the number of agents in this store.
+	 */
+	size_t size() const {
+		return count;
+	}
+
+	/**
+	 * Gets the number of agents that this store can hold without
+	 * allocating another slab.
+	 */
+	size_t capacity() const {
+		return slabs.size() * slabSize;
+	}
+
+	const_iterator begin() const {
+		return const_iterator(this, 0, 0);
+	}
+
+	const_iterator end() const {
+		return const_iterator(this, slabs.size(), 0);
+	}
+
+	/**
+	 * Allocates a block of raw memory of the specified size from this store.
+	 * Blocks are meant for small, fixed size bookkeeping such as reference counts
+	 * and are recycled by size.
+	 */
+	void* allocateBlock(size_t size);
+
+	/**
+	 * Returns a block allocated with allocateBlock to this store.
+	 */
+	void deallocateBlock(void* block, size_t size);
+};
+
+template<typename A>
+AgentStore<A>::AgentStore(size_t agentsPerSlab) :
+		slabSize(agentsPerSlab == 0 ? 1 : agentsPerSlab), count(0), chunkUsed(0), chunkCapacity(0) {
+}
+
+template<typename A>
+AgentStore<A>::~AgentStore() {
+	for (size_t i = 0; i < slabs.size(); i++) {
+		for (size_t j = 0; j < slabSize; j++) {
+			if (slabs[i].live[j]) reinterpret_cast<A*>(slabs[i].slots + j)->~A();
+		}
+		delete[] slabs[i].slots;
+	}
+	for (size_t i = 0; i < blockChunks.size(); i++)
+		::operator delete[](blockChunks[i]);
+}
+
+template<typename A>
+void AgentStore<A>::addSlab() {
+	Slab slab;
+	slab.slots = new Slot[slabSize];
+	slab.live.assign(slabSize, false);
+	slabIndex[reinterpret_cast<const char*>(slab.slots)] = slabs.size();
+	slabs.push_back(slab);
+	// reversed so that agents are created in memory order
+	for (size_t i = slabSize; i > 0; i--)
+		freeSlots.push_back(slab.slots + i - 1);
+}
+
+template<typename A>
+std::pair<size_t, size_t> AgentStore<A>::locate(const A* agent) const {
+	const char* address = reinterpret_cast<const char*>(agent);
+	typename std::map<const char*, size_t>::const_iterator iter = slabIndex.upper_bound(address);
+	--iter;
+	size_t slab = iter->second;
+	return std::make_pair(slab, (size_t) (reinterpret_cast<const Slot*>(agent) - slabs[slab].slots));
+}
+
+template<typename A>
+template<typename ... Args>
+A* AgentStore<A>::create(Args&&... args) {
+	if (freeSlots.empty()) addSlab();
+	Slot* slot = freeSlots.back();
+	A* agent = new (slot) A(std::forward<Args>(args)...);
+	freeSlots.pop_back();
+	std::pair<size_t, size_t> location = locate(agent);
+	slabs[location.first].live[location.second] = true;
+	count++;
+	return agent;
+}
+
+template<typename A>
+void AgentStore<A>::destroy(A* agent) {
+	std::pair<size_t, size_t> location = locate(agent);
+	slabs[location.first].live[location.second] = false;
+	agent->~A();
+	freeSlots.push_back(reinterpret_cast<Slot*>(agent));
+	count--;
+}
+
+template<typename A>
+void* AgentStore<A>::allocateBlock(size_t size) {
+	size = (size + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+	std::vector<void*>& blocks = freeBlocks[size];
+	if (!blocks.empty()) {
+		void* block = blocks.back();
+		blocks.pop_back();
+		return block;
+	}
+
+	if (chunkUsed + size > chunkCapacity) {
+		// operator new[] memory is suitably aligned for any fundamental type
+		chunkCapacity = size * slabSize;
+		blockChunks.push_back(static_cast<char*>(::operator new[](chunkCapacity)));
+		chunkUsed = 0;
+	}
+	void* block = blockChunks.back() + chunkUsed;
+	chunkUsed += size;
+	return block;
+}
+
+template<typename A>
+void AgentStore<A>::deallocateBlock(void* block, size_t size) {
+	size = (size + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+	freeBlocks[size].push_back(block);
+}
+
+/**
+ * shared_ptr deleter that returns agents to the AgentStore that created them.
+ */
+template<typename A>
+struct AgentStoreDeleter {
+	AgentStore<A>* store;
+
+	AgentStoreDeleter(AgentStore<A>* agentStore) :
+			store(agentStore) {
+	}
+
+	template<typename T>
+	void operator()(T* agent) const {
+		store->destroy(static_cast<A*>(agent));
+	}
+};
+
+/**
+ * Allocator that allocates from an AgentStore's blocks, used for the
+ * reference counts of the shared_ptrs to stored agents.
+ */
+template<typename U, typename A>
+struct AgentStoreAllocator {
+	typedef U value_type;
+	typedef U* pointer;
+	typedef const U* const_pointer;
+	typedef U& reference;
+	typedef const U& const_reference;
+	typedef size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template<typename V>
+	struct rebind {
+		typedef AgentStoreAllocator<V, A> other;
+	};
+
+	AgentStore<A>* store;
+
+	AgentStoreAllocator(AgentStore<A>* agentStore) :
+			store(agentStore) {
+	}
+
+	template<typename V>
+	AgentStoreAllocator(const AgentStoreAllocator<V, A>& other) :
+			store(other.store) {
+	}
+
+	U* allocate(size_t n, const void* = 0) {
+		return static_cast<U*>(store->allocateBlock(n * sizeof(U)));
+	}
+
+	void deallocate(U* p, size_t n) {
+		store->deallocateBlock(p, n * sizeof(U));
+	}
+
+	size_t max_size() const {
+		return size_t(-1) / sizeof(U);
+	}
+
+	template<typename V, typename ... Args>
+	void construct(V* p, Args&&... args) {
+		new (p) V(std::forward<Args>(args)...);
+	}
+
+	template<typename V>
+	void destroy(V* p) {
+		p->~V();
+	}
+
+	template<typename V>
+	bool operator==(const AgentStoreAllocator<V, A>& other) const {
+		return store == other.store;
+	}
+
+	template<typename V>
+	bool operator!=(const AgentStoreAllocator<V, A>& other) const {
+		return store != other.store;
+	}
+};
+
+}
+
+#endif /* AGENTSTORE_H_ */
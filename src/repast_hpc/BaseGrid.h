@@ -51,6 +51,7 @@
 #include <boost/iterator.hpp>
 #include <boost/iterator/transform_iterator.hpp>
 
+#include "AgentIdMap.h"
 #include "Grid.h"
 #include "spatial_math.h"
 #include "RepastErrors.h"
@@ -77,10 +78,9 @@ struct GridPointHolder {
  *  to return the agent maps values.
  */
 template<typename T, typename GPType>
-struct AgentFromGridPoint: public std::unary_function<typename boost::unordered_map<AgentId,
-		GridPointHolder<T, GPType>*>::value_type, boost::shared_ptr<T> > {
-	boost::shared_ptr<T> operator()(
-			const typename boost::unordered_map<AgentId, GridPointHolder<T, GPType>*>::value_type& value) const {
+struct AgentFromGridPoint: public std::unary_function<typename AgentIdMap<GridPointHolder<T, GPType>*>::value_type,
+		boost::shared_ptr<T> > {
+	boost::shared_ptr<T> operator()(const typename AgentIdMap<GridPointHolder<T, GPType>*>::value_type& value) const {
 		GridPointHolder<T, GPType> *gp = value.second;
 		return gp->ptr;
 	}
@@ -108,7 +108,7 @@ private:
 	// we use a GridPointHolder so we can swap out the GridPoint for an
 	// agent with a single map access, rather than have to put the new
 	// GridPoint back in the map.
-	typedef typename boost::unordered_map<AgentId, GridPointHolder<T, GPType>*, HashId> AgentLocationMap;
+	typedef AgentIdMap<GridPointHolder<T, GPType>*> AgentLocationMap;
 
 	AgentLocationMap agentToLocation;
 	GridDimensions dimensions_;
@@ -139,6 +139,25 @@ protected:
 
 	T* get(const AgentId& id);
 
+	/**
+	 * Sets the bounds of the region whose cells the cell accessor should
+	 * hold; by default these are the dimensions of this BaseGrid.
+	 */
+	void initCells(const GridDimensions& bounds) {
+		cellAccessor.init(bounds);
+	}
+
+	/**
+	 * Gets the cell accessor that stores the cells of this BaseGrid.
+	 */
+	CellAccessor& cells() {
+		return cellAccessor;
+	}
+
+	const CellAccessor& cells() const {
+		return cellAccessor;
+	}
+
 public:
 
 	/**
@@ -292,6 +311,7 @@ BaseGrid<T, CellAccessor, GPTransformer, Adder, GPType>::BaseGrid(std::string na
 	Grid<T, GPType> (name), gpTransformer(dimensions), dimensions_(dimensions), size_(0) {
 //	gpTransformer.init(dimensions);
 	adder.init(dimensions, this);
+	cellAccessor.init(dimensions);
 }
 
 template<typename T, typename CellAccessor, typename GPTransformer, typename Adder, typename GPType>
@@ -38,6 +38,8 @@
  *      Author: jtm
  */
 
+#include <cmath>
+
 #include "CartesianTopology.h"
 
 
@@ -47,8 +49,12 @@ namespace repast {
 
 
 CartesianTopology::CartesianTopology(vector<int> processesPerDim, bool spaceIsPeriodic, boost::mpi::communicator* comm) :
-  periodic(spaceIsPeriodic), procsPerDim(processesPerDim) {
+  periodic(spaceIsPeriodic), procsPerDim(processesPerDim), wholeUnitCuts(false) {
   int numDims = procsPerDim.size();
+  cuts.resize(numDims);
+  for (int i = 0; i < numDims; i++){
+    for (int j = 0; j <= procsPerDim[i]; j++) cuts[i].push_back((double)j / (double)procsPerDim[i]);
+  }
   int* periods = new int[numDims];
   int periodicFlag = periodic ? 1 : 0;
   for (int i = 0; i < numDims; i++) periods[i] = periodicFlag;
@@ -93,8 +99,8 @@ GridDimensions CartesianTopology::getDimensions(int rank, GridDimensions globalB
 GridDimensions CartesianTopology::getDimensions(vector<int>& pCoordinates, GridDimensions globalBoundaries) {
   vector<double> origins, extents;
   for (size_t i = 0; i < pCoordinates.size(); i++) {
-    double lower = globalBoundaries.origin(i) + ( (double)pCoordinates[i]      / (double)procsPerDim[i]) * globalBoundaries.extents(i);
-    double upper = globalBoundaries.origin(i) + (((double)pCoordinates[i] + 1 )/ (double)procsPerDim[i]) * globalBoundaries.extents(i);
+    double lower = cutPosition(i, pCoordinates[i],     globalBoundaries);
+    double upper = cutPosition(i, pCoordinates[i] + 1, globalBoundaries);
     origins.push_back(lower);
     extents.push_back(upper - lower);
   }
@@ -102,6 +108,100 @@ GridDimensions CartesianTopology::getDimensions(vector<int>& pCoordinates, GridD
   return GridDimensions(Point<double> (origins), Point<double> (extents));
 }
 
+double CartesianTopology::cutPosition(int dimension, int index, GridDimensions& globalBoundaries){
+  double offset = cuts[dimension][index] * globalBoundaries.extents(dimension);
+  if(wholeUnitCuts && index > 0 && index < procsPerDim[dimension]) offset = floor(offset + 0.5);
+  return globalBoundaries.origin(dimension) + offset;
+}
+
+int CartesianTopology::getRankContaining(const std::vector<double>& pt, GridDimensions globalBoundaries){
+  int numDims = procsPerDim.size();
+  std::vector<int> coords(numDims, 0);
+  for(int i = 0; i < numDims; i++){
+    while(coords[i] < procsPerDim[i] - 1 && cutPosition(i, coords[i] + 1, globalBoundaries) <= pt[i]) coords[i]++;
+  }
+  int rank;
+  MPI_Cart_rank(topologyComm, &coords[0], &rank);
+  return rank;
+}
+
+bool CartesianTopology::rebalance(double load, GridDimensions globalBoundaries, double minimumWidth, double threshold, bool wholeUnits){
+  int worldSize;
+  MPI_Comm_size(topologyComm, &worldSize);
+  vector<double> loads(worldSize);
+  MPI_Allgather(&load, 1, MPI_DOUBLE, &loads[0], 1, MPI_DOUBLE, topologyComm);
+
+  double total = 0;
+  double maxLoad = 0;
+  for(int r = 0; r < worldSize; r++){
+    total += loads[r];
+    if(loads[r] > maxLoad) maxLoad = loads[r];
+  }
+  if(total <= 0) return false;
+  if(threshold > 0 && maxLoad / (total / worldSize) <= threshold) return false;
+
+  // Every process performs the same calculation on the same data, so the boundaries remain consistent
+  vector<vector<int> > rankCoords(worldSize);
+  for(int r = 0; r < worldSize; r++) getCoordinates(r, rankCoords[r]);
+
+  int numDims = procsPerDim.size();
+  vector<vector<double> > oldPositions(numDims);
+  for(int i = 0; i < numDims; i++){
+    int procs = procsPerDim[i];
+    double extent = globalBoundaries.extents(i);
+    for(int j = 0; j <= procs; j++) oldPositions[i].push_back(cutPosition(i, j, globalBoundaries) - globalBoundaries.origin(i));
+
+    vector<double> slabLoads(procs, 0);
+    for(int r = 0; r < worldSize; r++) slabLoads[rankCoords[r][i]] += loads[r];
+
+    vector<double> newPositions;
+    placeCuts(slabLoads, oldPositions[i], extent, minimumWidth, wholeUnits, newPositions);
+    for(int j = 1; j < procs; j++) cuts[i][j] = newPositions[j] / extent;
+  }
+  wholeUnitCuts = wholeUnits;
+
+  bool changed = false;
+  for(int i = 0; i < numDims; i++){
+    for(int j = 0; j <= procsPerDim[i]; j++){
+      if(cutPosition(i, j, globalBoundaries) - globalBoundaries.origin(i) != oldPositions[i][j]) changed = true;
+    }
+  }
+  return changed;
+}
+
+void CartesianTopology::placeCuts(const vector<double>& slabLoads, const vector<double>& oldPositions, double extent,
+    double minimumWidth, bool wholeUnits, vector<double>& newPositions){
+  int procs = slabLoads.size();
+  double total = 0;
+  for(int j = 0; j < procs; j++) total += slabLoads[j];
+
+  newPositions.assign(procs + 1, 0);
+  newPositions[procs] = extent;
+  int slab = 0;
+  double cumulative = 0;
+  for(int j = 1; j < procs; j++){
+    double target = total * j / procs;
+    while(slab < procs - 1 && cumulative + slabLoads[slab] < target){
+      cumulative += slabLoads[slab];
+      slab++;
+    }
+    double fraction = (slabLoads[slab] > 0 ? (target - cumulative) / slabLoads[slab] : 0);
+    if(fraction > 1) fraction = 1;
+    double position = oldPositions[slab] + fraction * (oldPositions[slab + 1] - oldPositions[slab]);
+    newPositions[j] = (wholeUnits ? floor(position + 0.5) : position);
+  }
+
+  // Keep every slab at least the minimum width, when the space is wide enough to allow it
+  double upperLimit = (wholeUnits ? floor(extent) : extent);
+  double width = minimumWidth;
+  if(width * procs > upperLimit) width = (wholeUnits ? floor(upperLimit / procs) : upperLimit / procs);
+  for(int j = 1; j < procs; j++)   if(newPositions[j] < newPositions[j - 1] + width) newPositions[j] = newPositions[j - 1] + width;
+  for(int j = procs - 1; j > 0; j--){
+    double limit = (j == procs - 1 ? upperLimit : newPositions[j + 1]) - width;
+    if(newPositions[j] > limit) newPositions[j] = limit;
+  }
+}
+
 RelativeLocation CartesianTopology::trim(int rank, RelativeLocation volume){
   if( periodic ||
       volume.getCountOfDimensions() != procsPerDim.size()) return RelativeLocation(volume);
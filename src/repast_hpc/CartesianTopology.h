@@ -57,6 +57,14 @@ class CartesianTopology {
 private:
   bool               periodic;
   std::vector<int>   procsPerDim;
+  std::vector<std::vector<double> > cuts;  // Slab boundaries along each dimension, as fractions of the global extent
+  bool               wholeUnitCuts;        // True once rebalance has placed the boundaries on whole units
+
+  /**
+   * Gets the position of the specified slab boundary along
+   * the given dimension
+   */
+  double cutPosition(int dimension, int index, GridDimensions& globalBoundaries);
 
 public:
   MPI_Comm           topologyComm;
@@ -88,6 +96,59 @@ public:
    */
   GridDimensions getDimensions(std::vector<int>& pCoordinates, GridDimensions globalBoundaries);
 
+  /**
+   * Gets the rank of the process whose boundaries contain the
+   * specified point
+   */
+  int  getRankContaining(const std::vector<double>& pt, GridDimensions globalBoundaries);
+
+  /**
+   * Moves the slab boundaries along each dimension so that the load
+   * is spread evenly across the processes. Each process passes its own
+   * load (an agent count or a measured cost); the loads are gathered
+   * and, for each dimension, the boundaries are placed where the
+   * cumulative load (assumed uniform within each current slab) reaches
+   * equal shares of the total (see placeCuts). Every slab is kept at
+   * least minimumWidth wide, where the extent allows it.
+   *
+   * This is a collective call. All projections that share this topology
+   * will see the new boundaries and must be updated (see
+   * SharedBaseGrid::updateBoundaries and AbstractValueLayerND::repartition);
+   * they are expected to share the same global boundaries. Discrete grids
+   * and value layers need boundaries on whole units, so a topology that
+   * any of them uses must be rebalanced with wholeUnits set.
+   *
+   * @param load the load on this process
+   * @param globalBoundaries the global boundaries of the space
+   * @param minimumWidth the smallest permitted slab width, usually the
+   * largest buffer zone of the projections that use this topology
+   * @param threshold if greater than zero, the boundaries are only moved
+   * when the ratio of the maximum load to the mean load exceeds this value
+   * @param wholeUnits if true, boundaries are placed on whole units; if
+   * false (for continuous spaces), anywhere
+   *
+   * @return true if any boundary moved
+   */
+  bool rebalance(double load, GridDimensions globalBoundaries, double minimumWidth = 1, double threshold = 0, bool wholeUnits = true);
+
+  /**
+   * Places the slab boundaries along one dimension so that every slab
+   * receives an equal share of the total load, assuming that the load is
+   * uniform within each current slab. Slabs are kept at least minimumWidth
+   * wide; if the extent is too small for that, they are kept as wide as
+   * an even division allows.
+   *
+   * @param slabLoads the load in each current slab
+   * @param oldPositions the current boundaries, relative to the origin of
+   * the dimension (one more than the number of slabs)
+   * @param extent the extent of the dimension
+   * @param minimumWidth the smallest permitted slab width
+   * @param wholeUnits if true, boundaries are placed on whole units
+   * @param newPositions set to the new boundaries, relative to the origin
+   */
+  static void placeCuts(const std::vector<double>& slabLoads, const std::vector<double>& oldPositions, double extent,
+      double minimumWidth, bool wholeUnits, std::vector<double>& newPositions);
+
   /**
    * Trims the relative location volume to only valid values.
    * If the CartesianTopology is periodic, this will have no effect,
@@ -0,0 +1,462 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  CellListOccupancy.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: jtm
+ */
+
+#ifndef CELLLISTOCCUPANCY_H_
+#define CELLLISTOCCUPANCY_H_
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cmath>
+
+#include <boost/shared_ptr.hpp>
+
+#include "Point.h"
+#include "GridDimensions.h"
+#include "MultipleOccupancy.h"
+
+namespace repast {
+
+/**
+ * Multiple Occupancy cell accessor for continuous spaces that, in addition
+ * to the occupants of each location, keeps a uniform cell list: the region set
+ * by init (for a shared space, its local bounds plus the buffer) is divided
+ * into square cells of a fixed size and each occupant is listed in the cell
+ * containing it, along with its coordinates. The cell list is updated as
+ * occupants are put and removed, and supports finding the occupants within
+ * a radius of a point, or nearest to it, by visiting only the cells that
+ * the search can reach. In a periodic space, an occupant outside the region
+ * whose image across the border of the space is inside it (such as a copy
+ * in a buffer zone that wraps around) is listed in the cell of that image.
+ * Other occupants outside the region are kept in a single list that every
+ * search scans.
+ *
+ * @param T the type of object in the Grid
+ * @param GPType the coordinate type of the grid point locations. This must
+ * be an int or a double.
+ */
+template<typename T, typename GPType>
+class CellListOccupancy {
+
+private:
+	struct Cell {
+		std::vector<T*> agents;
+		// the coordinates of each agent, dimensionCount per agent
+		std::vector<double> coords;
+	};
+
+	MultipleOccupancy<T, GPType> locations;
+
+	size_t dimCount;
+	GridDimensions region;
+	std::vector<long> cellCounts, strides;
+	double cellSize;
+	std::vector<Cell> cells;
+	Cell outside;
+
+	std::vector<double> globalExtents;
+	bool periodic;
+
+	long cellOf(const std::vector<GPType>& coords) const;
+	long place(const std::vector<GPType>& coords, std::vector<GPType>& placed) const;
+	void add(Cell& cell, T* agent, const std::vector<GPType>& coords);
+	void erase(Cell& cell, T* agent);
+	void layout();
+	double distanceSq(const double* coords, const std::vector<double>& center, bool nearestImage) const;
+	void collect(const std::vector<double>& center, double radius, std::vector<std::pair<double, T*> >& out) const;
+
+public:
+
+	CellListOccupancy();
+
+	/**
+	 * Sets the region divided into cells. Any items already put are moved
+	 * into the new cells.
+	 *
+	 * @param bounds the region to divide into cells
+	 */
+	void init(const GridDimensions& bounds);
+
+	/**
+	 * Sets the size of the cells and the topology used to measure distances.
+	 * Any items already put are moved into the new cells.
+	 *
+	 * @param globalBounds the bounds of the entire space
+	 * @param isPeriodic whether the space wraps around at its borders
+	 * @param size the length of each side of a cell. If this is not positive,
+	 * the whole region is a single cell.
+	 */
+	void setTopology(const GridDimensions& globalBounds, bool isPeriodic, double size);
+
+	/**
+	 * Gets the first object found at the specified location.
+	 *
+	 * @param location the location to get the object at
+	 * @return the first object found at the specified location or 0 if there
+	 * are no objects at the specified location.
+	 */
+	T* get(const Point<GPType>& location) const {
+		return locations.get(location);
+	}
+
+	/**
+	 * Gets all the items found at the specified location.
+	 *
+	 * @param location the location to get the items at
+	 * @param [out] the found items will be returned in this vector
+	 */
+	void getAll(const Point<GPType>& location, std::vector<T*>& out) const {
+		locations.getAll(location, out);
+	}
+
+	/**
+	 * Puts the specified item at the specified location.
+	 *
+	 * @param agent the item to put
+	 * @param location the location to put the item at
+	 */
+	bool put(boost::shared_ptr<T>& agent, const Point<GPType>& location);
+
+	/**
+	 * Removes the specified item from the specified location.
+	 *
+	 * @param agent the item to remove
+	 * @param location the location to remove the item from
+	 */
+	void remove(boost::shared_ptr<T>& agent, const Point<GPType>& location);
+
+	/**
+	 * Gets the items within the specified distance of a point, in no
+	 * particular order.
+	 *
+	 * @param center the point to measure from
+	 * @param radius the maximum distance of the items from center
+	 * @param [out] out the items found are appended to this vector
+	 */
+	void getWithin(const Point<GPType>& center, double radius, std::vector<T*>& out) const;
+
+	/**
+	 * Gets the specified number of items nearest to a point, ordered by
+	 * their distance from it. Items at the same distance are ordered by
+	 * AgentId. Fewer items are returned if there are not that many.
+	 *
+	 * @param center the point to measure from
+	 * @param count the number of items to get
+	 * @param [out] out the items found are appended to this vector
+	 */
+	void getNearest(const Point<GPType>& center, size_t count, std::vector<T*>& out) const;
+
+};
+
+/**
+ * Orders pairs of squared distances and agents by distance, and then
+ * by AgentId, so that nearest neighbor queries do not depend on
+ * where the agents happen to be allocated.
+ */
+template<typename T>
+struct NearerAgent {
+	bool operator()(const std::pair<double, T*>& one, const std::pair<double, T*>& two) const {
+		if (one.first != two.first) return one.first < two.first;
+		return one.second->getId() < two.second->getId();
+	}
+};
+
+template<typename T, typename GPType>
+CellListOccupancy<T, GPType>::CellListOccupancy() :
+	dimCount(0), cellSize(0), periodic(false) {
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::init(const GridDimensions& bounds) {
+	region = bounds;
+	layout();
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::setTopology(const GridDimensions& globalBounds, bool isPeriodic, double size) {
+	globalExtents = globalBounds.extents().coords();
+	periodic = isPeriodic;
+	cellSize = size;
+	layout();
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::layout() {
+	std::vector<Cell> oldCells;
+	oldCells.swap(cells);
+	oldCells.push_back(Cell());
+	oldCells.back().agents.swap(outside.agents);
+	oldCells.back().coords.swap(outside.coords);
+	size_t oldDimCount = dimCount;
+
+	dimCount = region.dimensionCount();
+	cellCounts.assign(dimCount, 1);
+	strides.assign(dimCount, 1);
+	long total = (dimCount > 0 ? 1 : 0);
+	for (size_t i = 0; i < dimCount; i++) {
+		if (cellSize > 0) cellCounts[i] = std::max(1L, (long) std::ceil(region.extents(i) / cellSize));
+		strides[i] = total;
+		total *= cellCounts[i];
+	}
+	cells.resize(total);
+
+	std::vector<GPType> coords(oldDimCount, 0), placed;
+	for (size_t c = 0; c < oldCells.size(); c++) {
+		Cell& cell = oldCells[c];
+		for (size_t i = 0; i < cell.agents.size(); i++) {
+			for (size_t d = 0; d < oldDimCount; d++) coords[d] = (GPType) cell.coords[i * oldDimCount + d];
+			long index = place(coords, placed);
+			add(index == -1 ? outside : cells[index], cell.agents[i], placed);
+		}
+	}
+}
+
+template<typename T, typename GPType>
+long CellListOccupancy<T, GPType>::cellOf(const std::vector<GPType>& coords) const {
+	if (cells.empty() || coords.size() != dimCount || !region.contains(coords))
+		return -1;
+	long index = 0;
+	for (size_t i = 0; i < dimCount; i++) {
+		long cell = (cellSize > 0 ? (long) ((coords[i] - region.origin(i)) / cellSize) : 0);
+		index += std::min(cell, cellCounts[i] - 1) * strides[i];
+	}
+	return index;
+}
+
+template<typename T, typename GPType>
+long CellListOccupancy<T, GPType>::place(const std::vector<GPType>& coords, std::vector<GPType>& placed) const {
+	placed = coords;
+	long index = cellOf(placed);
+	if (index != -1 || !periodic || cells.empty() || coords.size() != dimCount) return index;
+
+	// try the image of the location, across the border of the space, that is nearest the region
+	for (size_t i = 0; i < dimCount; i++) {
+		if (placed[i] < region.origin(i)) placed[i] += (GPType) globalExtents[i];
+		else if (placed[i] >= region.origin(i) + region.extents(i)) placed[i] -= (GPType) globalExtents[i];
+	}
+	index = cellOf(placed);
+	if (index == -1) placed = coords;
+	return index;
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::add(Cell& cell, T* agent, const std::vector<GPType>& coords) {
+	cell.agents.push_back(agent);
+	cell.coords.insert(cell.coords.end(), coords.begin(), coords.end());
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::erase(Cell& cell, T* agent) {
+	for (size_t i = 0; i < cell.agents.size(); i++) {
+		if (cell.agents[i] == agent) {
+			// move the last agent into the removed agent's place
+			size_t last = cell.agents.size() - 1;
+			cell.agents[i] = cell.agents[last];
+			std::copy(cell.coords.begin() + last * dimCount, cell.coords.end(), cell.coords.begin() + i * dimCount);
+			cell.agents.pop_back();
+			cell.coords.resize(last * dimCount);
+			return;
+		}
+	}
+}
+
+template<typename T, typename GPType>
+bool CellListOccupancy<T, GPType>::put(boost::shared_ptr<T>& agent, const Point<GPType>& location) {
+	std::vector<T*> present;
+	locations.getAll(location, present);
+	if (std::find(present.begin(), present.end(), agent.get()) != present.end())
+		return true;
+
+	locations.put(agent, location);
+	std::vector<GPType> placed;
+	long index = place(location.coords(), placed);
+	add(index == -1 ? outside : cells[index], agent.get(), placed);
+	return true;
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::remove(boost::shared_ptr<T>& agent, const Point<GPType>& location) {
+	std::vector<T*> present;
+	locations.getAll(location, present);
+	if (std::find(present.begin(), present.end(), agent.get()) == present.end())
+		return;
+
+	locations.remove(agent, location);
+	std::vector<GPType> placed;
+	long index = place(location.coords(), placed);
+	erase(index == -1 ? outside : cells[index], agent.get());
+}
+
+template<typename T, typename GPType>
+double CellListOccupancy<T, GPType>::distanceSq(const double* coords, const std::vector<double>& center, bool nearestImage) const {
+	double sum = 0;
+	for (size_t i = 0; i < dimCount; i++) {
+		double diff = std::fabs(coords[i] - center[i]);
+		if (nearestImage && periodic && diff > globalExtents[i] / 2) diff = globalExtents[i] - diff;
+		sum += diff * diff;
+	}
+	return sum;
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::collect(const std::vector<double>& center, double radius,
+		std::vector<std::pair<double, T*> >& out) const {
+	double radiusSq = radius * radius;
+
+	for (size_t i = 0; i < outside.agents.size(); i++) {
+		double distSq = distanceSq(&outside.coords[i * dimCount], center, true);
+		if (distSq <= radiusSq) out.push_back(std::make_pair(distSq, outside.agents[i]));
+	}
+	if (cells.empty()) return;
+
+	// In a periodic space the search must also cover the images of center
+	// shifted by the extent of the space. Each agent in a cell is listed at
+	// a single image of its location, and its distance is measured to the
+	// image of center being searched, so it is found once unless the
+	// images' searches overlap.
+	bool canRepeat = false;
+	std::vector<int> minShift(dimCount, 0), maxShift(dimCount, 0);
+	if (periodic) {
+		for (size_t i = 0; i < dimCount; i++) {
+			minShift[i] = -1;
+			maxShift[i] = 1;
+			if (2 * radius >= globalExtents[i]) canRepeat = true;
+		}
+	}
+	std::set<T*> found;
+
+	std::vector<int> shift(minShift);
+	std::vector<long> low(dimCount), high(dimCount), cell(dimCount);
+	std::vector<double> image(dimCount);
+	bool moreShifts = true;
+	while (moreShifts) {
+		// the range of cells the search around this image of center reaches
+		bool reaches = true;
+		for (size_t i = 0; i < dimCount && reaches; i++) {
+			image[i] = center[i] + shift[i] * (periodic ? globalExtents[i] : 0);
+			double at = image[i] - region.origin(i);
+			if (at + radius < 0 || at - radius > region.extents(i)) {
+				reaches = false;
+			} else if (cellSize > 0) {
+				low[i] = std::min(cellCounts[i] - 1, std::max(0L, (long) std::floor((at - radius) / cellSize)));
+				high[i] = std::min(cellCounts[i] - 1, (long) std::floor((at + radius) / cellSize));
+			} else {
+				low[i] = high[i] = 0;
+			}
+		}
+
+		if (reaches) {
+			cell = low;
+			bool moreCells = true;
+			while (moreCells) {
+				long index = 0;
+				for (size_t i = 0; i < dimCount; i++) index += cell[i] * strides[i];
+				const Cell& current = cells[index];
+				for (size_t a = 0; a < current.agents.size(); a++) {
+					double distSq = distanceSq(&current.coords[a * dimCount], image, false);
+					if (distSq <= radiusSq && (!canRepeat || found.insert(current.agents[a]).second))
+						out.push_back(std::make_pair(distSq, current.agents[a]));
+				}
+				moreCells = false;
+				for (size_t i = 0; i < dimCount && !moreCells; i++) {
+					if (cell[i] < high[i]) {
+						cell[i]++;
+						moreCells = true;
+					} else {
+						cell[i] = low[i];
+					}
+				}
+			}
+		}
+
+		moreShifts = false;
+		for (size_t i = 0; i < dimCount && !moreShifts; i++) {
+			if (shift[i] < maxShift[i]) {
+				shift[i]++;
+				moreShifts = true;
+			} else {
+				shift[i] = minShift[i];
+			}
+		}
+	}
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::getWithin(const Point<GPType>& center, double radius, std::vector<T*>& out) const {
+	std::vector<std::pair<double, T*> > found;
+	collect(std::vector<double>(center.begin(), center.end()), radius, found);
+	for (size_t i = 0; i < found.size(); i++) {
+		out.push_back(found[i].second);
+	}
+}
+
+template<typename T, typename GPType>
+void CellListOccupancy<T, GPType>::getNearest(const Point<GPType>& center, size_t count, std::vector<T*>& out) const {
+	if (count == 0) return;
+	std::vector<double> pt(center.begin(), center.end());
+
+	// no two points in the space are further apart than this
+	double reach = 0;
+	for (size_t i = 0; i < dimCount; i++) {
+		double extent = (i < globalExtents.size() ? globalExtents[i] : region.extents(i));
+		reach += extent * extent;
+	}
+	reach = std::sqrt(reach);
+
+	// widen the search until it finds enough agents: the nearest count
+	// agents are then all within it
+	double radius = (cellSize > 0 ? cellSize : reach);
+	std::vector<std::pair<double, T*> > found;
+	while (true) {
+		found.clear();
+		collect(pt, radius, found);
+		if (found.size() >= count || radius >= reach) break;
+		radius = std::min(radius * 2, reach);
+	}
+
+	size_t n = std::min(count, found.size());
+	std::partial_sort(found.begin(), found.begin() + n, found.end(), NearerAgent<T>());
+	for (size_t i = 0; i < n; i++) {
+		out.push_back(found[i].second);
+	}
+}
+
+}
+
+#endif /* CELLLISTOCCUPANCY_H_ */
@@ -0,0 +1,133 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  ContentTraits.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jtm
+ */
+
+#ifndef CONTENTTRAITS_H_
+#define CONTENTTRAITS_H_
+
+#include <vector>
+#include <type_traits>
+
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/binary_object.hpp>
+
+#include "AgentId.h"
+
+namespace repast {
+
+/**
+ * Trait that determines whether vectors of agent Content (the package type that
+ * carries an agent's state between processes) can be exchanged as raw memory rather
+ * than through Boost serialization. It is true for trivially copyable types,
+ * such as a plain struct of numbers, and for these RepastProcess sends the bytes
+ * of the vector directly, without running a serialization archive for each agent.
+ *
+ * A Content type that is trivially copyable but must not be copied bytewise
+ * (for example, because it holds pointers that its serialize method follows)
+ * can opt out by specializing this trait:
+ *
+ * <code>
+ * namespace repast {
+ *   template<> struct is_raw_content<MyPackage> : std::false_type {};
+ * }
+ * </code>
+ */
+template<typename Content>
+struct is_raw_content : std::integral_constant<bool,
+		std::is_trivially_copyable<Content>::value> {
+};
+
+/**
+ * Trait that determines whether agent Content provides the id of the agent it
+ * describes through a method callable as <code>AgentId getId() const</code>.
+ * When it does, RepastProcess looks received agents up in the context by this
+ * id before asking the AgentCreator to create them, rather than creating an
+ * agent and deleting it again if the context already has it.
+ */
+template<typename Content>
+struct has_agent_id {
+private:
+	template<typename C>
+	static std::true_type test(typename std::enable_if<std::is_convertible<
+			decltype(std::declval<const C&>().getId()), AgentId>::value, int>::type);
+
+	template<typename C>
+	static std::false_type test(...);
+
+public:
+	typedef decltype(test<Content>(0)) type;
+	static const bool value = type::value;
+};
+
+namespace detail {
+
+template<class Archive, typename Content>
+void serializeContent(Archive& ar, std::vector<Content>*& content, std::false_type) {
+	ar & content;
+}
+
+template<class Archive, typename Content>
+void serializeContent(Archive& ar, std::vector<Content>*& content, std::true_type) {
+	size_t count = (content != 0 ? content->size() : 0);
+	ar & count;
+	if (Archive::is_loading::value) {
+		delete content;
+		content = new std::vector<Content>(count);
+	}
+	if (count > 0) {
+		boost::serialization::binary_object bytes(content->data(), count * sizeof(Content));
+		ar & bytes;
+	}
+}
+
+}
+
+/**
+ * Serializes a pointer to a vector of agent Content as part of a packet.
+ * Raw content is written as a count followed by a single block of bytes;
+ * anything else is serialized through the pointer as usual.
+ */
+template<class Archive, typename Content>
+void serializeContent(Archive& ar, std::vector<Content>*& content) {
+	detail::serializeContent(ar, content, typename is_raw_content<Content>::type());
+}
+
+}
+
+#endif /* CONTENTTRAITS_H_ */
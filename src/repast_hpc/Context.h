@@ -51,7 +51,9 @@
 #include <boost/function.hpp>
 
 #include "AgentId.h"
+#include "AgentIdMap.h"
 #include "AgentRequest.h"
+#include "AgentStore.h"
 #include "Random.h"
 #include "ValueLayer.h"
 #include "Projection.h"
@@ -59,18 +61,47 @@
 
 namespace repast {
 
+/**
+ * An agent in a Context's agent map, along with its positions
+ * in the Context's dense index of agents and in the index of
+ * agents of its type.
+ */
+template<typename T>
+struct ContextEntry {
+	boost::shared_ptr<T> ptr;
+	size_t index;
+	size_t typeIndex;
+
+	ContextEntry() : index(0), typeIndex(0) {
+	}
+
+	ContextEntry(const boost::shared_ptr<T>& agent, size_t position, size_t typePosition) :
+			ptr(agent), index(position), typeIndex(typePosition) {
+	}
+};
+
 /**
  * Unary function used in the transform_iterator that allows context iterators
  * to return the agent maps values.
  */
 template<typename T>
-struct SecondElement: public std::unary_function<typename boost::unordered_map<AgentId, boost::shared_ptr<T> >::value_type, boost::shared_ptr<T> > {
-  boost::shared_ptr<T> operator()(const typename boost::unordered_map<AgentId, boost::shared_ptr<T> >::value_type& value) const {
-    const boost::shared_ptr<T>& ptr = value.second;
+struct SecondElement: public std::unary_function<typename AgentIdMap<ContextEntry<T> >::value_type, boost::shared_ptr<T> > {
+  boost::shared_ptr<T> operator()(const typename AgentIdMap<ContextEntry<T> >::value_type& value) const {
+    const boost::shared_ptr<T>& ptr = value.second.ptr;
     return ptr;
   }
 };
 
+/**
+ * Predicate that accepts every agent, for sampling from all of a Context's agents.
+ */
+template<typename T>
+struct AnyAgent {
+	bool operator()(const T* agent) const {
+		return true;
+	}
+};
+
 
 /**
  * Collection of agents of type T with set semantics. Object identity and equality
@@ -84,21 +115,86 @@ class Context {
 private:
 
 	typedef typename std::vector<Projection<T>*>::iterator ProjPtrIter;
-	typedef typename boost::unordered_map<AgentId, boost::shared_ptr<T>, HashId> AgentMap;
+	typedef AgentIdMap<ContextEntry<T> > AgentMap;
 
 	typedef typename AgentMap::iterator AgentMapIterator;
 	typedef typename AgentMap::const_iterator AgentMapConstIterator;
+	typedef std::vector<boost::shared_ptr<T> > TypeBucket;
 
 	AgentMap agents;
 	std::map<std::string, BaseValueLayer*> valueLayers;
 
+	// dense index of the agents, for random access
+	std::vector<T*> agentIndex;
+	// the agents of each type, keyed by AgentId::agentType()
+	std::map<int, TypeBucket> typeBuckets;
+	TypeBucket noAgents;
+	// the AgentStores of stored agents; released only after the agents and projections
+	std::vector<boost::shared_ptr<void> > agentStores;
+
 protected:
   std::vector<Projection<T> *> projections;
 
+	/**
+	 * Selects count agents at random from the agents in pool that satisfy
+	 * pred, with the semantics of selectNElementsAtRandom. Agents are drawn
+	 * from random positions in pool and those that fail pred or have already
+	 * been selected are redrawn, so a small selection costs O(count) when
+	 * most of pool satisfies pred. Large selections, and selections whose
+	 * redraws fail too often, fall back to selectNElementsAtRandom over first
+	 * to last, the iterators over the agents satisfying pred.
+	 *
+	 * @param pool the agents (or pointers to them) to draw from
+	 * @param pred the predicate the selected agents must satisfy
+	 * @param first the start of an iterator over the agents in pool that satisfy pred
+	 * @param last the end of that iterator
+	 * @param popSize the number of agents in that iterator, or -1 if unknown
+	 * @param count the number of agents to select
+	 * @param [out] selectedAgents the set into which the agents are placed
+	 * @param remove if true, agents originally in the set are removed from it
+	 */
+	template<typename P, typename Pred, typename I>
+	void sampleAgents(const std::vector<P>& pool, Pred pred, I first, I last, int popSize, int count,
+			std::set<T*>& selectedAgents, bool remove);
+
+	/**
+	 * Selects count agents at random as sampleAgents, returning them in
+	 * random order in a vector, as selectNElementsInRandomOrder.
+	 */
+	template<typename P, typename Pred, typename I>
+	void sampleAgents(const std::vector<P>& pool, Pred pred, I first, I last, int popSize, int count,
+			std::vector<T*>& selectedAgents, bool remove);
+
+	/**
+	 * Gets the dense index of the agents in this context, in no particular order.
+	 */
+	const std::vector<T*>& indexedAgents() const {
+		return agentIndex;
+	}
+
+	/**
+	 * Gets the agents in this context of the specified type, in no particular order.
+	 */
+	const TypeBucket& agentsOfType(int typeId) const {
+		typename std::map<int, TypeBucket>::const_iterator iter = typeBuckets.find(typeId);
+		return iter == typeBuckets.end() ? noAgents : iter->second;
+	}
+
+	/**
+	 * Adds the agent held by the specified pointer to this context and
+	 * its projections. The caller must have checked that no agent with
+	 * the same id is already present.
+	 */
+	void insertAgent(const boost::shared_ptr<T>& ptr);
+
 public:
 
 	typedef typename boost::transform_iterator<SecondElement<T> , typename AgentMap::const_iterator> const_iterator;
-	typedef typename boost::filter_iterator<IsAgentType<T> , typename Context<T>::const_iterator> const_bytype_iterator;
+	/**
+	 * Iterator over the agents of a single type. Each type's agents are kept in their
+	 * own index, so iterating over a type visits only the agents of that type.
+	 */
+	typedef typename TypeBucket::const_iterator const_bytype_iterator;
 
 	Context();
 
@@ -125,6 +221,22 @@ public:
 	 */
 	T* addAgent(T* agent);
 
+	/**
+	 * Adds an agent created by the specified AgentStore to the context, as
+	 * addAgent(T*). When the agent is removed from the context, it is returned
+	 * to the store rather than deleted. The context keeps a reference to the
+	 * store until it is destroyed itself, after its agents and projections.
+	 *
+	 * @param agent the agent to add, created by store
+	 * @param store the store that created the agent
+	 *
+	 * @tparam A the concrete type of the agent
+	 *
+	 * @return the address of the agent in the context
+	 */
+	template<typename A>
+	T* addAgent(A* agent, const boost::shared_ptr<AgentStore<A> >& store);
+
 	/**
 	 * Adds the specified projection to this context. All the agents in this
 	 * context will be added to the Projection. Any agents subsequently added
@@ -164,7 +276,8 @@ public:
 
 	/**
 	 * Gets at random the specified count of agents and returns them
-	 * in the agents vector.
+	 * in the agents vector. Agents already in the vector are not chosen
+	 * again; if fewer than count other agents remain, all of them are returned.
 	 *
 	 * @param count the number of agents to get
 	 * @param [out] agents a vector where the agents will be returned
@@ -203,7 +316,7 @@ public:
 	 * @return the start of an iterator over agents in this context of the specified type.
 	 */
 	const_bytype_iterator byTypeBegin(int typeId) const {
-		return const_bytype_iterator(IsAgentType<T> (typeId), Context<T>::begin(), Context<T>::end());
+		return agentsOfType(typeId).begin();
 	}
 
 	/**
@@ -216,7 +329,7 @@ public:
 	 * @return the end of an iterator over agents in this context of the specified type.
 	 */
 	const_bytype_iterator byTypeEnd(int typeId) const {
-		return const_bytype_iterator(IsAgentType<T> (typeId), Context<T>::end(), Context<T>::end());
+		return agentsOfType(typeId).end();
 	}
 
 	/**
@@ -821,7 +934,9 @@ Context<T>::Context() {
 
 template<typename T>
 Context<T>::~Context() {
-	agents.erase(agents.begin(), agents.end());
+	agents.clear();
+	agentIndex.clear();
+	typeBuckets.clear();
 	for (ProjPtrIter iter = projections.begin(); iter != projections.end(); ++iter) {
 		Projection<T>* proj = *iter;
 		delete proj;
@@ -833,6 +948,7 @@ Context<T>::~Context() {
 		delete layer;
 	}
 	valueLayers.clear();
+	agentStores.clear();
 }
 
 template<typename T>
@@ -861,42 +977,50 @@ template<typename T>
 T* Context<T>::getAgent(const AgentId& id) {
   AgentMapIterator iter = agents.find(id);
   if (iter == agents.end()) return 0;
-  return iter->second.get();
+  return iter->second.ptr.get();
 }
 
 template<typename T>
 void Context<T>::getRandomAgents(const int count, std::vector<T*>& agents) {
-	for (int i = 0; i < count; i++) {
-		IntUniformGenerator rnd = Random::instance()->createUniIntGenerator(0, size() - 1);
-		bool found = false;
-		while (!found) {
-			const_iterator iter = begin();
-			for (int j = 0, n = rnd.next(); j < n; iter++, j++)
-				;
-			T* agent = iter->get();
-			if (find(agents.begin(), agents.end(), agent) == agents.end()) {
-				agents.push_back(agent);
-				found = true;
-			}
-		}
-	}
+	std::vector<T*> selected(agents);
+	selectAgents(count, selected, true);
+	agents.insert(agents.end(), selected.begin(), selected.end());
 }
 
 template<typename T>
 T* Context<T>::addAgent(T* agent) {
 	const AgentId& id = agent->getId();
 	typename AgentMap::iterator findIter = agents.find(id);
-	if (findIter != agents.end())    return &*(findIter->second);
+	if (findIter != agents.end())    return findIter->second.ptr.get();
+
+	insertAgent(boost::shared_ptr<T>(agent));
+	return agent;
+}
 
-	boost::shared_ptr<T> ptr(agent);
-	agents[id] = ptr;
+template<typename T>
+template<typename A>
+T* Context<T>::addAgent(A* agent, const boost::shared_ptr<AgentStore<A> >& store) {
+	typename AgentMap::iterator findIter = agents.find(agent->getId());
+	if (findIter != agents.end()) return findIter->second.ptr.get();
+
+	bool known = false;
+	for (size_t i = 0; i < agentStores.size() && !known; i++) known = (agentStores[i].get() == store.get());
+	if (!known) agentStores.push_back(store);
+	insertAgent(boost::shared_ptr<T>(agent, AgentStoreDeleter<A>(store.get()), AgentStoreAllocator<char, A>(store.get())));
+	return agent;
+}
+
+template<typename T>
+void Context<T>::insertAgent(const boost::shared_ptr<T>& ptr) {
+	TypeBucket& bucket = typeBuckets[ptr->getId().agentType()];
+	agents[ptr->getId()] = ContextEntry<T>(ptr, agentIndex.size(), bucket.size());
+	agentIndex.push_back(ptr.get());
+	bucket.push_back(ptr);
 
 	for (ProjPtrIter iter = projections.begin(); iter != projections.end(); ++iter) {
 		Projection<T>* proj = *iter;
 		proj->addAgent(ptr);
 	}
-
-	return agent;
 }
 
 template<typename T>
@@ -908,11 +1032,26 @@ template<typename T>
 void Context<T>::removeAgent(const AgentId id) {
 	const AgentMapIterator iter = agents.find(id);
 	if (iter != agents.end()) {
-		boost::shared_ptr<T>& ptr = iter->second;
+		boost::shared_ptr<T>& ptr = iter->second.ptr;
 		for (ProjPtrIter pIter = projections.begin(); pIter != projections.end(); ++pIter) {
 			Projection<T>* proj = *pIter;
 			proj->removeAgent(ptr.get());
 		}
+		// move the last agent in the index into the removed agent's place
+		size_t index = iter->second.index;
+		T* last = agentIndex.back();
+		agentIndex[index] = last;
+		agents.find(last->getId())->second.index = index;
+		agentIndex.pop_back();
+
+		// and likewise in the index of the agent's type
+		TypeBucket& bucket = typeBuckets[id.agentType()];
+		size_t typeIndex = iter->second.typeIndex;
+		if (typeIndex + 1 != bucket.size()) {
+			bucket[typeIndex].swap(bucket.back());
+			agents.find(bucket[typeIndex]->getId())->second.typeIndex = typeIndex;
+		}
+		bucket.pop_back();
 		agents.erase(iter);
 	}
 }
@@ -996,36 +1135,38 @@ void Context<T>::selectAgents(std::vector<T*>& selectedAgents, bool remove){
 	
 template<typename T>
 void Context<T>::selectAgents(int count, std::set<T*>& selectedAgents, bool remove){
-	selectNElementsAtRandom(begin(), size(), count, selectedAgents, remove);
+	sampleAgents(agentIndex, AnyAgent<T>(), begin(), end(), size(), count, selectedAgents, remove);
 }
 	
 template<typename T>
 void Context<T>::selectAgents(int count, std::vector<T*>& selectedAgents, bool remove){
-	selectNElementsInRandomOrder(begin(), end(), count, selectedAgents, remove);
+	sampleAgents(agentIndex, AnyAgent<T>(), begin(), end(), size(), count, selectedAgents, remove);
 }
 	
 template<typename T>
 void Context<T>::selectAgents(std::set<T*>& selectedAgents, int type, bool remove, int popSize){
-	if(popSize <= -1) selectNElementsAtRandom(byTypeBegin(type), byTypeEnd(type), size(), selectedAgents, remove);
-	else              selectNElementsAtRandom(byTypeBegin(type), popSize, size(), selectedAgents, remove);
+	if(popSize <= -1) popSize = agentsOfType(type).size();
+	selectNElementsAtRandom(byTypeBegin(type), popSize, size(), selectedAgents, remove);
 }
 	
 template<typename T>
 void Context<T>::selectAgents(std::vector<T*>& selectedAgents, int type, bool remove, int popSize){
-	if(popSize <= -1) selectNElementsInRandomOrder(byTypeBegin(type), byTypeEnd(type), size(), selectedAgents, remove);
-	else              selectNElementsInRandomOrder(byTypeBegin(type), popSize, size(), selectedAgents, remove);
+	if(popSize <= -1) popSize = agentsOfType(type).size();
+	selectNElementsInRandomOrder(byTypeBegin(type), popSize, size(), selectedAgents, remove);
 }
 	
 template<typename T>
 void Context<T>::selectAgents(int count, std::set<T*>& selectedAgents, int type, bool remove, int popSize){
-	if(popSize <= -1) selectNElementsAtRandom(byTypeBegin(type), byTypeEnd(type), count, selectedAgents, remove);
-	else              selectNElementsAtRandom(byTypeBegin(type), popSize, count, selectedAgents, remove);
+	const TypeBucket& bucket = agentsOfType(type);
+	if(popSize <= -1) popSize = bucket.size();
+	sampleAgents(bucket, AnyAgent<T>(), bucket.begin(), bucket.end(), popSize, count, selectedAgents, remove);
 }
 	
 template<typename T>
 void Context<T>::selectAgents(int count, std::vector<T*>& selectedAgents, int type, bool remove, int popSize){
-	if(popSize <= -1) selectNElementsInRandomOrder(byTypeBegin(type), byTypeEnd(type), count, selectedAgents, remove);
-	else              selectNElementsInRandomOrder(byTypeBegin(type), popSize, count, selectedAgents, remove);
+	const TypeBucket& bucket = agentsOfType(type);
+	if(popSize <= -1) popSize = bucket.size();
+	sampleAgents(bucket, AnyAgent<T>(), bucket.begin(), bucket.end(), popSize, count, selectedAgents, remove);
 }
 	
 template<typename T>
@@ -1084,6 +1225,46 @@ void Context<T>::selectAgents(int count, std::vector<T*>& selectedAgents, int ty
 	else              selectNElementsInRandomOrder(byTypeFilteredBegin(type, filter), popSize, count, selectedAgents, remove);
 }
 
+template<typename T>
+template<typename P, typename Pred, typename I>
+void Context<T>::sampleAgents(const std::vector<P>& pool, Pred pred, I first, I last, int popSize, int count,
+		std::set<T*>& selectedAgents, bool remove) {
+	if (count == 0 || (size_t) count * 2 > pool.size()) {
+		if (popSize < 0) popSize = countOf(first, last);
+		selectNElementsAtRandom(first, popSize, count, selectedAgents, remove);
+		return;
+	}
+
+	std::vector<T*> original;
+	if (remove) original.assign(selectedAgents.begin(), selectedAgents.end());
+
+	IntUniformGenerator rnd = Random::instance()->createUniIntGenerator(0, pool.size() - 1);
+	int added = 0, misses = 0, maxMisses = 4 * count + 16;
+	while (added < count && misses < maxMisses) {
+		T* agent = &*pool[(size_t) rnd.next()];
+		if (pred(agent) && selectedAgents.insert(agent).second) added++;
+		else misses++;
+	}
+	if (added < count) {
+		// Too few of the agents in pool can be selected; choose the rest from the iterator
+		if (popSize < 0) popSize = countOf(first, last);
+		selectNElementsAtRandom(first, popSize, count - added, selectedAgents, false);
+	}
+
+	for (typename std::vector<T*>::iterator iter = original.begin(); iter != original.end(); ++iter)
+		selectedAgents.erase(*iter);
+}
+
+template<typename T>
+template<typename P, typename Pred, typename I>
+void Context<T>::sampleAgents(const std::vector<P>& pool, Pred pred, I first, I last, int popSize, int count,
+		std::vector<T*>& selectedAgents, bool remove) {
+	std::set<T*> selectedAgentSet(selectedAgents.begin(), selectedAgents.end());
+	selectedAgents.clear();
+	sampleAgents(pool, pred, first, last, popSize, count, selectedAgentSet, remove);
+	shuffleSet(selectedAgentSet, selectedAgents);
+}
+
 
 // Beta
 
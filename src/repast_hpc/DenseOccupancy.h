@@ -0,0 +1,335 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  DenseOccupancy.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: jtm
+ */
+
+#ifndef DENSEOCCUPANCY_H_
+#define DENSEOCCUPANCY_H_
+
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_integral.hpp>
+
+#include "Point.h"
+#include "GridDimensions.h"
+
+namespace repast {
+
+/**
+ * The smallest fraction of its region that a process must own for a
+ * shared grid to store the region's cells densely
+ */
+const double DENSE_OCCUPANCY_MIN_COVERAGE = 0.25;
+
+/**
+ * Multiple Occupancy cell accessor for discrete grids that stores the cells
+ * within a bounded region (for a shared grid, its local bounds plus the
+ * buffer) in a dense array, so that finding the occupants of a location
+ * is index arithmetic rather than a hash lookup. The occupants of each cell
+ * are kept in a list of slots drawn from a single pool; slots freed by
+ * removals are reused by later puts. Locations outside the region are held
+ * in a map, as in MultipleOccupancy.
+ *
+ * The dense array is allocated when the first item is put, so a region
+ * may be set with init and then replaced by a smaller one without
+ * allocating cells for the first. A shared grid whose process owns only a
+ * small part of its region stores no cells densely (see initCellAccessor).
+ *
+ * @param T the type of object in the Grid
+ * @param GPType the coordinate type of the grid point locations. This must
+ * be an integral type.
+ */
+template<typename T, typename GPType>
+class DenseOccupancy {
+
+	BOOST_STATIC_ASSERT(boost::is_integral<GPType>::value);
+
+private:
+	struct Slot {
+		boost::shared_ptr<T> agent;
+		int next;
+	};
+
+	typedef std::vector<boost::shared_ptr<T> > ValueType;
+	typedef typename boost::unordered_map<Point<GPType> , ValueType, HashGridPoint<GPType> > LocationMap;
+	typedef typename LocationMap::iterator LocationMapIter;
+	typedef typename LocationMap::const_iterator LocationMapConstIter;
+
+	std::vector<long> origin, extents, strides;
+	size_t cellCount;
+
+	// first slot of each cell, or -1 if the cell is empty
+	std::vector<int> cells;
+	std::vector<Slot> slots;
+	int freeSlots;
+
+	LocationMap overflow;
+
+	long cellIndex(const Point<GPType>& location) const;
+	void allocate();
+
+public:
+
+	DenseOccupancy();
+
+	/**
+	 * Sets the region whose cells are held in the dense array. Any items
+	 * already put are moved into the new layout.
+	 *
+	 * @param bounds the region to store densely
+	 */
+	void init(const GridDimensions& bounds);
+
+	/**
+	 * Gets the first object found at the specified location.
+	 *
+	 * @param location the location to get the object at
+	 * @return the first object found at the specified location or 0 if there
+	 * are no objects at the specified location.
+	 */
+	T* get(const Point<GPType>& location) const;
+
+	/**
+	 * Gets all the items found at the specified location.
+	 *
+	 * @param location the location to get the items at
+	 * @param [out] the found items will be returned in this vector
+	 */
+	void getAll(const Point<GPType>& location, std::vector<T*>& out) const;
+
+	/**
+	 * Puts the specified item at the specified location.
+	 *
+	 * @param agent the item to put
+	 * @param location the location to put the item at
+	 */
+	bool put(boost::shared_ptr<T>& agent, const Point<GPType>& location);
+
+	/**
+	 * Removes the specified item from the specified location.
+	 *
+	 * @param agent the item to remove
+	 * @param location the location to remove the item from
+	 */
+	void remove(boost::shared_ptr<T>& agent, const Point<GPType>& location);
+
+};
+
+template<typename T, typename GPType>
+DenseOccupancy<T, GPType>::DenseOccupancy() :
+	cellCount(0), freeSlots(-1) {
+}
+
+template<typename T, typename GPType>
+void DenseOccupancy<T, GPType>::init(const GridDimensions& bounds) {
+	// collect what has already been put, to put back in the new layout
+	std::vector<std::pair<Point<GPType> , boost::shared_ptr<T> > > placed;
+	for (size_t index = 0; index < cells.size(); index++) {
+		std::vector<GPType> coords(origin.size(), 0);
+		for (size_t i = 0; i < origin.size(); i++) {
+			coords[i] = (GPType) (origin[i] + ((long) index / strides[i]) % extents[i]);
+		}
+		for (int slot = cells[index]; slot != -1; slot = slots[slot].next) {
+			placed.push_back(std::make_pair(Point<GPType> (coords), slots[slot].agent));
+		}
+	}
+	for (LocationMapIter iter = overflow.begin(); iter != overflow.end(); ++iter) {
+		for (size_t i = 0; i < iter->second.size(); i++) {
+			placed.push_back(std::make_pair(iter->first, iter->second[i]));
+		}
+	}
+	cells.clear();
+	slots.clear();
+	freeSlots = -1;
+	overflow.clear();
+
+	size_t dimCount = bounds.dimensionCount();
+	origin.assign(dimCount, 0);
+	extents.assign(dimCount, 0);
+	strides.assign(dimCount, 0);
+	cellCount = 1;
+	for (size_t i = 0; i < dimCount; i++) {
+		origin[i] = (long) bounds.origin(i);
+		extents[i] = (long) bounds.extents(i);
+		strides[i] = cellCount;
+		cellCount *= extents[i];
+	}
+	if (dimCount == 0) cellCount = 0;
+
+	for (size_t i = 0; i < placed.size(); i++) {
+		put(placed[i].second, placed[i].first);
+	}
+}
+
+template<typename T, typename GPType>
+void DenseOccupancy<T, GPType>::allocate() {
+	cells.assign(cellCount, -1);
+}
+
+template<typename T, typename GPType>
+long DenseOccupancy<T, GPType>::cellIndex(const Point<GPType>& location) const {
+	if (cells.empty() || location.dimensionCount() != origin.size())
+		return -1;
+	long index = 0;
+	for (size_t i = 0; i < origin.size(); i++) {
+		long offset = (long) location[i] - origin[i];
+		if (offset < 0 || offset >= extents[i])
+			return -1;
+		index += offset * strides[i];
+	}
+	return index;
+}
+
+template<typename T, typename GPType>
+T* DenseOccupancy<T, GPType>::get(const Point<GPType>& location) const {
+	long index = cellIndex(location);
+	if (index != -1) {
+		int slot = cells[index];
+		return slot == -1 ? NULL : slots[slot].agent.get();
+	}
+	LocationMapConstIter iter = overflow.find(location);
+	if (iter == overflow.end())
+		return NULL;
+	return iter->second.front().get();
+}
+
+template<typename T, typename GPType>
+void DenseOccupancy<T, GPType>::getAll(const Point<GPType>& location, std::vector<T*>& out) const {
+	long index = cellIndex(location);
+	if (index != -1) {
+		for (int slot = cells[index]; slot != -1; slot = slots[slot].next) {
+			out.push_back(slots[slot].agent.get());
+		}
+		return;
+	}
+	LocationMapConstIter iter = overflow.find(location);
+	if (iter != overflow.end()) {
+		for (size_t i = 0; i < iter->second.size(); i++) {
+			out.push_back(iter->second[i].get());
+		}
+	}
+}
+
+template<typename T, typename GPType>
+bool DenseOccupancy<T, GPType>::put(boost::shared_ptr<T>& agent, const Point<GPType>& location) {
+	if (cells.empty() && cellCount > 0)
+		allocate();
+
+	long index = cellIndex(location);
+	if (index == -1) {
+		ValueType& occupants = overflow[location];
+		for (size_t i = 0; i < occupants.size(); i++) {
+			if (occupants[i] == agent) return true;
+		}
+		occupants.push_back(agent);
+		return true;
+	}
+
+	// append to the end of the cell's list, unless the agent is already there
+	int* link = &cells[index];
+	while (*link != -1) {
+		if (slots[*link].agent == agent) return true;
+		link = &slots[*link].next;
+	}
+	int slot = freeSlots;
+	if (slot != -1) {
+		freeSlots = slots[slot].next;
+	} else {
+		slot = slots.size();
+		slots.push_back(Slot());
+		// the push may have moved the slots that link points into
+		link = &cells[index];
+		while (*link != -1) link = &slots[*link].next;
+	}
+	slots[slot].agent = agent;
+	slots[slot].next = -1;
+	*link = slot;
+	return true;
+}
+
+template<typename T, typename GPType>
+void DenseOccupancy<T, GPType>::remove(boost::shared_ptr<T>& agent, const Point<GPType>& location) {
+	long index = cellIndex(location);
+	if (index == -1) {
+		LocationMapIter iter = overflow.find(location);
+		if (iter != overflow.end()) {
+			ValueType& occupants = iter->second;
+			for (size_t i = 0; i < occupants.size(); i++) {
+				if (occupants[i] == agent) {
+					occupants.erase(occupants.begin() + i);
+					break;
+				}
+			}
+			if (occupants.empty()) overflow.erase(iter);
+		}
+		return;
+	}
+
+	for (int* link = &cells[index]; *link != -1; link = &slots[*link].next) {
+		int slot = *link;
+		if (slots[slot].agent == agent) {
+			*link = slots[slot].next;
+			slots[slot].agent.reset();
+			slots[slot].next = freeSlots;
+			freeSlots = slot;
+			return;
+		}
+	}
+}
+
+/**
+ * Sets the region of a DenseOccupancy used by a shared grid. If the process
+ * owns less than DENSE_OCCUPANCY_MIN_COVERAGE of the region, as it may when
+ * the grid is divided along a space-filling curve, the region is left empty
+ * and every location is held in the map, as in MultipleOccupancy, rather
+ * than allocating cells that belong to other processes.
+ *
+ * @param cells the cell accessor
+ * @param bounds the local bounds plus the buffer
+ * @param coverage the fraction of the local bounds that the process owns
+ */
+template<typename T, typename GPType>
+void initCellAccessor(DenseOccupancy<T, GPType>& cells, const GridDimensions& bounds, double coverage) {
+	cells.init(coverage < DENSE_OCCUPANCY_MIN_COVERAGE ? GridDimensions() : bounds);
+}
+
+}
+
+#endif /* DENSEOCCUPANCY_H_ */
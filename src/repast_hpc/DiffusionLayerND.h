@@ -42,8 +42,10 @@
 #define DIFFUSIONLAYERND_H_
 
 #include <fstream>
+#include <algorithm>
 #include <vector>
 #include <map>
+#include <cstdlib>
 
 #include "mpi.h"
 
@@ -117,6 +119,145 @@ int Diffusor<T>::getRadius(){
   return 1;
 }
 
+/**
+ * Compile-time integer power, used to size stencils
+ */
+template<int Exponent, int Base>
+struct IntPower{
+  enum { value = Base * IntPower<Exponent - 1, Base>::value };
+};
+
+template<int Base>
+struct IntPower<0, Base>{
+  enum { value = 1 };
+};
+
+/**
+ * A StencilDiffusor is a Diffusor whose new value for each cell is
+ * a fixed weighted sum of the values of the cells within its radius.
+ * The number of dimensions and the radius are template parameters, so
+ * that DiffusionLayerND::diffuse(const StencilDiffusor&) can sweep
+ * whole rows of the layer with loops the compiler can vectorize,
+ * rather than calling getNewValue for each cell. A StencilDiffusor
+ * can also be passed to diffuse(Diffusor<T>*), which gives the same
+ * results more slowly.
+ *
+ * Weights are indexed in the same order as the values passed to
+ * Diffusor::getNewValue: the order defined by a RelativeLocation of
+ * the stencil's radius, with the first dimension varying fastest.
+ *
+ * @tparam T the type of the layer's values
+ * @tparam N the number of dimensions of the layer
+ * @tparam R the radius of the stencil
+ */
+template<typename T, int N, int R = 1>
+class StencilDiffusor: public Diffusor<T>{
+
+public:
+  enum { SIDE = 2 * R + 1, SIZE = IntPower<N, 2 * R + 1>::value, CENTER = (IntPower<N, 2 * R + 1>::value - 1) / 2 };
+
+private:
+  T weights[SIZE];
+
+public:
+
+  /**
+   * Creates a stencil with all weights zero
+   */
+  StencilDiffusor(){
+    for(int i = 0; i < SIZE; i++) weights[i] = 0;
+  }
+
+  /**
+   * Creates a stencil with the specified weights, scaled by (1 - decay)
+   *
+   * @param coefficients the SIZE weights, in RelativeLocation order
+   * @param decay the fraction of each cell's new value that is lost
+   */
+  StencilDiffusor(const T* coefficients, T decay = 0){
+    for(int i = 0; i < SIZE; i++) weights[i] = coefficients[i] * (1 - decay);
+  }
+
+  virtual ~StencilDiffusor(){}
+
+  /**
+   * Creates a stencil in which each cell keeps (1 - rate) of its value
+   * and shares the rest equally among the other cells within the radius
+   * (its Moore neighborhood), after which (decay) of the new value is lost.
+   */
+  static StencilDiffusor moore(T rate, T decay = 0){
+    StencilDiffusor stencil;
+    for(int i = 0; i < SIZE; i++) stencil.weights[i] = rate / (SIZE - 1) * (1 - decay);
+    stencil.weights[CENTER] = (1 - rate) * (1 - decay);
+    return stencil;
+  }
+
+  /**
+   * Creates a stencil in which each cell keeps (1 - rate) of its value
+   * and shares the rest equally among the cells within a Manhattan distance
+   * of the radius (its von Neumann neighborhood), after which (decay) of
+   * the new value is lost.
+   */
+  static StencilDiffusor vonNeumann(T rate, T decay = 0){
+    StencilDiffusor stencil;
+    int count = 0;
+    for(int i = 0; i < SIZE; i++) if(i != CENTER && distance(i) <= R) count++;
+    for(int i = 0; i < SIZE; i++){
+      if(i != CENTER && distance(i) <= R) stencil.weights[i] = rate / count * (1 - decay);
+    }
+    stencil.weights[CENTER] = (1 - rate) * (1 - decay);
+    return stencil;
+  }
+
+  /**
+   * Creates a stencil for explicit diffusion by the discrete Laplacian:
+   * each cell's value v becomes v + coefficient * (sum of (u - v) over the
+   * 2N adjacent cells u), after which (decay) of the new value is lost.
+   */
+  static StencilDiffusor laplacian(T coefficient, T decay = 0){
+    StencilDiffusor stencil;
+    for(int i = 0; i < SIZE; i++){
+      if(i != CENTER && distance(i) == 1) stencil.weights[i] = coefficient * (1 - decay);
+    }
+    stencil.weights[CENTER] = (1 - 2 * N * coefficient) * (1 - decay);
+    return stencil;
+  }
+
+  /**
+   * Gets the Manhattan distance from the center of the stencil to the cell
+   * at the specified index
+   */
+  static int distance(int index){
+    int dist = 0;
+    for(int d = 0; d < N; d++, index /= SIDE) dist += std::abs(index % SIDE - R);
+    return dist;
+  }
+
+  /**
+   * Gets the weight of the cell at the specified index
+   */
+  T weight(int index) const {
+    return weights[index];
+  }
+
+  /**
+   * Sets the weight of the cell at the specified index
+   */
+  void weight(int index, T value){
+    weights[index] = value;
+  }
+
+  virtual int getRadius(){
+    return R;
+  }
+
+  virtual T getNewValue(T* values){
+    T sum = 0;
+    for(int i = 0; i < SIZE; i++) sum += weights[i] * values[i];
+    return sum;
+  }
+};
+
 /**
  * The DiffusionLayerND class is an N-dimensional layer of
  * double values that can be used to diffuse through an N-D
@@ -140,7 +281,9 @@ int Diffusor<T>::getRadius(){
  * the values in the buffer will be NaN values.
  *
  * The radius of diffusion must be less than or equal to
- * the size of the buffer zone.
+ * the size of the buffer zone. A buffer zone that is k
+ * times the radius allows diffuseSteps to perform k steps
+ * per synchronization.
  *
  */
 template<typename T>
@@ -170,8 +313,162 @@ public:
    */
   void diffuse(Diffusor<T>* diffusor, bool omitSynchronize = false);
 
+  /**
+   * Performs the diffusion operation on the entire grid (only within
+   * local boundaries) using a stencil. The result is the same as passing
+   * the stencil to diffuse(Diffusor<T>*), but each row of the local
+   * region is computed with one vectorizable pass per non-zero weight.
+   *
+   * @param stencil the stencil; its dimensions must match the layer's
+   * and its radius must not exceed the buffer size
+   * @param omitSynchronize If true, diffusion will be done but
+   * not synchronized across processes
+   */
+  template<int N, int R>
+  void diffuse(const StencilDiffusor<T, N, R>& stencil, bool omitSynchronize = false);
+
+  /**
+   * Performs the diffusion operation and the synchronization that
+   * must follow it, overlapping the two. The shell of local cells
+   * that adjacent processes will need (the outermost 'bufferSize'
+   * cells on each side) is computed first, and its exchange is posted;
+   * the interior cells, which depend only on local data, are computed
+   * while the messages are in transit. The result is the same as
+   * diffuse(diffusor).
+   *
+   * @param diffusor A pointer to an instance of a diffusor class
+   * that will contain the simulation-specific diffusion code
+   */
+  void diffuseAndSynchronize(Diffusor<T>* diffusor);
+
+  /**
+   * Performs the stencil diffusion operation and the synchronization
+   * that must follow it, overlapping the two as
+   * diffuseAndSynchronize(Diffusor<T>*) does.
+   *
+   * @param stencil the stencil; its dimensions must match the layer's
+   * and its radius must not exceed the buffer size
+   */
+  template<int N, int R>
+  void diffuseAndSynchronize(const StencilDiffusor<T, N, R>& stencil);
+
+  /**
+   * Performs the diffusion operation 'steps' times, synchronizing only
+   * once every bufferSize / radius steps. Within such a block the
+   * buffer zones shared with adjacent processes are diffused along with
+   * the local cells; each step leaves a valid region one radius narrower
+   * than the last, so a layer whose buffer size is k times the radius
+   * of diffusion needs one (wider) exchange per k steps instead of k
+   * exchanges. The result is the same as calling diffuse(diffusor)
+   * 'steps' times. The layer must be synchronized when this is called
+   * (as it is after any diffuse without omitSynchronize) and is
+   * synchronized on return.
+   *
+   * @param diffusor A pointer to an instance of a diffusor class
+   * that will contain the simulation-specific diffusion code
+   * @param steps the number of diffusion steps
+   */
+  void diffuseSteps(Diffusor<T>* diffusor, int steps);
+
+  /**
+   * Performs the stencil diffusion operation 'steps' times, synchronizing
+   * only once every bufferSize / R steps, as diffuseSteps(Diffusor<T>*, int)
+   * does.
+   *
+   * @param stencil the stencil; its dimensions must match the layer's
+   * and its radius must not exceed the buffer size
+   * @param steps the number of diffusion steps
+   */
+  template<int N, int R>
+  void diffuseSteps(const StencilDiffusor<T, N, R>& stencil, int steps);
+
 private:
 
+  /**
+   * The computation applied to each cell by a diffusion step: either a
+   * Diffusor, called through grabDimensionData, or (if diffusor is null)
+   * the non-zero weights of a stencil, as offsets from the central cell.
+   */
+  struct Kernel{
+    Diffusor<T>* diffusor;
+    vector<T>    vals;
+    vector<int>  offsets;
+    vector<T>    weights;
+    int          taps;
+    int          radius;
+  };
+
+  /**
+   * Row operation that applies a stencil kernel; rows are independent,
+   * so these are run on the process's ThreadPool (if there is one)
+   */
+  struct StencilRows{
+    const Kernel* kernel;
+    const T*      in;
+    T*            out;
+
+    void operator()(int index, const vector<int>& /* position */, int rowLength){
+      diffuseRow(in + index, out + index, rowLength, &kernel->offsets[0], &kernel->weights[0], kernel->taps);
+    }
+  };
+
+  /**
+   * Row operation that applies a Diffusor; Diffusors are user code that
+   * need not be thread-safe, so these are always run on the calling thread
+   */
+  struct DiffusorRows{
+    DiffusionLayerND<T>* layer;
+    Kernel*              kernel;
+    T*                   in;
+    T*                   out;
+
+    void operator()(int index, const vector<int>& position, int rowLength){
+      for(int x = 0; x < rowLength; x++){
+        T* destLocation = &kernel->vals[0]; // Note: This gets passed as a handle and changed
+        layer->grabDimensionData(destLocation, in + index + x, kernel->radius, position.size() - 1);
+        out[index + x] = kernel->diffusor->getNewValue(&kernel->vals[0]);
+      }
+    }
+  };
+
+  enum { TILE_BYTES = 1 << 18 }; // Target size of the rows a 3-D stencil tile keeps in cache
+
+  /**
+   * Sets up the kernel for a stencil
+   */
+  template<int N, int R>
+  void makeKernel(const StencilDiffusor<T, N, R>& stencil, Kernel& kernel);
+
+  /**
+   * Sets up the kernel for a Diffusor
+   */
+  void makeKernel(Diffusor<T>* diffusor, Kernel& kernel);
+
+  /**
+   * Applies the kernel to the local cells in the box [lower, upper),
+   * given in cells from the local origin, reading from 'in' and
+   * writing to 'out'. Stencil kernels are swept in cache tiles on
+   * the process's ThreadPool, if there is one.
+   */
+  void diffuseBox(Kernel& kernel, T* in, T* out, const vector<int>& lower, const vector<int>& upper);
+
+  /**
+   * Computes the shell, switches the data spaces, posts the exchange,
+   * computes the interior and waits for the exchange to complete.
+   */
+  void diffuseOverlapped(Kernel& kernel);
+
+  /**
+   * Performs 'steps' steps in blocks that each end with one synchronization
+   */
+  void diffuseBlocked(Kernel& kernel, int radius, int steps);
+
+  /**
+   * Computes one row of a stencil diffusion: out[x] is the sum of
+   * weights[k] * in[x + offsets[k]] for each of the taps.
+   */
+  static void diffuseRow(const T* in, T* out, int rowLength, const int* offsets, const T* weights, int taps);
+
   /**
    * Diffuse across one of the dimensions. Note that this is called
    * recursively.
@@ -210,6 +507,191 @@ void DiffusionLayerND<T>::diffuse(Diffusor<T>* diffusor, bool omitSynchronize){
   delete[] vals;
 }
 
+template<typename T>
+template<int N, int R>
+void DiffusionLayerND<T>::diffuse(const StencilDiffusor<T, N, R>& stencil, bool omitSynchronize){
+  Kernel kernel;
+  makeKernel(stencil, kernel);
+
+  vector<int> lower(N, 0);
+  vector<int> upper(N);
+  for(int d = 0; d < N; d++) upper[d] = AbstractValueLayerND<T>::dimensionData[d].localWidth;
+  diffuseBox(kernel, ValueLayerNDSU<T>::currentDataSpace, ValueLayerNDSU<T>::otherDataSpace, lower, upper);
+
+  this->switchValueLayer();
+
+  if(!omitSynchronize) this->synchronize();
+}
+
+template<typename T>
+void DiffusionLayerND<T>::diffuseAndSynchronize(Diffusor<T>* diffusor){
+  Kernel kernel;
+  makeKernel(diffusor, kernel);
+  diffuseOverlapped(kernel);
+}
+
+template<typename T>
+template<int N, int R>
+void DiffusionLayerND<T>::diffuseAndSynchronize(const StencilDiffusor<T, N, R>& stencil){
+  Kernel kernel;
+  makeKernel(stencil, kernel);
+  diffuseOverlapped(kernel);
+}
+
+template<typename T>
+void DiffusionLayerND<T>::diffuseSteps(Diffusor<T>* diffusor, int steps){
+  Kernel kernel;
+  makeKernel(diffusor, kernel);
+  diffuseBlocked(kernel, diffusor->getRadius(), steps);
+}
+
+template<typename T>
+template<int N, int R>
+void DiffusionLayerND<T>::diffuseSteps(const StencilDiffusor<T, N, R>& stencil, int steps){
+  Kernel kernel;
+  makeKernel(stencil, kernel);
+  diffuseBlocked(kernel, R, steps);
+}
+
+template<typename T>
+template<int N, int R>
+void DiffusionLayerND<T>::makeKernel(const StencilDiffusor<T, N, R>& stencil, Kernel& kernel){
+  if(N != AbstractValueLayerND<T>::numDims || R > AbstractValueLayerND<T>::bufferSize)
+    throw Repast_Error_59(N, R, AbstractValueLayerND<T>::numDims, AbstractValueLayerND<T>::bufferSize); // Stencil does not fit this layer
+
+  const vector<int>& places = AbstractValueLayerND<T>::places;
+
+  // Offsets (from the central cell) and weights of the stencil's non-zero weights
+  kernel.diffusor = 0;
+  kernel.radius   = R;
+  kernel.offsets.resize(StencilDiffusor<T, N, R>::SIZE);
+  kernel.weights.resize(StencilDiffusor<T, N, R>::SIZE);
+  kernel.taps = 0;
+  for(int k = 0; k < StencilDiffusor<T, N, R>::SIZE; k++){
+    if(stencil.weight(k) == 0) continue;
+    int offset = 0;
+    for(int d = 0, rest = k; d < N; d++, rest /= StencilDiffusor<T, N, R>::SIDE) offset += (rest % StencilDiffusor<T, N, R>::SIDE - R) * places[d];
+    kernel.offsets[kernel.taps] = offset;
+    kernel.weights[kernel.taps] = stencil.weight(k);
+    kernel.taps++;
+  }
+}
+
+template<typename T>
+void DiffusionLayerND<T>::makeKernel(Diffusor<T>* diffusor, Kernel& kernel){
+  kernel.diffusor = diffusor;
+  kernel.radius   = diffusor->getRadius();
+  kernel.vals.resize((int)(pow(diffusor->getRadius() * 2 + 1, AbstractValueLayerND<T>::numDims)));
+  kernel.taps = 0;
+}
+
+template<typename T>
+void DiffusionLayerND<T>::diffuseBox(Kernel& kernel, T* in, T* out, const vector<int>& lower, const vector<int>& upper){
+  if(kernel.diffusor != 0){
+    DiffusorRows rows;
+    rows.layer  = this;
+    rows.kernel = &kernel;
+    rows.in     = in;
+    rows.out    = out;
+    AbstractValueLayerND<T>::forEachRow(lower, upper, rows);
+    return;
+  }
+
+  // Each row reads 2R + 1 rows in each of the 2R + 1 neighboring planes;
+  // tiles are sized so that the rows they read stay in cache from one plane to the next
+  int rowBytes = AbstractValueLayerND<T>::dimensionData[0].width * sizeof(T);
+  int tileRows = std::max(1, (int)TILE_BYTES / ((2 * kernel.radius + 1) * rowBytes) - 2 * kernel.radius);
+
+  StencilRows rows;
+  rows.kernel = &kernel;
+  rows.in     = in;
+  rows.out    = out;
+  vector<StencilRows> rowOps(1, rows);
+  AbstractValueLayerND<T>::parallelSweep(lower, upper, rowOps, tileRows);
+}
+
+template<typename T>
+void DiffusionLayerND<T>::diffuseOverlapped(Kernel& kernel){
+  int numDims    = AbstractValueLayerND<T>::numDims;
+  int bufferSize = AbstractValueLayerND<T>::bufferSize;
+
+  // The interior is every local cell at least 'bufferSize' cells from the
+  // local edges; it is never sent, and (because the radius of diffusion
+  // cannot exceed the buffer size) never reads the buffer zones
+  vector<int> width(numDims), lower(numDims), upper(numDims);
+  for(int d = 0; d < numDims; d++){
+    width[d] = AbstractValueLayerND<T>::dimensionData[d].localWidth;
+    lower[d] = std::min(bufferSize, width[d]);
+    upper[d] = std::max(lower[d], width[d] - bufferSize);
+  }
+
+  // The shell is covered by two slabs per dimension; each slab spans the
+  // whole local width in lower dimensions and the interior in higher ones
+  vector<int> boxLower(numDims), boxUpper(numDims);
+  for(int d = 0; d < numDims; d++){
+    for(int e = 0; e < numDims; e++){
+      boxLower[e] = (e > d ? lower[e] : 0);
+      boxUpper[e] = (e > d ? upper[e] : width[e]);
+    }
+    boxUpper[d] = lower[d];
+    diffuseBox(kernel, ValueLayerNDSU<T>::currentDataSpace, ValueLayerNDSU<T>::otherDataSpace, boxLower, boxUpper);
+    boxLower[d] = upper[d];
+    boxUpper[d] = width[d];
+    diffuseBox(kernel, ValueLayerNDSU<T>::currentDataSpace, ValueLayerNDSU<T>::otherDataSpace, boxLower, boxUpper);
+  }
+
+  // The new values become current; their shell is sent while the interior is computed
+  this->switchValueLayer();
+  AbstractValueLayerND<T>::startSynchronization(ValueLayerNDSU<T>::currentDataSpace);
+  diffuseBox(kernel, ValueLayerNDSU<T>::otherDataSpace, ValueLayerNDSU<T>::currentDataSpace, lower, upper);
+  AbstractValueLayerND<T>::finishSynchronization();
+}
+
+template<typename T>
+void DiffusionLayerND<T>::diffuseBlocked(Kernel& kernel, int radius, int steps){
+  int numDims    = AbstractValueLayerND<T>::numDims;
+  int bufferSize = AbstractValueLayerND<T>::bufferSize;
+  if(radius > bufferSize) throw Repast_Error_60(radius, bufferSize); // Buffer zone too narrow for the radius of diffusion
+
+  const vector<DimensionDatum<T> >& dims = AbstractValueLayerND<T>::dimensionData;
+  int stepsPerSync = (radius == 0 ? steps : bufferSize / radius);
+
+  vector<int> lower(numDims), upper(numDims);
+  int step = 0;
+  while(step < steps){
+    int blockSteps = std::min(stepsPerSync, steps - step);
+    for(int j = 1; j <= blockSteps; j++){
+      // Only the cells the remaining steps of the block will read are computed;
+      // buffer zones at non-periodic global edges keep their fixed values
+      int margin = (blockSteps - j) * radius;
+      for(int d = 0; d < numDims; d++){
+        lower[d] = (dims[d].spaceContinuesLeft ? -margin : 0);
+        upper[d] = dims[d].localWidth + (dims[d].spaceContinuesRight ? margin : 0);
+      }
+      diffuseBox(kernel, ValueLayerNDSU<T>::currentDataSpace, ValueLayerNDSU<T>::otherDataSpace, lower, upper);
+      this->switchValueLayer();
+    }
+    this->synchronize();
+    step += blockSteps;
+  }
+}
+
+template<typename T>
+void DiffusionLayerND<T>::diffuseRow(const T* in, T* out, int rowLength, const int* offsets, const T* weights, int taps){
+  if(taps == 0){
+    for(int x = 0; x < rowLength; x++) out[x] = 0;
+    return;
+  }
+  const T* src = in + offsets[0];
+  T weight = weights[0];
+  for(int x = 0; x < rowLength; x++) out[x] = weight * src[x];
+  for(int k = 1; k < taps; k++){
+    src = in + offsets[k];
+    weight = weights[k];
+    for(int x = 0; x < rowLength; x++) out[x] += weight * src[x];
+  }
+}
+
 template<typename T>
 void DiffusionLayerND<T>::diffuseDimension(T* currentDataSpacePointer, T* otherDataSpacePointer, T* vals, Diffusor<T>* diffusor, int dimIndex){
   int bufferEdge = AbstractValueLayerND<T>::dimensionData[dimIndex].leftBufferSize;
@@ -72,7 +72,7 @@ template<typename V, typename E, typename Ec, typename EcM>
 class Graph: public Projection<V> {
 
 protected:
-  typedef boost::unordered_map<AgentId, Vertex<V, E>*, HashId> VertexMap;
+  typedef AgentIdMap<Vertex<V, E>*> VertexMap;
   typedef typename VertexMap::iterator VertexMapIterator;
 
   typedef typename Projection<V>::RADIUS RADIUS;
@@ -45,6 +45,8 @@
 #include <boost/shared_ptr.hpp>
 
 #include "Point.h"
+#include "GridDimensions.h"
+#include "AgentIdMap.h"
 
 namespace repast {
 
@@ -54,8 +56,8 @@ namespace repast {
  */
 template<typename T>
 struct ExtractPtrs: public std::unary_function<
-		typename boost::unordered_map<AgentId, boost::shared_ptr<T> >::value_type, T*> {
-	T* operator()(typename boost::unordered_map<AgentId, boost::shared_ptr<T> >::value_type& val) {
+		typename AgentIdMap<boost::shared_ptr<T> >::value_type, T*> {
+	T* operator()(typename AgentIdMap<boost::shared_ptr<T> >::value_type& val) {
 		return val.second.get();
 	}
 };
@@ -72,7 +74,7 @@ template<typename T, typename GPType>
 class MultipleOccupancy {
 
 private:
-	typedef typename boost::unordered_map<AgentId, boost::shared_ptr<T>, HashId> ValueType;
+	typedef AgentIdMap<boost::shared_ptr<T> > ValueType;
 	typedef typename ValueType::iterator ValueTypeIter;
 	typedef typename boost::unordered_map<Point<GPType> , ValueType*, HashGridPoint<GPType> > LocationMap;
 
@@ -87,6 +89,13 @@ public:
 
 	virtual ~MultipleOccupancy();
 
+	/**
+	 * Sets the bounds of the grid this accessor is used by. MultipleOccupancy
+	 * does not depend on the bounds, so this does nothing.
+	 */
+	void init(const GridDimensions& bounds) {
+	}
+
 	/**
 	 * Gets the first object found at the specified location.
 	 *
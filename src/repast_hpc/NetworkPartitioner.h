@@ -0,0 +1,312 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  NetworkPartitioner.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jtm
+ */
+
+#ifndef NETWORKPARTITIONER_H_
+#define NETWORKPARTITIONER_H_
+
+#include <vector>
+#include <algorithm>
+
+#include <boost/unordered_map.hpp>
+#include <boost/mpi.hpp>
+
+#include "AgentId.h"
+#include "AgentRequest.h"
+#include "RepastProcess.h"
+#include "SharedNetwork.h"
+
+namespace repast {
+
+/**
+ * The partition label of a vertex, exchanged between processes
+ * while a network is partitioned.
+ */
+struct VertexLabel {
+	AgentId id;
+	int label;
+
+	AgentId getId() const {
+		return id;
+	}
+
+	template<class Archive>
+	void serialize(Archive& ar, const unsigned int) {
+		ar & id;
+		ar & label;
+	}
+};
+
+/**
+ * Places the vertices of a SharedNetwork on processes so that few edges
+ * cross processes, subject to a balance constraint.
+ *
+ * The partitioner uses balanced label propagation: every local vertex is
+ * labeled with its current process, and in each round each vertex adopts the
+ * label held by most of its neighbors if that is an improvement. Moves
+ * toward a process are only accepted up to that process's capacity, which is
+ * (1 + imbalance) times the mean number of vertices per process; vertices
+ * with the largest gain are accepted first. To avoid pairs of vertices
+ * swapping back and forth, even rounds only move vertices to higher-numbered
+ * processes and odd rounds to lower-numbered ones. The labels of non-local
+ * vertices are kept current with RepastProcess::synchronizeAgentStates, so
+ * the usual agent requests must have been made (as they are when a
+ * network is built across processes).
+ *
+ * Each round reduces two arrays with one entry per process (the requested
+ * moves and the vertex counts by destination) with MPI_Allreduce and
+ * MPI_Exscan, so a round costs O(P) in the number of processes P even when
+ * each process only trades vertices with a few neighbors. This is intended
+ * for occasional repartitioning, not for every time step on large runs.
+ *
+ * When the labels settle, vertices are marked for moving with
+ * RepastProcess::moveAgent. The caller must then call
+ * RepastProcess::synchronizeAgentStatus, which moves the agents and their
+ * edges. Typical use, after the network has been built:
+ *
+ * <code>
+ *  NetworkPartitioner<Node, RepastEdge<Node>, EdgeContent, EdgeContentManager> partitioner(net);
+ *  partitioner.partition();
+ *  RepastProcess::instance()->synchronizeAgentStatus<Node, NodeContent, Model, Model, Model>(context, model, model, model);
+ * </code>
+ *
+ * @tparam V the agent (vertex) type
+ * @tparam E the edge type
+ * @tparam Ec the edge content type
+ * @tparam EcM the edge content manager type
+ */
+template<typename V, typename E, typename Ec, typename EcM>
+class NetworkPartitioner {
+
+private:
+	typedef boost::unordered_map<AgentId, int, HashId> LabelMap;
+
+	SharedNetwork<V, E, Ec, EcM>* net;
+	LabelMap labels;          // Labels of the local vertices
+	LabelMap foreignLabels;   // Labels of the non-local vertices
+
+	int labelOf(const AgentId& id);
+
+	struct CompareGain {
+		bool operator()(const std::pair<int, V*>& one, const std::pair<int, V*>& other) const {
+			return one.first > other.first;
+		}
+	};
+
+public:
+
+	/**
+	 * Creates a NetworkPartitioner for the specified network.
+	 *
+	 * @param network the network to be partitioned
+	 */
+	NetworkPartitioner(SharedNetwork<V, E, Ec, EcM>* network) : net(network) {}
+	virtual ~NetworkPartitioner() {}
+
+	/**
+	 * Computes a placement for the local vertices and marks those that
+	 * should be on another process with RepastProcess::moveAgent. This is a
+	 * collective call.
+	 *
+	 * @param maxRounds the maximum number of label propagation rounds
+	 * @param imbalance the permitted excess of vertices on any process over
+	 * the mean, as a fraction of the mean
+	 *
+	 * @return the number of vertices (across all processes) that were marked
+	 * for moving
+	 */
+	int partition(int maxRounds = 10, double imbalance = 0.05);
+
+	/**
+	 * Counts the edges of the local vertices, and the edges of those that
+	 * lead to vertices that are on another process.
+	 *
+	 * @param [out] edges the number of edges of local vertices
+	 * @param [out] cutEdges the number of those edges that cross processes
+	 */
+	void countEdges(int& edges, int& cutEdges);
+
+	/**
+	 * NON USER API. Provides the labels of the requested local vertices.
+	 */
+	void provideContent(const AgentRequest& req, std::vector<VertexLabel>& out);
+
+	/**
+	 * NON USER API. Records the label of a non-local vertex.
+	 */
+	void updateAgent(const VertexLabel& content);
+};
+
+template<typename V, typename E, typename Ec, typename EcM>
+int NetworkPartitioner<V, E, Ec, EcM>::labelOf(const AgentId& id) {
+	typename LabelMap::iterator iter = labels.find(id);
+	if (iter != labels.end()) return iter->second;
+	iter = foreignLabels.find(id);
+	return (iter != foreignLabels.end() ? iter->second : id.currentRank());
+}
+
+template<typename V, typename E, typename Ec, typename EcM>
+void NetworkPartitioner<V, E, Ec, EcM>::provideContent(const AgentRequest& req, std::vector<VertexLabel>& out) {
+	const std::vector<AgentId>& ids = req.requestedAgents();
+	for (size_t i = 0; i < ids.size(); i++) {
+		VertexLabel content = { ids[i], labelOf(ids[i]) };
+		out.push_back(content);
+	}
+}
+
+template<typename V, typename E, typename Ec, typename EcM>
+void NetworkPartitioner<V, E, Ec, EcM>::updateAgent(const VertexLabel& content) {
+	foreignLabels[content.id] = content.label;
+}
+
+template<typename V, typename E, typename Ec, typename EcM>
+int NetworkPartitioner<V, E, Ec, EcM>::partition(int maxRounds, double imbalance) {
+	RepastProcess* rp = RepastProcess::instance();
+	boost::mpi::communicator* comm = rp->getCommunicator();
+	int rank = rp->rank();
+	int worldSize = rp->worldSize();
+
+	labels.clear();
+	foreignLabels.clear();
+	std::vector<V*> localVertices;
+	for (typename Graph<V, E, Ec, EcM>::vertex_iterator iter = net->verticesBegin(); iter != net->verticesEnd(); ++iter) {
+		V* vertex = *iter;
+		if (vertex->getId().currentRank() == rank) {
+			localVertices.push_back(vertex);
+			labels[vertex->getId()] = rank;
+		}
+	}
+
+	int localCount = localVertices.size();
+	int totalCount;
+	boost::mpi::all_reduce(*comm, localCount, totalCount, std::plus<int>());
+	double capacity = (1 + imbalance) * totalCount / worldSize;
+
+	std::vector<V*> adjacent;
+	std::vector<int> scores(worldSize, 0);
+	int idleRounds = 0;
+	for (int round = 0; round < maxRounds && idleRounds < 2; round++) {
+		bool upward = (round % 2 == 0);
+
+		// Find the label preferred by each local vertex: the one held by most of its neighbors
+		std::vector<std::vector<std::pair<int, V*> > > candidates(worldSize); // (gain, vertex) by destination
+		std::vector<int> sizes(worldSize, 0);
+		for (size_t i = 0; i < localVertices.size(); i++) {
+			V* vertex = localVertices[i];
+			int current = labels[vertex->getId()];
+			sizes[current]++;
+			adjacent.clear();
+			net->adjacent(vertex, adjacent);
+			if (adjacent.empty()) continue;
+			for (size_t j = 0; j < adjacent.size(); j++) scores[labelOf(adjacent[j]->getId())]++;
+			int best = current;
+			for (size_t j = 0; j < adjacent.size(); j++) {
+				int label = labelOf(adjacent[j]->getId());
+				if ((upward ? label > current : label < current) && scores[label] > scores[best]) best = label;
+			}
+			if (best != current) candidates[best].push_back(std::make_pair(scores[best] - scores[current], vertex));
+			for (size_t j = 0; j < adjacent.size(); j++) scores[labelOf(adjacent[j]->getId())] = 0;
+		}
+
+		// Admit moves to each destination up to its capacity; lower ranks' requests are admitted first
+		// The requests and the sizes are reduced together: [0, worldSize) holds requests, [worldSize, 2 * worldSize) sizes
+		std::vector<int> requested(2 * worldSize), totals(2 * worldSize), earlierRequested(worldSize, 0);
+		for (int d = 0; d < worldSize; d++) {
+			requested[d] = candidates[d].size();
+			requested[worldSize + d] = sizes[d];
+		}
+		MPI_Allreduce(&requested[0], &totals[0], 2 * worldSize, MPI_INT, MPI_SUM, *comm);
+		MPI_Exscan(&requested[0], &earlierRequested[0], worldSize, MPI_INT, MPI_SUM, *comm);
+		if (rank == 0) std::fill(earlierRequested.begin(), earlierRequested.end(), 0); // Undefined on rank 0
+
+		int moved = 0;
+		for (int d = 0; d < worldSize; d++) {
+			if (requested[d] == 0) continue;
+			int room = (int) (capacity - totals[worldSize + d]);
+			int quota = std::min(requested[d], std::max(0, room - earlierRequested[d]));
+			if (quota == 0) continue;
+			std::stable_sort(candidates[d].begin(), candidates[d].end(), CompareGain());
+			for (int i = 0; i < quota; i++) labels[candidates[d][i].second->getId()] = d;
+			moved += quota;
+		}
+
+		int totalMoved;
+		boost::mpi::all_reduce(*comm, moved, totalMoved, std::plus<int>());
+		if (totalMoved == 0) {
+			idleRounds++; // Stop once neither direction has moves
+			continue;
+		}
+		idleRounds = 0;
+		rp->synchronizeAgentStates<VertexLabel, NetworkPartitioner<V, E, Ec, EcM>, NetworkPartitioner<V, E, Ec, EcM> >(*this, *this);
+	}
+
+	int marked = 0;
+	for (size_t i = 0; i < localVertices.size(); i++) {
+		const AgentId& id = localVertices[i]->getId();
+		int label = labels[id];
+		if (label != rank) {
+			rp->moveAgent(id, label);
+			marked++;
+		}
+	}
+	int totalMarked;
+	boost::mpi::all_reduce(*comm, marked, totalMarked, std::plus<int>());
+	return totalMarked;
+}
+
+template<typename V, typename E, typename Ec, typename EcM>
+void NetworkPartitioner<V, E, Ec, EcM>::countEdges(int& edges, int& cutEdges) {
+	int rank = RepastProcess::instance()->rank();
+	edges = 0;
+	cutEdges = 0;
+	std::vector<V*> adjacent;
+	for (typename Graph<V, E, Ec, EcM>::vertex_iterator iter = net->verticesBegin(); iter != net->verticesEnd(); ++iter) {
+		V* vertex = *iter;
+		if (vertex->getId().currentRank() != rank) continue;
+		adjacent.clear();
+		net->adjacent(vertex, adjacent);
+		for (size_t j = 0; j < adjacent.size(); j++) {
+			edges++;
+			if (adjacent[j]->getId().currentRank() != rank) cutEdges++;
+		}
+	}
+}
+
+}
+
+#endif /* NETWORKPARTITIONER_H_ */
@@ -0,0 +1,138 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Profiler.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jtm
+ */
+
+#include <fstream>
+#include <typeinfo>
+#include <cstdlib>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+#include "Profiler.h"
+#include "Schedule.h"
+#include "ThreadPool.h"
+
+namespace repast {
+
+Profiler* Profiler::_instance = 0;
+
+namespace {
+
+std::string escape(const std::string& str) {
+	std::string out;
+	for (size_t i = 0; i < str.size(); i++) {
+		if (str[i] == '"' || str[i] == '\\') out += '\\';
+		out += str[i];
+	}
+	return out;
+}
+
+}
+
+Profiler::Profiler(int r, double e) : rank(r), epoch(e), tick(0) {
+}
+
+Profiler* Profiler::enable(boost::mpi::communicator* comm) {
+	comm->barrier();
+	delete _instance;
+	_instance = new Profiler(comm->rank(), now());
+	return _instance;
+}
+
+void Profiler::disable() {
+	delete _instance;
+	_instance = 0;
+}
+
+void Profiler::setName(const Functor* functor, const std::string& name) {
+	std::lock_guard<std::mutex> guard(lock);
+	functorNames.insert(std::make_pair(functor, name));
+}
+
+double Profiler::phase(const char* category, const char* name, double begin) {
+	double end = now();
+	Record record = { category, name, false, tick, begin, end, ThreadPool::threadIndex() };
+	std::lock_guard<std::mutex> guard(lock);
+	records.push_back(record);
+	return end;
+}
+
+void Profiler::functor(const Functor* functor, double begin, double end) {
+	Record record = { "functor", typeid(*functor).name(), true, tick, begin, end, ThreadPool::threadIndex() };
+	std::lock_guard<std::mutex> guard(lock);
+	if (!functorNames.empty()) {
+		std::map<const Functor*, std::string>::const_iterator iter = functorNames.find(functor);
+		if (iter != functorNames.end()) {
+			record.name = iter->second.c_str();
+			record.mangled = false;
+		}
+	}
+	records.push_back(record);
+}
+
+std::string Profiler::demangle(const char* name) {
+#ifdef __GNUG__
+	int status = 0;
+	char* demangled = abi::__cxa_demangle(name, 0, 0, &status);
+	if (status == 0 && demangled != 0) {
+		std::string result(demangled);
+		std::free(demangled);
+		return result;
+	}
+#endif
+	return name;
+}
+
+void Profiler::write(const std::string& file) {
+	std::lock_guard<std::mutex> guard(lock);
+	std::ofstream out(file.c_str());
+	out.precision(15);
+	out << "{\"traceEvents\":[\n";
+	for (size_t i = 0; i < records.size(); i++) {
+		const Record& r = records[i];
+		std::string name = (r.mangled ? demangle(r.name) : std::string(r.name));
+		out << (i == 0 ? "" : ",\n") << "{\"name\":\"" << escape(name) << "\",\"cat\":\"" << r.category
+				<< "\",\"ph\":\"X\",\"ts\":" << (r.begin - epoch) * 1e6 << ",\"dur\":" << (r.end - r.begin) * 1e6
+				<< ",\"pid\":" << rank << ",\"tid\":" << r.thread << ",\"args\":{\"tick\":" << r.tick << "}}";
+	}
+	out << "\n]}\n";
+}
+
+}
@@ -0,0 +1,170 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  Profiler.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jtm
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+#include <mpi.h>
+#include <boost/mpi/communicator.hpp>
+
+namespace repast {
+
+class Functor;
+
+/**
+ * Opt-in instrumentation of a simulation run. When enabled, the ScheduleRunner
+ * records the wall time of every scheduled functor it executes and the time it
+ * spends waiting in the collective that agrees on the next tick, and
+ * RepastProcess records the time spent in each phase of its synchronization
+ * methods (discovering partners, packing and posting, waiting for MPI, and
+ * unpacking).
+ *
+ * Each process writes its own trace in the Chrome trace event JSON format
+ * (one 'complete' event per record, with the process rank as the pid and the
+ * pool thread as the tid); scripts/merge_profiles.py combines the per-process
+ * files into one trace after the run.
+ *
+ * When profiling is not enabled, instance() returns 0 and the instrumented code
+ * does nothing but test that pointer.
+ */
+class Profiler {
+
+private:
+	struct Record {
+		const char* category;
+		const char* name;
+		bool mangled;
+		double tick;
+		double begin;
+		double end;
+		unsigned int thread;
+	};
+
+	static Profiler* _instance;
+
+	int rank;
+	double epoch;
+	double tick;
+	std::vector<Record> records;
+	std::map<const Functor*, std::string> functorNames;
+	std::mutex lock;
+
+	Profiler(int rank, double epoch);
+
+	static std::string demangle(const char* name);
+
+public:
+	/**
+	 * Starts profiling on this process. This is collective over comm, so
+	 * that all processes' traces share a common time origin.
+	 *
+	 * @param comm the communicator of the processes being profiled
+	 *
+	 * @return the Profiler
+	 */
+	static Profiler* enable(boost::mpi::communicator* comm);
+
+	/**
+	 * Stops profiling on this process, discarding anything recorded.
+	 */
+	static void disable();
+
+	/**
+	 * Gets the Profiler, or 0 if profiling is not enabled.
+	 */
+	static Profiler* instance() {
+		return _instance;
+	}
+
+	/**
+	 * Gets the current wall clock time in seconds.
+	 */
+	static double now() {
+		return MPI_Wtime();
+	}
+
+	/**
+	 * Sets the tick that is recorded with subsequent records.
+	 */
+	void setTick(double t) {
+		tick = t;
+	}
+
+	/**
+	 * Sets the name under which the specified functor's executions are
+	 * reported. By default the functor's type name is used. Only the first
+	 * name set for a functor is used.
+	 */
+	void setName(const Functor* functor, const std::string& name);
+
+	/**
+	 * Records a span of time spent in the named phase of an operation.
+	 *
+	 * @param category the operation, e.g. "synchronizeAgentStates"; must be a string literal
+	 * @param name the phase, e.g. "wait"; must be a string literal
+	 * @param begin the start of the phase, as returned by now()
+	 *
+	 * @return the end of the phase, which can be used as the start of the next one
+	 */
+	double phase(const char* category, const char* name, double begin);
+
+	/**
+	 * Records an execution of a scheduled functor. This may be called
+	 * from threads in a ThreadPool.
+	 */
+	void functor(const Functor* functor, double begin, double end);
+
+	/**
+	 * Writes everything recorded by this process to the specified file
+	 * as a JSON trace.
+	 *
+	 * @param file the path of the file to write
+	 */
+	void write(const std::string& file);
+};
+
+}
+
+#endif /* PROFILER_H_ */
@@ -70,6 +70,19 @@ Random* Random::instance() {
 	return instance_;
 }
 
+Random* Random::createStream(uint32_t seed) {
+	return new Random(seed);
+}
+
+uint32_t Random::streamSeed(uint32_t seed, uint32_t stream) {
+	// splitmix64 finalizer
+	uint64_t z = ((uint64_t) seed << 32 | stream) + 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z = z ^ (z >> 31);
+	return (uint32_t) (z ^ (z >> 32));
+}
+
 /**
  * inclusive of from, exclusive of to.
  */
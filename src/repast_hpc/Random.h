@@ -124,6 +124,9 @@ typedef DefaultNumberGenerator<_LogNormalGenerator> LogNormalGenerator;
 
 /**
  * Methods for working with random distributions, draws etc.
+ * The draws come from a single engine per process, so they depend on the
+ * order of the draws and thus on how a model is decomposed; RandomStream
+ * provides streams that do not.
  */
 class Random {
 
@@ -155,6 +158,28 @@ public:
 	static Random* instance();
 	virtual ~Random();
 
+	/**
+	 * Creates a new Random with the specified seed that is independent
+	 * of the singleton instance. This is intended for code that cannot
+	 * share the singleton, such as work running on other threads. The
+	 * caller owns the returned Random.
+	 *
+	 * @param seed the seed of the new Random's engine
+	 */
+	static Random* createStream(boost::uint32_t seed);
+
+	/**
+	 * Derives a seed for an independent stream from a base seed and a
+	 * stream number, by hashing them together so that nearby
+	 * stream numbers produce unrelated seeds.
+	 *
+	 * @param seed the base seed
+	 * @param stream the stream number
+	 *
+	 * @return the seed for the stream
+	 */
+	static boost::uint32_t streamSeed(boost::uint32_t seed, boost::uint32_t stream);
+
 	/**
 	 * Puts the named generator into this Random. Added
 	 * generators will be deleted by Random when it is destroyed.
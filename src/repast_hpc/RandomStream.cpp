@@ -0,0 +1,149 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  RandomStream.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: jtm
+ */
+
+#include "RandomStream.h"
+
+#include <cstring>
+
+namespace repast {
+
+using namespace boost;
+
+namespace {
+
+const uint32_t PHILOX_M0 = 0xD2511F53u;
+const uint32_t PHILOX_M1 = 0xCD9E8D57u;
+const uint32_t PHILOX_W0 = 0x9E3779B9u;
+const uint32_t PHILOX_W1 = 0xBB67AE85u;
+
+uint32_t tickWord(double tick) {
+	uint64_t bits;
+	std::memcpy(&bits, &tick, sizeof(bits));
+	return Random::streamSeed((uint32_t) (bits >> 32), (uint32_t) bits);
+}
+
+}
+
+Philox4x32::Philox4x32(uint32_t key0, uint32_t key1, uint32_t stream0, uint32_t stream1, uint32_t stream2) :
+		index(4) {
+	key[0] = key0;
+	key[1] = key1;
+	counter[0] = 0;
+	counter[1] = stream0;
+	counter[2] = stream1;
+	counter[3] = stream2;
+}
+
+void Philox4x32::encrypt(uint32_t ctr[4], const uint32_t k[2]) {
+	uint32_t k0 = k[0], k1 = k[1];
+	for (int round = 0; round < 10; round++) {
+		uint64_t p0 = (uint64_t) PHILOX_M0 * ctr[0];
+		uint64_t p1 = (uint64_t) PHILOX_M1 * ctr[2];
+		uint32_t c0 = (uint32_t) (p1 >> 32) ^ ctr[1] ^ k0;
+		uint32_t c2 = (uint32_t) (p0 >> 32) ^ ctr[3] ^ k1;
+		ctr[0] = c0;
+		ctr[1] = (uint32_t) p1;
+		ctr[2] = c2;
+		ctr[3] = (uint32_t) p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+}
+
+void Philox4x32::generate() {
+	for (int i = 0; i < 4; i++)
+		block[i] = counter[i];
+	encrypt(block, key);
+	counter[0]++;
+	index = 0;
+}
+
+void Philox4x32::discard(uint64_t n) {
+	uint64_t available = 4 - index;
+	if (n < available) {
+		index += (unsigned int) n;
+		return;
+	}
+	n -= available;
+	// the block after the current one is counter[0]
+	counter[0] += (uint32_t) (n / 4);
+	generate();
+	index = (unsigned int) (n % 4);
+}
+
+RandomStream::RandomStream(const AgentId& id, double tick, uint32_t purpose) :
+		rng(Random::instance()->seed(), Random::streamSeed(purpose, id.agentType()), id.id(), id.startingRank(),
+				tickWord(tick)), uniGen(rng, uniform_real<>(0, 1)) {
+}
+
+RandomStream::RandomStream(uint32_t seed, const AgentId& id, double tick, uint32_t purpose) :
+		rng(seed, Random::streamSeed(purpose, id.agentType()), id.id(), id.startingRank(), tickWord(tick)), uniGen(rng,
+				uniform_real<>(0, 1)) {
+}
+
+StreamDoubleUniformGenerator RandomStream::createUniDoubleGenerator(double from, double to) {
+	return StreamDoubleUniformGenerator(_StreamRealUniformGenerator(rng, uniform_real<>(from, to)));
+}
+
+StreamIntUniformGenerator RandomStream::createUniIntGenerator(int from, int to) {
+	return StreamIntUniformGenerator(_StreamIntUniformGenerator(rng, uniform_int<>(from, to)));
+}
+
+StreamTriangleGenerator RandomStream::createTriangleGenerator(double lowerBound, double mostLikely, double upperBound) {
+	return StreamTriangleGenerator(
+			_StreamTriangleGenerator(rng, triangle_distribution<>(lowerBound, mostLikely, upperBound)));
+}
+
+StreamCauchyGenerator RandomStream::createCauchyGenerator(double median, double sigma) {
+	return StreamCauchyGenerator(_StreamCauchyGenerator(rng, cauchy_distribution<>(median, sigma)));
+}
+
+StreamExponentialGenerator RandomStream::createExponentialGenerator(double lambda) {
+	return StreamExponentialGenerator(_StreamExponentialGenerator(rng, exponential_distribution<>(lambda)));
+}
+
+StreamNormalGenerator RandomStream::createNormalGenerator(double mean, double sigma) {
+	return StreamNormalGenerator(_StreamNormalGenerator(rng, normal_distribution<>(mean, sigma)));
+}
+
+StreamLogNormalGenerator RandomStream::createLogNormalGenerator(double mean, double sigma) {
+	return StreamLogNormalGenerator(_StreamLogNormalGenerator(rng, lognormal_distribution<>(mean, sigma)));
+}
+
+}
@@ -0,0 +1,236 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  RandomStream.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: jtm
+ */
+
+#ifndef RANDOMSTREAM_H_
+#define RANDOMSTREAM_H_
+
+#include <boost/cstdint.hpp>
+
+#include "Random.h"
+#include "AgentId.h"
+
+namespace repast {
+
+/**
+ * Counter-based random number engine, implementing the Philox4x32-10
+ * generator of Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"
+ * (SC11). Each block of four numbers is a keyed bijection of a 128 bit counter,
+ * so an engine needs no state beyond its key and counter, is cheap to create,
+ * and any number of engines with distinct keys or counters produce
+ * independent streams. The first counter word counts the blocks drawn; the
+ * other three, along with the key, identify the stream.
+ *
+ * This satisfies the boost uniform random number generator requirements, and
+ * so can be used with the boost distributions.
+ */
+class Philox4x32 {
+
+private:
+	boost::uint32_t key[2];
+	boost::uint32_t counter[4];
+	boost::uint32_t block[4];
+	unsigned int index;
+
+	void generate();
+
+public:
+	typedef boost::uint32_t result_type;
+	BOOST_STATIC_CONSTANT(bool, has_fixed_range = false);
+
+	/**
+	 * Creates a Philox4x32 engine.
+	 *
+	 * @param key0 the first word of the key
+	 * @param key1 the second word of the key
+	 * @param stream0 the second counter word, identifying the stream
+	 * @param stream1 the third counter word, identifying the stream
+	 * @param stream2 the fourth counter word, identifying the stream
+	 */
+	Philox4x32(boost::uint32_t key0, boost::uint32_t key1, boost::uint32_t stream0 = 0, boost::uint32_t stream1 = 0,
+			boost::uint32_t stream2 = 0);
+
+	static result_type min BOOST_PREVENT_MACRO_SUBSTITUTION () {
+		return 0;
+	}
+
+	static result_type max BOOST_PREVENT_MACRO_SUBSTITUTION () {
+		return 0xFFFFFFFFu;
+	}
+
+	/**
+	 * Gets the next number in the stream.
+	 */
+	result_type operator()() {
+		if (index == 4) generate();
+		return block[index++];
+	}
+
+	/**
+	 * Skips the next n numbers in the stream.
+	 */
+	void discard(boost::uint64_t n);
+
+	/**
+	 * Encrypts a single counter with the specified key, using
+	 * the ten Philox rounds. This is the block function used by the engine.
+	 *
+	 * @param ctr the counter; replaced by the result
+	 * @param key the key
+	 */
+	static void encrypt(boost::uint32_t ctr[4], const boost::uint32_t key[2]);
+};
+
+typedef boost::variate_generator<Philox4x32&, boost::uniform_real<> > _StreamRealUniformGenerator;
+typedef boost::variate_generator<Philox4x32&, boost::uniform_int<> > _StreamIntUniformGenerator;
+typedef boost::variate_generator<Philox4x32&, boost::triangle_distribution<> > _StreamTriangleGenerator;
+typedef boost::variate_generator<Philox4x32&, boost::cauchy_distribution<> > _StreamCauchyGenerator;
+typedef boost::variate_generator<Philox4x32&, boost::exponential_distribution<> > _StreamExponentialGenerator;
+typedef boost::variate_generator<Philox4x32&, boost::normal_distribution<> > _StreamNormalGenerator;
+typedef boost::variate_generator<Philox4x32&, boost::lognormal_distribution<> > _StreamLogNormalGenerator;
+
+typedef DefaultNumberGenerator<_StreamIntUniformGenerator> StreamIntUniformGenerator;
+typedef DefaultNumberGenerator<_StreamRealUniformGenerator> StreamDoubleUniformGenerator;
+typedef DefaultNumberGenerator<_StreamTriangleGenerator> StreamTriangleGenerator;
+typedef DefaultNumberGenerator<_StreamCauchyGenerator> StreamCauchyGenerator;
+typedef DefaultNumberGenerator<_StreamExponentialGenerator> StreamExponentialGenerator;
+typedef DefaultNumberGenerator<_StreamNormalGenerator> StreamNormalGenerator;
+typedef DefaultNumberGenerator<_StreamLogNormalGenerator> StreamLogNormalGenerator;
+
+/**
+ * A stream of random numbers belonging to an agent at a tick. The stream is
+ * determined by the seed, the agent's id, the tick and a purpose number that
+ * distinguishes the different uses an agent makes of random numbers in the
+ * same tick. It does not depend on the process the agent is on (the agent's
+ * current rank is not part of its key), on the number of processes or threads,
+ * or on the order in which agents draw their numbers, so models that draw
+ * from RandomStreams instead of the Random singleton produce the same results
+ * however they are decomposed.
+ *
+ * RandomStreams are independent of each other and of the Random singleton, so
+ * they can be created and used concurrently by different threads, for example
+ * by the functor passed to SharedContext::parallelForLocal. A RandomStream
+ * must not be shared between threads.
+ *
+ * The generators created by a RandomStream draw from it, as those created by
+ * Random draw from the singleton, and so must not outlive it.
+ */
+class RandomStream {
+
+private:
+	Philox4x32 rng;
+	_StreamRealUniformGenerator uniGen;
+
+	RandomStream(const RandomStream&);
+	RandomStream& operator=(const RandomStream&);
+
+public:
+
+	/**
+	 * Creates the stream for the specified agent, tick and purpose, using
+	 * the seed of the Random singleton.
+	 *
+	 * @param id the agent's id
+	 * @param tick the tick
+	 * @param purpose identifies what the numbers are used for
+	 */
+	RandomStream(const AgentId& id, double tick, boost::uint32_t purpose = 0);
+
+	/**
+	 * Creates the stream for the specified seed, agent, tick and purpose.
+	 *
+	 * @param seed the seed
+	 * @param id the agent's id
+	 * @param tick the tick
+	 * @param purpose identifies what the numbers are used for
+	 */
+	RandomStream(boost::uint32_t seed, const AgentId& id, double tick, boost::uint32_t purpose = 0);
+
+	/**
+	 * Gets the random number engine from which the distributions are created.
+	 */
+	Philox4x32& engine() {
+		return rng;
+	}
+
+	/**
+	 * Gets the next double in the range [0, 1).
+	 */
+	double nextDouble() {
+		return uniGen();
+	}
+
+	/**
+	 * Creates a generator that produces doubles in the range [from, to).
+	 */
+	StreamDoubleUniformGenerator createUniDoubleGenerator(double from, double to);
+
+	/**
+	 * Creates a generator that produces ints in the range [from, to].
+	 */
+	StreamIntUniformGenerator createUniIntGenerator(int from, int to);
+
+	/**
+	 * Creates a triangle generator. See Random::createTriangleGenerator.
+	 */
+	StreamTriangleGenerator createTriangleGenerator(double lowerBound, double mostLikely, double upperBound);
+
+	/**
+	 * Creates a Cauchy generator. See Random::createCauchyGenerator.
+	 */
+	StreamCauchyGenerator createCauchyGenerator(double median, double sigma);
+
+	/**
+	 * Creates an exponential generator. See Random::createExponentialGenerator.
+	 */
+	StreamExponentialGenerator createExponentialGenerator(double lambda);
+
+	/**
+	 * Creates a normal generator. See Random::createNormalGenerator.
+	 */
+	StreamNormalGenerator createNormalGenerator(double mean, double sigma);
+
+	/**
+	 * Creates a log normal generator. See Random::createLogNormalGenerator.
+	 */
+	StreamLogNormalGenerator createLogNormalGenerator(double mean, double sigma);
+};
+
+}
+
+#endif /* RANDOMSTREAM_H_ */
@@ -879,6 +879,74 @@ public:
       RESOLUTION    "Modify the incorrect line in the properties file, or alter the code to provide a communicator for initializeSeed"
 END_ERR
 
+/* Error 58 */
+class Repast_Error_58: public std::invalid_argument{
+public:
+  Repast_Error_58(int order, int dims): INVALID_ARG(ERROR_NUMBER 58)
+      THROWN_BY     "SpaceFillingCurve::SpaceFillingCurve(GridDimensions globalBoundaries, int curveOrder, CurveType type, bool spaceIsPeriodic, boost::mpi::communicator* communicator)"
+      REASON        "Invalid curve order (" + VAL(order) + ") for " + VAL(dims) + " dimensions"
+      EXPLANATION   "The curve order must be non-negative, and the space is divided into 2^(order x dimensions) blocks, which must not exceed 2^24"
+      CAUSE         "Improper model construction"
+      RESOLUTION    "Use a smaller curve order"
+END_ERR
+
+/* Error 59 */
+class Repast_Error_59: public std::invalid_argument{
+public:
+  Repast_Error_59(int stencilDims, int stencilRadius, int layerDims, int bufferSize): INVALID_ARG(ERROR_NUMBER 59)
+      THROWN_BY     "DiffusionLayerND<T>::diffuse(const StencilDiffusor<T, N, R>& stencil, bool omitSynchronize), " +
+                    "DiffusionLayerND<T>::diffuseAndSynchronize(const StencilDiffusor<T, N, R>& stencil) or " +
+                    "DiffusionLayerND<T>::diffuseSteps(const StencilDiffusor<T, N, R>& stencil, int steps)"
+      REASON        "A stencil of " + VAL(stencilDims) + " dimensions and radius " + VAL(stencilRadius) + " cannot be applied to a layer of " + VAL(layerDims) + " dimensions with a buffer of " + VAL(bufferSize)
+      EXPLANATION   "The stencil must have the same number of dimensions as the layer, and its radius must not exceed the layer's buffer size"
+      CAUSE         "Improper model construction"
+      RESOLUTION    "Use a stencil that matches the layer, or a layer with a larger buffer"
+END_ERR
+
+/* Error 60 */
+class Repast_Error_60: public std::invalid_argument{
+public:
+  Repast_Error_60(int radius, int bufferSize): INVALID_ARG(ERROR_NUMBER 60)
+      THROWN_BY     "DiffusionLayerND<T>::diffuseSteps(Diffusor<T>* diffusor, int steps)"
+      REASON        "The radius of diffusion (" + VAL(radius) + ") is larger than the buffer size (" + VAL(bufferSize) + ")"
+      EXPLANATION   "Each diffusion step reads values up to the radius of diffusion away from each local cell, so the buffer zone must be at least that wide"
+      CAUSE         "Improper model construction"
+      RESOLUTION    "Create the layer with a buffer size that is a multiple of the radius of diffusion"
+END_ERR
+
+/* Error 61 */
+class Repast_Error_61: public std::invalid_argument{
+public:
+  Repast_Error_61(std::string fileName): INVALID_ARG(ERROR_NUMBER 61)
+      THROWN_BY     "AbstractValueLayerND<T>::writeSnapshotData or readSnapshotData"
+      REASON        "Snapshot file '" + fileName + "' could not be opened"
+      EXPLANATION   "Snapshots are written and read with collective MPI-IO; every process in the layer's topology must be able to open the file"
+      CAUSE         "The file (when reading) or its directory (when writing) does not exist or is not accessible on all processes"
+      RESOLUTION    "Check the path and make sure it is on a file system shared by all processes"
+END_ERR
+
+/* Error 62 */
+class Repast_Error_62: public std::invalid_argument{
+public:
+  Repast_Error_62(std::string fileName, std::string problem): INVALID_ARG(ERROR_NUMBER 62)
+      THROWN_BY     "AbstractValueLayerND<T>::readSnapshotData(const string& fileName, T* dataSpace)"
+      REASON        "Snapshot file '" + fileName + "' does not match this value layer: " + problem
+      EXPLANATION   "A snapshot can only be read into a layer with the same number of dimensions, global boundaries, and element type as the layer that wrote it"
+      CAUSE         "The file is not a value layer snapshot, is truncated, or was written by a different layer"
+      RESOLUTION    "Read the snapshot into a layer constructed with the same global boundaries and element type (the process decomposition may differ)"
+END_ERR
+
+/* Error 63 */
+class Repast_Error_63: public std::domain_error{
+public:
+  Repast_Error_63(): DOMAIN_ERR(ERROR_NUMBER 63)
+      THROWN_BY     "RepastProcess::beginSynchronizeAgentStates, synchronizeAgentStates or synchronizeChangedAgentStates"
+      REASON        "An agent state synchronization was begun while another one was still in flight"
+      EXPLANATION   "Agent state synchronizations exchange messages with the same tags, so a second one could receive the first one's messages"
+      CAUSE         "beginSynchronizeAgentStates was called without a matching finishSynchronizeAgentStates before the next synchronization"
+      RESOLUTION    "Call finishSynchronizeAgentStates before beginning another agent state synchronization"
+END_ERR
+
 /* TEMPLATE
 class Repast_Error_: public std::invalid_argument{
 public:
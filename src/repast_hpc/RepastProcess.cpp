@@ -65,10 +65,11 @@ namespace repast {
 
 RepastProcess* RepastProcess::_instance = 0;
 
-RepastProcess::RepastProcess(boost::mpi::communicator* comm) : world(comm), runner(new ScheduleRunner(world)),
-		rank_(world->rank()), worldSize_(world->size()),
+RepastProcess::RepastProcess(boost::mpi::communicator* comm, ScheduleRunner::SCHEDULE_BACKEND scheduleBackend) :
+		world(comm), runner(new ScheduleRunner(world, scheduleBackend)),
+		rank_(world->rank()), worldSize_(world->size()), exportIndexIsDirty(true),
 		procsToSendProjInfoTo(NULL), procsToRecvProjInfoFrom(NULL), procsToSendAgentStatusInfoTo(NULL),
-		procsToRecvAgentStatusInfoFrom(NULL) {
+		procsToRecvAgentStatusInfoFrom(NULL), threadPool(NULL), agentStatesSyncInFlight(false) {
 
 	//world = comm;
 	//runner = new ScheduleRunner(world);
@@ -103,7 +104,8 @@ RepastProcess::RepastProcess(boost::mpi::communicator* comm) : world(comm), runn
 }
 
 RepastProcess* RepastProcess::init(string propsfile,
-		boost::mpi::communicator* comm, int maxConfigFileSize) {
+		boost::mpi::communicator* comm, int maxConfigFileSize,
+		ScheduleRunner::SCHEDULE_BACKEND scheduleBackend) {
 	if (_instance != 0) {
 		// reinitializing so delete the old instance
 		delete _instance;
@@ -118,7 +120,7 @@ RepastProcess* RepastProcess::init(string propsfile,
 				maxConfigFileSize);
 	else
 		Log4CL::configure(tmpWorld->rank());
-	_instance = new RepastProcess(tmpWorld);
+	_instance = new RepastProcess(tmpWorld, scheduleBackend);
 
 	return _instance;
 }
@@ -148,6 +150,7 @@ void RepastProcess::addImportedAgent(AgentId id) {
 void RepastProcess::agentRemoved(const AgentId& id) {
 	movedAgents.erase(id);
 	importer_exporter->agentRemoved(id);
+	exportIndexIsDirty = true;
 }
 
 void RepastProcess::moveAgent(const AgentId& id, int process) {
@@ -156,6 +159,7 @@ void RepastProcess::moveAgent(const AgentId& id, int process) {
 	MovedAgentSetType::const_iterator iter = movedAgents.find(newId);
 	if (iter == movedAgents.end()) {
 		importer_exporter->agentMoved(id, process);
+		exportIndexIsDirty = true;
 		movedAgents.insert(newId);
 	} else {
 		AgentId other = *iter;
@@ -296,6 +300,7 @@ void RepastProcess::initiateAgentRequest(AgentRequest& request
 #else
 	importer_exporter->registerIncomingRequests(reqsRecd, setName);
 #endif
+	exportIndexIsDirty = true;
 
 }
 
@@ -311,9 +316,21 @@ RepastProcess::~RepastProcess() {
 
 	for(size_t i = 0; i < cartesianTopologies.size(); i++) delete cartesianTopologies[i];
 
+	delete threadPool;
+
 	_instance = 0;
 }
 
+void RepastProcess::useThreads(unsigned int numThreads) {
+	runner->setThreadPool(NULL);
+	delete threadPool;
+	threadPool = NULL;
+	if (numThreads != 1) {
+		threadPool = new ThreadPool(numThreads);
+		runner->setThreadPool(threadPool);
+	}
+}
+
 CartesianTopology* RepastProcess::getCartesianTopology(std::vector<int> processesPerDim, bool spaceIsPeriodic){
   for(size_t i = 0; i < cartesianTopologies.size(); i++){
     if(cartesianTopologies[i]->matches(processesPerDim, spaceIsPeriodic)) return cartesianTopologies[i];
@@ -46,10 +46,14 @@
 #include <set>
 #include <list>
 #include <iostream>
+#include <type_traits>
+#include <algorithm>
+#include <mutex>
 
 #include <boost/mpi/communicator.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/unordered_set.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/ptr_container/ptr_list.hpp>
 #include <boost/serialization/utility.hpp>
@@ -65,6 +69,9 @@
 #include "RepastErrors.h"
 #include "AgentImporterExporter.h"
 #include "CartesianTopology.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "ContentTraits.h"
 
 // these are for the timings logging
 #include "Utilities.h"
@@ -135,7 +142,7 @@ public:
 
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version) {
-		ar & agentContentPtr;
+		serializeContent(ar, agentContentPtr);
 		ar & projectionInfoPtr;
 	}
 
@@ -216,7 +223,7 @@ public:
 
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version) {
-		ar & agentContentPtr;
+		serializeContent(ar, agentContentPtr);
 		ar & projectionInfoPtr;
 		ar & secondaryIdsPtr;
 		ar & exporterInfoPtr;
@@ -224,6 +231,71 @@ public:
 
 };
 
+/**
+ * An agent state synchronization that has been begun with
+ * RepastProcess::beginSynchronizeAgentStates and must be completed
+ * by passing it to RepastProcess::finishSynchronizeAgentStates, which
+ * deletes it. Holds the outstanding MPI requests and their buffers.
+ */
+template<typename Content>
+class AgentStatesSync: public boost::noncopyable {
+
+	friend class RepastProcess;
+
+private:
+	// Used when Content is exchanged with Boost serialization
+	std::vector<boost::mpi::request> requests;
+	std::vector<std::vector<Content>*> received;
+	boost::ptr_list<std::vector<Content> > toSend;
+
+	// Used when Content is exchanged as raw memory
+	std::vector<int> sources;
+	std::vector<int> recvCounts;
+	std::vector<int> sendCounts;
+	std::vector<MPI_Request> countRequests;
+	std::vector<MPI_Request> contentRequests;
+	std::vector<std::vector<Content> > rawToSend;
+	std::map<int, std::vector<char> > buffers; // By source process
+	MPI_Datatype contentType;
+
+	AgentStatesSync() :
+			contentType(MPI_DATATYPE_NULL) {
+	}
+
+public:
+	~AgentStatesSync() {
+		for (size_t i = 0; i < received.size(); i++)
+			delete received[i];
+	}
+};
+
+/**
+ * A projection information synchronization that has been begun with
+ * RepastProcess::beginSynchronizeProjectionInfo and must be completed
+ * by passing it to RepastProcess::finishSynchronizeProjectionInfo, which
+ * deletes it.
+ */
+template<typename Content>
+class ProjectionInfoSync: public boost::noncopyable {
+
+	friend class RepastProcess;
+
+private:
+	std::vector<boost::mpi::request> requests;
+	std::map<int, Request_Packet<Content>*> toReceive;
+	boost::ptr_list<Request_Packet<Content> > toSend;
+
+	ProjectionInfoSync() {
+	}
+
+public:
+	~ProjectionInfoSync() {
+		for (typename std::map<int, Request_Packet<Content>*>::iterator iter =
+				toReceive.begin(), iterEnd = toReceive.end(); iter != iterEnd; ++iter)
+			delete iter->second;
+	}
+};
+
 /**
  * Encapsulates the process in which repast is running and
  * manages interprocess communication etc. This is singleton to
@@ -233,7 +305,7 @@ class RepastProcess: public boost::noncopyable {
 
 public:
 	enum EXCHANGE_PATTERN {
-		POLL, USE_CURRENT, USE_LAST_OR_POLL, USE_LAST_OR_USE_CURRENT
+		POLL, USE_CURRENT, USE_LAST_OR_POLL, USE_LAST_OR_USE_CURRENT, SPARSE_POLL, USE_LAST_OR_SPARSE_POLL
 	};
 
 private:
@@ -261,6 +333,18 @@ private:
 	std::map<int, std::vector<AgentRequest>*> importers;
 	MovedAgentSetType movedAgents;
 
+	// local agents whose state has changed since the last synchronizeChangedAgentStates
+	boost::unordered_set<AgentId, HashId> changedAgents;
+	std::mutex changedAgentsLock;
+
+	// for each exported agent, the processes it is exported to; rebuilt by
+	// synchronizeChangedAgentStates only after the exports have changed
+	boost::unordered_map<AgentId, std::vector<int>, HashId> exportIndex;
+	bool exportIndexIsDirty;
+#ifdef SHARE_AGENTS_BY_SET
+	std::string exportIndexSet;
+#endif
+
 	// called by request agents function to initiate the request
 #ifndef SHARE_AGENTS_BY_SET
 	void initiateAgentRequest(AgentRequest& requests);
@@ -278,8 +362,61 @@ private:
 
 	std::vector<CartesianTopology*> cartesianTopologies;
 
+	ThreadPool* threadPool;
+
+	// receive buffers for raw agent content, by source process, retained between calls to synchronizeAgentStates
+	std::map<int, std::vector<char> > rawContentBuffers;
+
+	// number of agents whose raw content is exchanged with each process as soon as a synchronization
+	// begins; the rest follows once the count is known. Both sides of each pair keep the same value:
+	// the largest count exchanged so far
+	std::map<int, int> rawSendCapacity;
+	std::map<int, int> rawRecvCapacity;
+
+	// true from the beginning of an agent state synchronization until it is finished
+	bool agentStatesSyncInFlight;
+
+	// throws if an agent state synchronization is already in flight, otherwise marks one as begun
+	void beginAgentStatesSync() {
+		if (agentStatesSyncInFlight) throw Repast_Error_63();
+		agentStatesSyncInFlight = true;
+	}
+
+	// adds the agent described by received content to the context, or updates the agent if the context
+	// already has it; returns the agent in the context and sets added if it was newly added
+	template<typename T, typename Content, typename Updater, typename AgentCreator>
+	T* importAgent(SharedContext<T>& context, const Content& content, Updater& updater,
+			AgentCreator& creator, bool& added, std::true_type);
+
+	template<typename T, typename Content, typename Updater, typename AgentCreator>
+	T* importAgent(SharedContext<T>& context, const Content& content, Updater& updater,
+			AgentCreator& creator, bool& added, std::false_type);
+
+	// begins and finishes exchanging agent states using Boost serialization
+	template<typename Content, typename Provider>
+	void beginExchangeAgentStates(AgentStatesSync<Content>* sync,
+			const std::set<int>& processesToReceiveFrom,
+			const std::map<int, AgentRequest>& agentsToExport, Provider& provider,
+			std::false_type);
+
+	template<typename Content, typename Updater>
+	void finishExchangeAgentStates(AgentStatesSync<Content>* sync, Updater& updater,
+			std::false_type);
+
+	// begins and finishes exchanging agent states whose Content is_raw_content as raw memory
+	template<typename Content, typename Provider>
+	void beginExchangeAgentStates(AgentStatesSync<Content>* sync,
+			const std::set<int>& processesToReceiveFrom,
+			const std::map<int, AgentRequest>& agentsToExport, Provider& provider,
+			std::true_type);
+
+	template<typename Content, typename Updater>
+	void finishExchangeAgentStates(AgentStatesSync<Content>* sync, Updater& updater,
+			std::true_type);
+
 protected:
-	RepastProcess(boost::mpi::communicator* comm = 0);
+	RepastProcess(boost::mpi::communicator* comm = 0,
+			ScheduleRunner::SCHEDULE_BACKEND scheduleBackend = ScheduleRunner::PRIORITY_QUEUE);
 
 	void saveProjInfoSRProcs(std::vector<int>& sends, std::vector<int>& recvs) {
 		if (procsToSendProjInfoTo == NULL) {
@@ -315,10 +452,13 @@ public:
 	 *
 	 * @param propsfile a configuration properties file. This can be an
 	 * empty string.
+	 * @param scheduleBackend the data structure the ScheduleRunner uses to
+	 * hold scheduled events
 	 */
 	static RepastProcess* init(std::string propsfile,
 			boost::mpi::communicator* comm = 0, int maxConfigFileSize =
-			MAX_CONFIG_FILE_SIZE);
+			MAX_CONFIG_FILE_SIZE, ScheduleRunner::SCHEDULE_BACKEND scheduleBackend =
+			ScheduleRunner::PRIORITY_QUEUE);
 
 	/**
 	 * Gets this RepastProcess.
@@ -406,6 +546,25 @@ public:
 		return world;
 	}
 
+	/**
+	 * Creates a pool of the specified number of threads (including the
+	 * main thread) for this process, replacing any previous pool, and sets it
+	 * as the ScheduleRunner's pool for executing parallel safe events.
+	 *
+	 * @param numThreads the number of threads; 0 uses the hardware concurrency
+	 * and 1 removes the pool, so that everything runs serially
+	 */
+	void useThreads(unsigned int numThreads);
+
+	/**
+	 * Gets the thread pool for this process.
+	 *
+	 * @return the thread pool, or 0 if useThreads has not been called
+	 */
+	ThreadPool* getThreadPool() {
+		return threadPool;
+	}
+
 
 	CartesianTopology* getCartesianTopology(std::vector<int> processesPerDim, bool spaceIsPeriodic);
 
@@ -413,6 +572,7 @@ public:
 #ifdef SHARE_AGENTS_BY_SET
 	void dropImporterExporterSet(std::string setName) {
 		importer_exporter->dropSet(setName);
+		exportIndexIsDirty = true;
 	}
 #endif
 
@@ -461,6 +621,81 @@ public:
 #endif
 			);
 
+	/**
+	 * Begins synchronizing the state values of shared agents: the content of
+	 * the exported agents is collected from the provider and sent, and the
+	 * receives are posted, but the call returns without waiting for any of them.
+	 * The returned handle must be passed to finishSynchronizeAgentStates, which
+	 * waits for the exchange to complete and updates the imported agents.
+	 *
+	 * In between, the model can do work that does not read the states of
+	 * imported (non-local) agents, for example updating interior agents, so
+	 * that this work overlaps the communication. It must not add, remove or
+	 * move agents, or request agents, until the synchronization has finished.
+	 * Only one agent state synchronization (including synchronizeAgentStates
+	 * and synchronizeChangedAgentStates) can be in flight at a time: all of
+	 * them exchange messages with the same tags, so beginning a second one
+	 * before the first is finished throws Repast_Error_63.
+	 *
+	 * <code>
+	 * AgentStatesSync<Package>* sync = process->beginSynchronizeAgentStates<Package>(provider);
+	 * updateInterior();
+	 * process->finishSynchronizeAgentStates(sync, updater);
+	 * </code>
+	 */
+	template<typename Content, typename Provider>
+	AgentStatesSync<Content>* beginSynchronizeAgentStates(Provider& provider
+#ifdef SHARE_AGENTS_BY_SET
+			, std::string setName = REQUEST_AGENTS_ALL
+#endif
+			);
+
+	/**
+	 * Completes a synchronization begun with beginSynchronizeAgentStates,
+	 * updating the imported agents, and deletes the handle.
+	 */
+	template<typename Content, typename Updater>
+	void finishSynchronizeAgentStates(AgentStatesSync<Content>* sync, Updater& updater);
+
+	/**
+	 * Notes that the state of the specified local agent has changed, so that
+	 * the next call to synchronizeChangedAgentStates will send it to the
+	 * processes that import it. Agents that are not exported are ignored.
+	 * This may be called concurrently from the threads of
+	 * SharedContext::parallelForLocal; calls are serialized by a lock.
+	 *
+	 * @param id the id of the agent whose state has changed
+	 */
+	void agentChanged(const AgentId& id) {
+		std::lock_guard<std::mutex> guard(changedAgentsLock);
+		changedAgents.insert(id);
+	}
+
+	/**
+	 * Synchronizes the state values of shared agents like synchronizeAgentStates,
+	 * but the provider is only asked for, and the importing processes only
+	 * receive, the exported agents that have been passed to agentChanged since
+	 * the last call to this method. The set of changed agents is cleared
+	 * on return.
+	 *
+	 * The work done is proportional to the number of changed agents, except
+	 * after the set of exported agents has changed (e.g. after
+	 * synchronizeProjectionInfo or requestAgents), when an index from agent
+	 * to importing processes is rebuilt from all the exported agents.
+	 *
+	 * This is an opt-in alternative to synchronizeAgentStates: it is only correct
+	 * if every change to the state of an exported agent is reported through
+	 * agentChanged. Agents that are newly imported, moved or copied by
+	 * synchronizeProjectionInfo always arrive with their full state, so
+	 * they need no special treatment.
+	 */
+	template<typename Content, typename Provider, typename Updater>
+	void synchronizeChangedAgentStates(Provider& provider, Updater& updater
+#ifdef SHARE_AGENTS_BY_SET
+			, std::string setName = REQUEST_AGENTS_ALL
+#endif
+			);
+
 	/**
 	 * Synchronizes the Projection information for shared projections.
 	 */
@@ -474,6 +709,34 @@ public:
 #endif
 			);
 
+	/**
+	 * Begins synchronizing the Projection information for shared projections.
+	 * Non-local agents that are no longer needed are dropped, the exchange
+	 * partners are determined and the agent and projection information is sent,
+	 * but the call returns without waiting for it to arrive. The returned handle
+	 * must be passed to finishSynchronizeProjectionInfo, which waits and then adds
+	 * the received agents and projection information to the context.
+	 *
+	 * In between, the model can update local agents whose state does not
+	 * depend on non-local ones; it must not change the agents in the context
+	 * or their projection information until the synchronization has finished.
+	 */
+	template<typename T, typename Content, typename Provider>
+	ProjectionInfoSync<Content>* beginSynchronizeProjectionInfo(SharedContext<T>& context,
+			Provider& provider, EXCHANGE_PATTERN exchangePattern = POLL
+#ifdef SHARE_AGENTS_BY_SET
+			, bool declareNoAgentsKeptOnAnyProcess = false
+#endif
+			);
+
+	/**
+	 * Completes a synchronization begun with beginSynchronizeProjectionInfo
+	 * and deletes the handle.
+	 */
+	template<typename T, typename Content, typename Updater, typename AgentCreator>
+	void finishSynchronizeProjectionInfo(SharedContext<T>& context,
+			ProjectionInfoSync<Content>* sync, Updater& updater, AgentCreator& creator);
+
 	/**
 	 * Synchronizes the status (moved or died) of all agents across processes.
 	 *
@@ -519,6 +782,41 @@ public:
  * T* createAgent(Content&).
  *
  */
+template<typename T, typename Content, typename Updater, typename AgentCreator>
+T* RepastProcess::importAgent(SharedContext<T>& context, const Content& content, Updater& updater,
+		AgentCreator& creator, bool& added, std::true_type) {
+	AgentId id = content.getId();
+	T* agent = context.getAgent(id);
+	if (agent != 0) { // This agent was already on this process
+		updater.updateAgent(content);
+		added = false;
+		return agent;
+	}
+
+	agent = context.recycledAgent(id);
+	if (agent != 0) {
+		context.addAgent(agent);
+		updater.updateAgent(content);
+	} else {
+		agent = context.addAgent(creator.createAgent(content));
+	}
+	added = true;
+	return agent;
+}
+
+template<typename T, typename Content, typename Updater, typename AgentCreator>
+T* RepastProcess::importAgent(SharedContext<T>& context, const Content& content, Updater& updater,
+		AgentCreator& creator, bool& added, std::false_type) {
+	T* out = creator.createAgent(content);
+	T* inContext = context.addAgent(out);
+	added = (inContext == out);
+	if (!added) { // This agent was already on this process
+		updater.updateAgent(content);
+		delete out;
+	}
+	return inContext;
+}
+
 template<typename T, typename Content, typename Provider, typename Updater,
 		typename AgentCreator>
 void RepastProcess::requestAgents(SharedContext<T>& context,
@@ -529,12 +827,16 @@ void RepastProcess::requestAgents(SharedContext<T>& context,
 #endif
 		) {
 
+	Profiler* profiler = Profiler::instance();
+	double phaseStart = (profiler != 0 ? Profiler::now() : 0);
+
 	// Initiate the new requests
 #ifdef SHARE_AGENTS_BY_SET
 	initiateAgentRequest(request, setName, setType);
 #else
 	initiateAgentRequest(request);
 #endif
+	if (profiler != 0) phaseStart = profiler->phase("requestAgents", "initiate", phaseStart);
 
 	// Establish which processes are sending to/receiving from this one
 #ifdef SHARE_AGENTS_BY_SET
@@ -582,9 +884,11 @@ void RepastProcess::requestAgents(SharedContext<T>& context,
 				packet = new Request_Packet<Content>(content, projInfo));
 		requests.push_back(world->isend(iter->first, 23, *packet));
 	}
+	if (profiler != 0) phaseStart = profiler->phase("requestAgents", "pack", phaseStart);
 
 	// Wait until all sends/receives complete
 	boost::mpi::wait_all(requests.begin(), requests.end());
+	if (profiler != 0) phaseStart = profiler->phase("requestAgents", "wait", phaseStart);
 
 	// Clear sent data
 	delete toSend;
@@ -597,16 +901,14 @@ void RepastProcess::requestAgents(SharedContext<T>& context,
 		for (typename std::vector<Content>::const_iterator contentIter =
 				content->begin(), contentIterEnd = content->end();
 				contentIter != contentIterEnd; ++contentIter) {
-			T* out = creator.createAgent(*contentIter);
-			T* inContext = context.addAgent(out);
-			if (inContext != out) { // This agent was already on this process
-				updater.updateAgent(*contentIter);
-				delete out;
-			}
+			bool added;
+			importAgent(context, *contentIter, updater, creator, added,
+					typename has_agent_id<Content>::type());
 		}
 		context.setProjectionInfo(*((*iter)->projectionInfoPtr));
 		delete *iter;
 	}
+	if (profiler != 0) profiler->phase("requestAgents", "unpack", phaseStart);
 
 }
 
@@ -617,6 +919,8 @@ void RepastProcess::synchronizeAgentStates(Provider& provider, Updater& updater
 #endif
 		) {
 
+	beginAgentStatesSync();
+
 	// Establish which processes are sending/receiving from this one
 #ifdef SHARE_AGENTS_BY_SET
 	const std::set<int>& processesToReceiveFrom =
@@ -628,50 +932,257 @@ void RepastProcess::synchronizeAgentStates(Provider& provider, Updater& updater
 	const std::map<int, AgentRequest>& agentsToExport = importer_exporter->getAgentsToExport();
 #endif
 
-	// Construct MPI Requests (sends and receives)
-	std::vector<boost::mpi::request> requests;
+	AgentStatesSync<Content>* sync = new AgentStatesSync<Content>();
+	beginExchangeAgentStates(sync, processesToReceiveFrom, agentsToExport, provider,
+			typename is_raw_content<Content>::type());
+	finishSynchronizeAgentStates(sync, updater);
+}
+
+template<typename Content, typename Provider>
+AgentStatesSync<Content>* RepastProcess::beginSynchronizeAgentStates(Provider& provider
+#ifdef SHARE_AGENTS_BY_SET
+		, std::string setName
+#endif
+		) {
+
+	beginAgentStatesSync();
+
+#ifdef SHARE_AGENTS_BY_SET
+	const std::set<int>& processesToReceiveFrom =
+			importer_exporter->getExportingProcesses(setName);
+	const std::map<int, AgentRequest>& agentsToExport =
+			importer_exporter->getAgentsToExport(setName);
+#else
+	const std::set<int>& processesToReceiveFrom = importer_exporter->getExportingProcesses();
+	const std::map<int, AgentRequest>& agentsToExport = importer_exporter->getAgentsToExport();
+#endif
+
+	AgentStatesSync<Content>* sync = new AgentStatesSync<Content>();
+	beginExchangeAgentStates(sync, processesToReceiveFrom, agentsToExport, provider,
+			typename is_raw_content<Content>::type());
+	return sync;
+}
+
+template<typename Content, typename Updater>
+void RepastProcess::finishSynchronizeAgentStates(AgentStatesSync<Content>* sync, Updater& updater) {
+	agentStatesSyncInFlight = false;
+	finishExchangeAgentStates(sync, updater, typename is_raw_content<Content>::type());
+	delete sync;
+}
+
+template<typename Content, typename Provider, typename Updater>
+void RepastProcess::synchronizeChangedAgentStates(Provider& provider, Updater& updater
+#ifdef SHARE_AGENTS_BY_SET
+		, std::string setName
+#endif
+		) {
+
+	beginAgentStatesSync();
+
+	// Establish which processes are sending/receiving from this one
+#ifdef SHARE_AGENTS_BY_SET
+	const std::set<int>& processesToReceiveFrom =
+			importer_exporter->getExportingProcesses(setName);
+	const std::map<int, AgentRequest>& agentsToExport =
+			importer_exporter->getAgentsToExport(setName);
+#else
+	const std::set<int>& processesToReceiveFrom = importer_exporter->getExportingProcesses();
+	const std::map<int, AgentRequest>& agentsToExport = importer_exporter->getAgentsToExport();
+#endif
+
+	// Index the exported agents by id, if the exports have changed since the last call
+#ifdef SHARE_AGENTS_BY_SET
+	if (exportIndexSet != setName) exportIndexIsDirty = true;
+	exportIndexSet = setName;
+#endif
+	if (exportIndexIsDirty) {
+		exportIndex.clear();
+		for (std::map<int, AgentRequest>::const_iterator iter =
+				agentsToExport.begin(), iterEnd = agentsToExport.end();
+				iter != iterEnd; ++iter) {
+			const std::vector<AgentId>& exported = iter->second.requestedAgents();
+			for (std::vector<AgentId>::const_iterator idIter = exported.begin(),
+					idIterEnd = exported.end(); idIter != idIterEnd; ++idIter) {
+				std::vector<int>& ranks = exportIndex[*idIter];
+				if (ranks.empty() || ranks.back() != iter->first) ranks.push_back(iter->first);
+			}
+		}
+		exportIndexIsDirty = false;
+	}
+
+	// Every importer still receives a (possibly empty) message, but it only contains changed agents
+	std::map<int, AgentRequest> changedToExport;
+	for (std::map<int, AgentRequest>::const_iterator iter =
+			agentsToExport.begin(), iterEnd = agentsToExport.end();
+			iter != iterEnd; ++iter)
+		changedToExport[iter->first] = AgentRequest(iter->second.sourceProcess(), iter->second.targetProcess());
+	for (boost::unordered_set<AgentId, HashId>::const_iterator idIter = changedAgents.begin(),
+			idIterEnd = changedAgents.end(); idIter != idIterEnd; ++idIter) {
+		boost::unordered_map<AgentId, std::vector<int>, HashId>::const_iterator found = exportIndex.find(*idIter);
+		if (found == exportIndex.end()) continue;
+		for (std::vector<int>::const_iterator rankIter = found->second.begin(),
+				rankIterEnd = found->second.end(); rankIter != rankIterEnd; ++rankIter)
+			changedToExport[*rankIter].addRequest(*idIter);
+	}
+	changedAgents.clear();
+
+	AgentStatesSync<Content>* sync = new AgentStatesSync<Content>();
+	beginExchangeAgentStates(sync, processesToReceiveFrom, changedToExport, provider,
+			typename is_raw_content<Content>::type());
+	finishSynchronizeAgentStates(sync, updater);
+}
+
+template<typename Content, typename Provider>
+void RepastProcess::beginExchangeAgentStates(AgentStatesSync<Content>* sync,
+		const std::set<int>& processesToReceiveFrom,
+		const std::map<int, AgentRequest>& agentsToExport, Provider& provider,
+		std::false_type) {
+
+	Profiler* profiler = Profiler::instance();
+	double phaseStart = (profiler != 0 ? Profiler::now() : 0);
 
 	// Construct Receives
-	std::vector<std::vector<Content>*> received;
 	for (std::set<int>::const_iterator iter = processesToReceiveFrom.begin(),
 			iterEnd = processesToReceiveFrom.end(); iter != iterEnd; ++iter) {
 		std::vector<Content>* content = new std::vector<Content>();
-		requests.push_back(world->irecv(*iter, 47, *content));
-		received.push_back(content);
+		sync->requests.push_back(world->irecv(*iter, 47, *content));
+		sync->received.push_back(content);
 	}
 
 	// Construct Sends
-	boost::ptr_list<std::vector<Content> >* toSend = new boost::ptr_list<
-			std::vector<Content> >;
 	std::vector<Content>* content;
-
 	for (std::map<int, AgentRequest>::const_iterator iter =
 			agentsToExport.begin(), iterEnd = agentsToExport.end();
 			iter != iterEnd; ++iter) {
-		toSend->push_back(content = new std::vector<Content>);
+		sync->toSend.push_back(content = new std::vector<Content>);
 		provider.provideContent(iter->second, *content);
-		requests.push_back(world->isend(iter->first, 47, *content));
+		sync->requests.push_back(world->isend(iter->first, 47, *content));
 	}
+	if (profiler != 0) profiler->phase("synchronizeAgentStates", "pack", phaseStart);
+}
 
-	// Wait until all sends and receives are complete
-	boost::mpi::wait_all(requests.begin(), requests.end());
+template<typename Content, typename Updater>
+void RepastProcess::finishExchangeAgentStates(AgentStatesSync<Content>* sync, Updater& updater,
+		std::false_type) {
 
-	// Clear sent data
-	delete toSend;
+	Profiler* profiler = Profiler::instance();
+	double phaseStart = (profiler != 0 ? Profiler::now() : 0);
 
-	// Process (and clear) received data
+	// Wait until all sends and receives are complete
+	boost::mpi::wait_all(sync->requests.begin(), sync->requests.end());
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeAgentStates", "wait", phaseStart);
+
+	// Process received data (the sync's destructor deletes it)
 	for (typename std::vector<std::vector<Content>*>::iterator iter =
-			received.begin(), iterEnd = received.end(); iter != iterEnd;
+			sync->received.begin(), iterEnd = sync->received.end(); iter != iterEnd;
 			++iter) {
-		content = *iter;
+		std::vector<Content>* content = *iter;
 		for (typename std::vector<Content>::const_iterator agentIter =
 				content->begin(), agentIterEnd = content->end();
 				agentIter != agentIterEnd; ++agentIter) {
 			updater.updateAgent(*agentIter);
 		}
-		delete content;
+	}
+	if (profiler != 0) profiler->phase("synchronizeAgentStates", "unpack", phaseStart);
+}
+
+template<typename Content, typename Provider>
+void RepastProcess::beginExchangeAgentStates(AgentStatesSync<Content>* sync,
+		const std::set<int>& processesToReceiveFrom,
+		const std::map<int, AgentRequest>& agentsToExport, Provider& provider,
+		std::true_type) {
+
+	Profiler* profiler = Profiler::instance();
+	double phaseStart = (profiler != 0 ? Profiler::now() : 0);
+
+	MPI_Comm comm = *world;
+	sync->sources.assign(processesToReceiveFrom.begin(), processesToReceiveFrom.end());
+	size_t numRecvs = sync->sources.size();
+	size_t numSends = agentsToExport.size();
+	MPI_Type_contiguous(sizeof(Content), MPI_BYTE, &sync->contentType);
+	MPI_Type_commit(&sync->contentType);
+
+	// Post the receives for the counts and, into the retained buffers, for as
+	// much content as the capacity agreed with each source
+	sync->buffers.swap(rawContentBuffers);
+	sync->recvCounts.assign(numRecvs, 0);
+	sync->sendCounts.assign(numSends, 0);
+	sync->countRequests.resize(numRecvs + numSends);
+	sync->contentRequests.reserve(2 * (numRecvs + numSends));
+	for (size_t i = 0; i < numRecvs; i++) {
+		int source = sync->sources[i];
+		MPI_Irecv(&sync->recvCounts[i], 1, MPI_INT, source, AGENT_SYNC_STATE_COUNT, comm, &sync->countRequests[i]);
+		int capacity = rawRecvCapacity[source];
+		if (capacity == 0) continue;
+		std::vector<char>& buffer = sync->buffers[source];
+		if (buffer.size() < capacity * sizeof(Content)) buffer.resize(capacity * sizeof(Content));
+		sync->contentRequests.push_back(MPI_REQUEST_NULL);
+		MPI_Irecv(buffer.data(), capacity, sync->contentType, source, AGENT_SYNC_STATE_TAG, comm, &sync->contentRequests.back());
 	}
 
+	// Send the counts and the content as blocks of raw memory: up to the capacity
+	// in one message, and any excess (which raises the capacity) in a second one
+	sync->rawToSend.resize(numSends);
+	size_t s = 0;
+	for (std::map<int, AgentRequest>::const_iterator iter =
+			agentsToExport.begin(), iterEnd = agentsToExport.end();
+			iter != iterEnd; ++iter, ++s) {
+		int dest = iter->first;
+		provider.provideContent(iter->second, sync->rawToSend[s]);
+		int count = sync->sendCounts[s] = sync->rawToSend[s].size();
+		MPI_Isend(&sync->sendCounts[s], 1, MPI_INT, dest, AGENT_SYNC_STATE_COUNT, comm, &sync->countRequests[numRecvs + s]);
+		int& capacity = rawSendCapacity[dest];
+		if (capacity > 0) {
+			sync->contentRequests.push_back(MPI_REQUEST_NULL);
+			MPI_Isend(sync->rawToSend[s].data(), std::min(count, capacity), sync->contentType, dest, AGENT_SYNC_STATE_TAG, comm, &sync->contentRequests.back());
+		}
+		if (count > capacity) {
+			sync->contentRequests.push_back(MPI_REQUEST_NULL);
+			MPI_Isend(sync->rawToSend[s].data() + capacity, count - capacity, sync->contentType, dest, AGENT_SYNC_STATE_EXCESS, comm, &sync->contentRequests.back());
+			capacity = count;
+		}
+	}
+	if (profiler != 0) profiler->phase("synchronizeAgentStates", "pack", phaseStart);
+}
+
+template<typename Content, typename Updater>
+void RepastProcess::finishExchangeAgentStates(AgentStatesSync<Content>* sync, Updater& updater,
+		std::true_type) {
+
+	Profiler* profiler = Profiler::instance();
+	double phaseStart = (profiler != 0 ? Profiler::now() : 0);
+
+	MPI_Comm comm = *world;
+	size_t numRecvs = sync->sources.size();
+	MPI_Waitall(sync->countRequests.size(), sync->countRequests.data(), MPI_STATUSES_IGNORE);
+	MPI_Waitall(sync->contentRequests.size(), sync->contentRequests.data(), MPI_STATUSES_IGNORE);
+
+	// Receive the content beyond the capacity, after what has already arrived
+	sync->contentRequests.clear();
+	for (size_t i = 0; i < numRecvs; i++) {
+		int source = sync->sources[i];
+		int count = sync->recvCounts[i];
+		int& capacity = rawRecvCapacity[source];
+		if (count <= capacity) continue;
+		std::vector<char>& buffer = sync->buffers[source];
+		if (buffer.size() < count * sizeof(Content)) buffer.resize(count * sizeof(Content));
+		sync->contentRequests.push_back(MPI_REQUEST_NULL);
+		MPI_Irecv(buffer.data() + capacity * sizeof(Content), count - capacity, sync->contentType, source, AGENT_SYNC_STATE_EXCESS, comm, &sync->contentRequests.back());
+		capacity = count;
+	}
+	MPI_Waitall(sync->contentRequests.size(), sync->contentRequests.data(), MPI_STATUSES_IGNORE);
+	MPI_Type_free(&sync->contentType);
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeAgentStates", "wait", phaseStart);
+
+	// Process received data; vector storage is suitably aligned for any Content
+	for (size_t i = 0; i < numRecvs; i++) {
+		if (sync->recvCounts[i] == 0) continue;
+		const Content* content = reinterpret_cast<const Content*>(sync->buffers[sync->sources[i]].data());
+		for (int j = 0; j < sync->recvCounts[i]; j++)
+			updater.updateAgent(content[j]);
+	}
+	rawContentBuffers.swap(sync->buffers);
+	if (profiler != 0) profiler->phase("synchronizeAgentStates", "unpack", phaseStart);
 }
 
 template<typename T, typename Content, typename Provider, typename Updater,
@@ -683,6 +1194,25 @@ void RepastProcess::synchronizeProjectionInfo(SharedContext<T>& context,
 		, bool declareNoAgentsKeptOnAnyProcess
 #endif
 		) {
+	ProjectionInfoSync<Content>* sync = beginSynchronizeProjectionInfo<T, Content>(context,
+			provider, exchangePattern
+#ifdef SHARE_AGENTS_BY_SET
+			, declareNoAgentsKeptOnAnyProcess
+#endif
+			);
+	finishSynchronizeProjectionInfo(context, sync, updater, creator);
+}
+
+template<typename T, typename Content, typename Provider>
+ProjectionInfoSync<Content>* RepastProcess::beginSynchronizeProjectionInfo(SharedContext<T>& context,
+		Provider& provider, EXCHANGE_PATTERN exchangePattern
+#ifdef SHARE_AGENTS_BY_SET
+		, bool declareNoAgentsKeptOnAnyProcess
+#endif
+		) {
+
+	Profiler* profiler = Profiler::instance();
+	double phaseStart = (profiler != 0 ? Profiler::now() : 0);
 
 	// Generate sets of agents to delete or not delete
 	std::set<AgentId> agentsToKeep;
@@ -695,6 +1225,7 @@ void RepastProcess::synchronizeProjectionInfo(SharedContext<T>& context,
 #endif
 
 	// If 'By Set': Construct 'Keep list' from all non-default I/E requests (agents being imported)
+	exportIndexIsDirty = true;
 #ifdef SHARE_AGENTS_BY_SET
 	if (declareNoAgentsKeptOnAnyProcess) {
 		importer_exporter->clear();
@@ -755,6 +1286,7 @@ void RepastProcess::synchronizeProjectionInfo(SharedContext<T>& context,
 #else
 	importer_exporter->registerIncomingRequests(requests);
 #endif
+	exportIndexIsDirty = true;
 
 	// Exchange agent & projection information
 	// Establish which processes are sending to/receiving from this one
@@ -766,6 +1298,7 @@ void RepastProcess::synchronizeProjectionInfo(SharedContext<T>& context,
 #endif
 
 	std::map<int, AgentRequest> agentsToExport = tmpAgentsToExport; // Copy?
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeProjectionInfo", "prepare", phaseStart);
 
 	std::vector<int> psToSendTo;
 	std::vector<int> psToReceiveFrom;
@@ -796,6 +1329,15 @@ void RepastProcess::synchronizeProjectionInfo(SharedContext<T>& context,
 		SRManager manager(world);
 		manager.retrieveSources(psToSendTo, psToReceiveFrom,
 				AGENT_MOVED_SENDERS);
+	} else if (exchangePattern == SPARSE_POLL
+			|| ((exchangePattern == USE_LAST_OR_SPARSE_POLL)
+					&& (procsToSendProjInfoTo == NULL))) {
+		for (std::map<int, AgentRequest>::const_iterator iter =
+				agentsToExport.begin(), iterEnd = agentsToExport.end();
+				iter != iterEnd; ++iter) {
+			psToSendTo.push_back(iter->first);
+		}
+		SRManager::retrieveSourcesSparse(world, psToSendTo, psToReceiveFrom);
 	} else {
 		psToSendTo.assign(procsToSendProjInfoTo->begin(),
 				procsToSendProjInfoTo->end());
@@ -814,23 +1356,20 @@ void RepastProcess::synchronizeProjectionInfo(SharedContext<T>& context,
 	}
 
 	saveProjInfoSRProcs(psToSendTo, psToReceiveFrom);
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeProjectionInfo", "discover", phaseStart);
 
 	// Construct MPI requests (Receives and Sends)
-	std::vector<boost::mpi::request> MPIRequests; // MPI Requests (receives and sends)
+	ProjectionInfoSync<Content>* sync = new ProjectionInfoSync<Content>();
 
 	// Construct Receives
-	std::map<int, Request_Packet<Content>*> toReceive;
-
 	for (std::vector<int>::iterator iter = psToReceiveFrom.begin(), iterEnd =
 			psToReceiveFrom.end(); iter != iterEnd; ++iter) {
 		Request_Packet<Content>* packet;
-		toReceive[*iter] = (packet = new Request_Packet<Content>());
-		MPIRequests.push_back(world->irecv(*iter, 23, *packet));
+		sync->toReceive[*iter] = (packet = new Request_Packet<Content>());
+		sync->requests.push_back(world->irecv(*iter, 23, *packet));
 	}
 
 	// Construct Sends
-	boost::ptr_list<Request_Packet<Content> >* toSend = new boost::ptr_list<
-			Request_Packet<Content> >;
 
 	for (std::map<int, AgentRequest>::const_iterator iter =
 			agentsToExport.begin(), iterEnd = agentsToExport.end();
@@ -849,32 +1388,41 @@ void RepastProcess::synchronizeProjectionInfo(SharedContext<T>& context,
 		context.getProjectionInfo(rq, *projInfo, true, 0, dest); // Will collect the edges but not the secondary IDs
 
 		Request_Packet<Content>* packet;
-		toSend->push_back(
+		sync->toSend.push_back(
 				packet = new Request_Packet<Content>(contentVector, projInfo));
-		MPIRequests.push_back(world->isend(dest, 23, *packet));
+		sync->requests.push_back(world->isend(dest, 23, *packet));
 	}
+	if (profiler != 0) profiler->phase("synchronizeProjectionInfo", "pack", phaseStart);
+	return sync;
+}
+
+template<typename T, typename Content, typename Updater, typename AgentCreator>
+void RepastProcess::finishSynchronizeProjectionInfo(SharedContext<T>& context,
+		ProjectionInfoSync<Content>* sync, Updater& updater, AgentCreator& creator) {
+
+	Profiler* profiler = Profiler::instance();
+	double phaseStart = (profiler != 0 ? Profiler::now() : 0);
 
 	// Wait until all sends/receives complete
-	boost::mpi::wait_all(MPIRequests.begin(), MPIRequests.end());
+	boost::mpi::wait_all(sync->requests.begin(), sync->requests.end());
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeProjectionInfo", "wait", phaseStart);
 
 	// Clear sent data
-	delete toSend;
+	sync->toSend.clear();
 
 	// Process received data (and clear)
 	for (typename std::map<int, Request_Packet<Content>*>::iterator iter =
-			toReceive.begin(), iterEnd = toReceive.end(); iter != iterEnd;
+			sync->toReceive.begin(), iterEnd = sync->toReceive.end(); iter != iterEnd;
 			++iter) {
 		std::vector<Content>* contentVector = iter->second->agentContentPtr;
 		AgentRequest requestToRegister(iter->first);
 		for (typename std::vector<Content>::const_iterator contentIter =
 				contentVector->begin(), contentIterEnd = contentVector->end();
 				contentIter != contentIterEnd; ++contentIter) {
-			T* newAgent = creator.createAgent(*contentIter);
-			T* agentInContext = context.addAgent(newAgent);
-			if (agentInContext != newAgent) { // This agent was already on this process
-				updater.updateAgent(*contentIter);
-				delete newAgent;
-			} else {
+			bool added;
+			T* agentInContext = importAgent(context, *contentIter, updater, creator, added,
+					typename has_agent_id<Content>::type());
+			if (added) {
 				// Add the agent to the agent request that will be processed as if it were an OUTGOING request
 				requestToRegister.addRequest(agentInContext->getId());
 			}
@@ -882,9 +1430,12 @@ void RepastProcess::synchronizeProjectionInfo(SharedContext<T>& context,
 
 		context.setProjectionInfo(*(iter->second->projectionInfoPtr));
 		delete iter->second;
+		iter->second = 0;
 		// Register these as requests, so that the importer/exporter will know these agents will be sent
 		importer_exporter->registerOutgoingRequests(requestToRegister);
 	}
+	delete sync;
+	if (profiler != 0) profiler->phase("synchronizeProjectionInfo", "unpack", phaseStart);
 }
 
 template<typename T, typename Content, typename Provider, typename AgentCreator,
@@ -893,6 +1444,9 @@ void RepastProcess::synchronizeAgentStatus(SharedContext<T>& context,
 		Provider& provider, Updater& updater, AgentCreator& creator,
 		EXCHANGE_PATTERN exchangePattern) {
 
+	Profiler* profiler = Profiler::instance();
+	double phaseStart = (profiler != 0 ? Profiler::now() : 0);
+
 	// Step 1: Exchange information about agents whose status will be updated.
 	//
 	// Status Updates have been added to the importer_exporter and can now be exchanged
@@ -929,6 +1483,7 @@ void RepastProcess::synchronizeAgentStatus(SharedContext<T>& context,
 		}
 		delete vec;
 	}
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeAgentStatus", "statusExchange", phaseStart);
 
 	// Step 2: Send moving agents' information to new home processes
 	//
@@ -969,9 +1524,13 @@ void RepastProcess::synchronizeAgentStatus(SharedContext<T>& context,
 	//          will be unchanged from the last time this loop was run; once established, just keep using
 	//          the same set
 	//
-	// Variants 'USE_LAST_OR_POLL' and 'USE_LAST_OR_USE_CURRENT' allow for the case in which one method (either
-	// POLL or USE_CURRENT) is used for the initial pass through the loop and thereafter the sets are assumed
-	// unchanged.
+	//     4) SPARSE_POLL: Like POLL, but processes only notify the processes they will send to (synchronous
+	//          sends plus a non-blocking barrier), so the cost grows with the number of partners rather than
+	//          with the number of processes
+	//
+	// Variants 'USE_LAST_OR_POLL', 'USE_LAST_OR_SPARSE_POLL' and 'USE_LAST_OR_USE_CURRENT' allow for the case in
+	// which one method (POLL, SPARSE_POLL or USE_CURRENT) is used for the initial pass through the loop and
+	// thereafter the sets are assumed unchanged.
 	std::vector<int> psToSendTo;        // Convert set to vector
 	std::vector<int> psToReceiveFrom;
 
@@ -1002,6 +1561,15 @@ void RepastProcess::synchronizeAgentStatus(SharedContext<T>& context,
 		SRManager manager(world);
 		manager.retrieveSources(psToSendTo, psToReceiveFrom,
 				AGENT_MOVED_SENDERS);
+	} else if (exchangePattern == SPARSE_POLL
+			|| ((exchangePattern == USE_LAST_OR_SPARSE_POLL)
+					&& (procsToSendAgentStatusInfoTo == NULL))) {
+		for (std::map<int, AgentRequest>::const_iterator iter =
+				agentRequests.begin(), iterEnd = agentRequests.end();
+				iter != iterEnd; ++iter) {
+			psToSendTo.push_back(iter->first);
+		}
+		SRManager::retrieveSourcesSparse(world, psToSendTo, psToReceiveFrom);
 	} else {
 		psToSendTo.assign(procsToSendAgentStatusInfoTo->begin(),
 				procsToSendAgentStatusInfoTo->end());
@@ -1020,6 +1588,7 @@ void RepastProcess::synchronizeAgentStatus(SharedContext<T>& context,
 	}
 
 	saveAgentStatusInfoSRProcs(psToSendTo, psToReceiveFrom);
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeAgentStatus", "discover", phaseStart);
 
 	// Determine if any projection in the context will need to send 'secondary' agent data:
 	bool sendSecondaryData = context.sendsSecondaryDataOnStatusExchange();
@@ -1081,7 +1650,9 @@ void RepastProcess::synchronizeAgentStatus(SharedContext<T>& context,
 		requests.push_back(
 				world->isend(iter->first, AGENT_MOVED_AGENT, *packetToSend));
 	}
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeAgentStatus", "pack", phaseStart);
 	boost::mpi::wait_all(requests.begin(), requests.end());
+	if (profiler != 0) phaseStart = profiler->phase("synchronizeAgentStatus", "wait", phaseStart);
 	delete packetsToSend;
 
 	importer_exporter->clearAgentExportInfo();
@@ -1135,6 +1706,7 @@ void RepastProcess::synchronizeAgentStatus(SharedContext<T>& context,
 		importer_exporter->incorporateAgentExporterInfo(
 				*((*packetIter)->exporterInfoPtr));
 		importer_exporter->clearExportToSpecificProc(rank_); // Export Info may include 'exports' to self; remove these
+		exportIndexIsDirty = true;
 
 	}
 
@@ -1148,6 +1720,7 @@ void RepastProcess::synchronizeAgentStatus(SharedContext<T>& context,
 		context.setProjectionInfo(*((*packetIter)->projectionInfoPtr));
 		delete (*packetIter)->deleteExporterInfo(); // Exporter Info is only deleted from the received packets, not the sent ones...
 	}
+	if (profiler != 0) profiler->phase("synchronizeAgentStatus", "unpack", phaseStart);
 
 }
 
@@ -38,11 +38,25 @@
  */
 
 #include "SRManager.h"
+#include "mpi_constants.h"
 
+#include <algorithm>
 #include <boost/mpi.hpp>
 
 using namespace std;
 
+namespace {
+
+// Attribute key under which each communicator keeps its count of sparse exchange rounds
+int sparseRoundKey = MPI_KEYVAL_INVALID;
+
+int deleteSparseRound(MPI_Comm comm, int key, void* value, void* extraState){
+  delete static_cast<unsigned int*>(value);
+  return MPI_SUCCESS;
+}
+
+}
+
 SRManager::SRManager(boost::mpi::communicator* comm): _comm(comm){
   int s = _comm->size();
   mySend = new int[s];
@@ -99,3 +113,54 @@ void SRManager::retrieveSources(const std::vector<int>& targets, std::vector<int
   for(std::vector<int>::const_iterator iter = targets.begin(); iter != iEnd; iter++) send[*iter] = 1;
   retrieveSources(sources);
 }
+
+void SRManager::retrieveSourcesSparse(boost::mpi::communicator* comm, const std::vector<int>& targets, std::vector<int>& sources){
+  MPI_Comm c = (*comm);
+
+  // Alternate tags so that a process that has left the previous round cannot
+  // have its notifications consumed by a process still finishing that round.
+  // The rounds are counted on the communicator (as an attribute), so every
+  // process in it agrees on the count whatever other communicators it uses.
+  if(sparseRoundKey == MPI_KEYVAL_INVALID) MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, deleteSparseRound, &sparseRoundKey, NULL);
+  unsigned int* round;
+  int hasRound;
+  MPI_Comm_get_attr(c, sparseRoundKey, &round, &hasRound);
+  if(!hasRound){
+    round = new unsigned int(0);
+    MPI_Comm_set_attr(c, sparseRoundKey, round);
+  }
+  const int tag = (((*round)++ & 1) == 0 ? repast::SR_SPARSE_EXCHANGE_A : repast::SR_SPARSE_EXCHANGE_B);
+
+  const size_t numTargets = targets.size();
+  int flag = 1;
+  std::vector<MPI_Request> sends(numTargets);
+  for(size_t i = 0; i < numTargets; i++) MPI_Issend(&flag, 1, MPI_INT, targets[i], tag, c, &sends[i]);
+
+  MPI_Request barrier;
+  bool barrierActive = false;
+  bool done = false;
+  int notification;
+  while(!done){
+    int arrived;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, tag, c, &arrived, &status);
+    if(arrived){
+      MPI_Recv(&notification, 1, MPI_INT, status.MPI_SOURCE, tag, c, MPI_STATUS_IGNORE);
+      sources.push_back(status.MPI_SOURCE);
+    }
+    if(barrierActive){
+      int barrierDone;
+      MPI_Test(&barrier, &barrierDone, MPI_STATUS_IGNORE);
+      done = (barrierDone != 0);
+    }
+    else{
+      int sendsDone;
+      MPI_Testall((int)numTargets, (numTargets > 0 ? &sends[0] : NULL), &sendsDone, MPI_STATUSES_IGNORE);
+      if(sendsDone){
+        MPI_Ibarrier(c, &barrier);
+        barrierActive = true;
+      }
+    }
+  }
+  std::sort(sources.begin(), sources.end());
+}
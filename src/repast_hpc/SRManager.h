@@ -140,6 +140,28 @@ public:
    */
   void retrieveSources(const std::vector<int>& targets, std::vector<int>& sources, int tag = 0);
 
+  /**
+   * Determines which processes will send information to this one without
+   * a global all-to-all exchange. Each target is notified with a synchronous
+   * send; this process then receives notifications until a non-blocking
+   * barrier (entered once all of its own notifications have been matched)
+   * completes on every process. Cost is proportional to the number of
+   * partners rather than to the size of the communicator, and no arrays
+   * of communicator size are allocated.
+   *
+   * This is a collective operation: all processes in the communicator must call it.
+   * Consecutive calls on a communicator alternate between two tags; each
+   * communicator counts its own calls, so a process may also make sparse
+   * exchanges on communicators that other processes are not part of.
+   *
+   * @param comm the communicator to use
+   * @param targets vector of integers representing processes to which this one
+   * intends to send information
+   * @param sources vector that will be populated, in ascending order, with the
+   * processes that will send this process information
+   */
+  static void retrieveSourcesSparse(boost::mpi::communicator* comm, const std::vector<int>& targets, std::vector<int>& sources);
+
 };
 
 
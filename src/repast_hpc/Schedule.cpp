@@ -39,15 +39,24 @@
  */
 
 #include "Schedule.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
 #include "Utilities.h"
 #include "logger.h"
 
 #include <iostream>
+#include <limits>
+#include <cmath>
+#include <algorithm>
 #include <boost/mpi.hpp>
 #include <boost/lexical_cast.hpp>
 
 namespace repast {
 
+RepastEvent::RepastEvent() :
+	tick(0), parallelSafe(false) {
+}
+
 RepastEvent::~RepastEvent() {
 //std::cout << func_ptr.use_count() << std::endl;
 }
@@ -89,6 +98,10 @@ bool RepeatingEvent::reschedule(
 	return true;
 }
 
+Schedule::Schedule() :
+	currentTick(0), minimumRepeatingInterval(0), threadPool(0) {
+}
+
 Schedule::~Schedule() {
 	while (!queue.empty()) {
 		ScheduledEvent *evt = queue.top();
@@ -113,22 +126,84 @@ ScheduledEvent* Schedule::schedule_event(double start, double interval, FunctorP
 	evt->tick = start;
 	RepeatingEvent *event = new RepeatingEvent(start, interval, evt);
 	queue.push(event);
+	repeatingEventScheduled(interval);
 	return event;
 }
 
+/**
+ * Wraps a functor so that its executions on a ThreadPool are profiled.
+ */
+class ProfiledFunctor: public Functor {
+private:
+	Functor* func;
+	Profiler* profiler;
+public:
+	ProfiledFunctor(Functor* f, Profiler* p) :
+		func(f), profiler(p) {
+	}
+	void operator()() {
+		double begin = Profiler::now();
+		(*func)();
+		profiler->functor(func, begin, Profiler::now());
+	}
+};
+
+void Schedule::executeEvent(ScheduledEvent* evt) {
+	Functor *func = evt->get_event()->func_ptr.get();
+	Profiler* profiler = Profiler::instance();
+	if (profiler == 0) {
+		(*func)();
+	} else {
+		profiler->setTick(currentTick);
+		double begin = Profiler::now();
+		(*func)();
+		profiler->functor(func, begin, Profiler::now());
+	}
+}
+
+void Schedule::executeParallel(const std::vector<ScheduledEvent*>& batch) {
+	std::vector<Functor*> tasks;
+	tasks.reserve(batch.size());
+	Profiler* profiler = Profiler::instance();
+	if (profiler == 0) {
+		for (size_t i = 0; i < batch.size(); i++)
+			tasks.push_back(batch[i]->get_event()->func_ptr.get());
+		threadPool->run(tasks);
+	} else {
+		profiler->setTick(currentTick);
+		std::vector<ProfiledFunctor> profiled;
+		profiled.reserve(batch.size());
+		for (size_t i = 0; i < batch.size(); i++) {
+			profiled.push_back(ProfiledFunctor(batch[i]->get_event()->func_ptr.get(), profiler));
+			tasks.push_back(&profiled.back());
+		}
+		threadPool->run(tasks);
+	}
+}
+
 void Schedule::execute() {
 	if (!queue.empty()) {
 		ScheduledEvent *evt = queue.top();
 		double next = evt->get_event()->tick;
 		currentTick = next;
 		//std::cout << "execute at: " << currentTick << std::endl;
+		std::vector<ScheduledEvent*> batch;
 		bool go = true;
 		while (go) {
 			queue.pop();
-			Functor *func = evt->get_event()->func_ptr.get();
-			(*func)();
-			bool isLive = evt->reschedule(queue);
-			if (!isLive) delete evt;
+			if (threadPool != 0 && evt->get_event()->parallelSafe) {
+				batch.push_back(evt);
+			} else {
+				if (!batch.empty()) {
+					executeParallel(batch);
+					for (size_t i = 0; i < batch.size(); i++)
+						if (!batch[i]->reschedule(queue)) delete batch[i];
+					batch.clear();
+				}
+				executeEvent(evt);
+				bool isLive = evt->reschedule(queue);
+				if (!isLive) delete evt;
+			}
 			if (queue.empty())
 				go = false;
 			else {
@@ -136,37 +211,269 @@ void Schedule::execute() {
 				go = evt->get_event()->tick == next;
 			}
 		}
+		if (!batch.empty()) {
+			executeParallel(batch);
+			for (size_t i = 0; i < batch.size(); i++)
+				if (!batch[i]->reschedule(queue)) delete batch[i];
+		}
 	}
 	//std::cout << "execute at: " << getCurrentTick() << std::endl;
 }
 
-ScheduleRunner::ScheduleRunner(boost::mpi::communicator* communicator) : go(true), comm(communicator) {
+const size_t CALENDAR_MIN_BUCKETS = 16;
+const size_t CALENDAR_BLOCK_SIZE = 256;
+const size_t CALENDAR_WIDTH_SAMPLE = 25;
+
+CalendarEvent::CalendarEvent() :
+	ScheduledEvent(0, 0), interval(0), sequence(0), prev(0), next(0) {
+	event = &repastEvent;
+}
+
+CalendarEvent::~CalendarEvent() {
+	// repastEvent is a member, so it must not be deleted by ~ScheduledEvent
+	event = 0;
+}
+
+bool CalendarEvent::reschedule(std::priority_queue<ScheduledEvent *, std::vector<ScheduledEvent*>, EventCompare>&) {
+	return false;
+}
+
+CalendarQueueSchedule::CalendarQueueSchedule() :
+	heads(CALENDAR_MIN_BUCKETS, (CalendarEvent*) 0), tails(CALENDAR_MIN_BUCKETS, (CalendarEvent*) 0),
+			mask(CALENDAR_MIN_BUCKETS - 1), width(1), count(0), sequence(0), cursorSlot(0), freeList(0) {
+}
+
+CalendarQueueSchedule::~CalendarQueueSchedule() {
+	for (size_t i = 0; i < blocks.size(); i++)
+		delete[] blocks[i];
+}
+
+long long CalendarQueueSchedule::slotOf(double tick) const {
+	return (long long) std::floor(tick / width);
 }
 
-ScheduleRunner::~ScheduleRunner() {}
+CalendarEvent* CalendarQueueSchedule::acquire() {
+	if (freeList == 0) {
+		CalendarEvent* block = new CalendarEvent[CALENDAR_BLOCK_SIZE];
+		blocks.push_back(block);
+		for (size_t i = 0; i < CALENDAR_BLOCK_SIZE; i++) {
+			block[i].next = freeList;
+			freeList = &block[i];
+		}
+	}
+	CalendarEvent* evt = freeList;
+	freeList = evt->next;
+	evt->prev = evt->next = 0;
+	return evt;
+}
+
+void CalendarQueueSchedule::release(CalendarEvent* evt) {
+	evt->repastEvent.func_ptr.reset();
+	evt->repastEvent.parallelSafe = false;
+	evt->prev = 0;
+	evt->next = freeList;
+	freeList = evt;
+}
+
+void CalendarQueueSchedule::link(CalendarEvent* evt) {
+	double tick = evt->repastEvent.tick;
+	size_t bucket = (size_t) slotOf(tick) & mask;
+
+	// Buckets are ordered by (tick, sequence); new events usually go at the end
+	CalendarEvent* after = tails[bucket];
+	while (after != 0 && (after->repastEvent.tick > tick || (after->repastEvent.tick == tick && after->sequence > evt->sequence)))
+		after = after->prev;
+	evt->prev = after;
+	evt->next = (after != 0 ? after->next : heads[bucket]);
+	if (evt->next != 0) evt->next->prev = evt;
+	else tails[bucket] = evt;
+	if (after != 0) after->next = evt;
+	else heads[bucket] = evt;
+
+	long long slot = slotOf(tick);
+	if (count == 0 || slot < cursorSlot) cursorSlot = slot;
+	count++;
+}
+
+void CalendarQueueSchedule::insert(CalendarEvent* evt) {
+	link(evt);
+	if (count > 2 * heads.size()) resize(heads.size() * 2);
+}
+
+void CalendarQueueSchedule::remove(CalendarEvent* evt) {
+	size_t bucket = (size_t) slotOf(evt->repastEvent.tick) & mask;
+	if (evt->prev != 0) evt->prev->next = evt->next;
+	else heads[bucket] = evt->next;
+	if (evt->next != 0) evt->next->prev = evt->prev;
+	else tails[bucket] = evt->prev;
+	evt->prev = evt->next = 0;
+	count--;
+	if (heads.size() > CALENDAR_MIN_BUCKETS && count < heads.size() / 2) resize(heads.size() / 2);
+}
+
+CalendarEvent* CalendarQueueSchedule::findMin() const {
+	if (count == 0) return 0;
+
+	// Look for an event in the current slot of each bucket, for one year
+	long long slot = cursorSlot;
+	for (size_t i = 0, n = heads.size(); i < n; i++, slot++) {
+		CalendarEvent* head = heads[(size_t) slot & mask];
+		if (head != 0 && slotOf(head->repastEvent.tick) <= slot) {
+			cursorSlot = slot;
+			return head;
+		}
+	}
+
+	// Nothing within a year of the cursor, so search the bucket heads directly
+	CalendarEvent* best = 0;
+	for (size_t i = 0, n = heads.size(); i < n; i++) {
+		CalendarEvent* head = heads[i];
+		if (head != 0 && (best == 0 || head->repastEvent.tick < best->repastEvent.tick
+				|| (head->repastEvent.tick == best->repastEvent.tick && head->sequence < best->sequence)))
+			best = head;
+	}
+	cursorSlot = slotOf(best->repastEvent.tick);
+	return best;
+}
+
+void CalendarQueueSchedule::resize(size_t numBuckets) {
+	std::vector<CalendarEvent*> events;
+	events.reserve(count);
+	for (size_t i = 0, n = heads.size(); i < n; i++) {
+		for (CalendarEvent* evt = heads[i]; evt != 0; evt = evt->next)
+			events.push_back(evt);
+	}
+
+	// Bucket width is a few times the average separation of the earliest events
+	if (events.size() > 1) {
+		size_t sampleSize = std::min(events.size(), CALENDAR_WIDTH_SAMPLE);
+		std::vector<double> ticks(events.size());
+		for (size_t i = 0; i < events.size(); i++)
+			ticks[i] = events[i]->repastEvent.tick;
+		std::partial_sort(ticks.begin(), ticks.begin() + sampleSize, ticks.end());
+		double separation = (ticks[sampleSize - 1] - ticks[0]) / (sampleSize - 1);
+		if (separation > 0) width = 3 * separation;
+	}
+
+	heads.assign(numBuckets, (CalendarEvent*) 0);
+	tails.assign(numBuckets, (CalendarEvent*) 0);
+	mask = numBuckets - 1;
+	count = 0;
+	for (size_t i = 0; i < events.size(); i++)
+		link(events[i]);
+}
+
+ScheduledEvent* CalendarQueueSchedule::schedule_event(double at, FunctorPtr func) {
+	CalendarEvent* evt = acquire();
+	evt->repastEvent.func_ptr = func;
+	evt->repastEvent.tick = at;
+	evt->start = at;
+	evt->interval = 0;
+	evt->sequence = sequence++;
+	insert(evt);
+	return evt;
+}
+
+ScheduledEvent* CalendarQueueSchedule::schedule_event(double start, double interval, FunctorPtr func) {
+	CalendarEvent* evt = acquire();
+	evt->repastEvent.func_ptr = func;
+	evt->repastEvent.tick = start;
+	evt->start = start;
+	evt->interval = interval;
+	evt->sequence = sequence++;
+	insert(evt);
+	repeatingEventScheduled(interval);
+	return evt;
+}
+
+void CalendarQueueSchedule::finish(CalendarEvent* evt) {
+	if (evt->interval > 0) {
+		evt->repastEvent.tick += evt->interval;
+		evt->sequence = sequence++;
+		insert(evt);
+	} else {
+		release(evt);
+	}
+}
+
+void CalendarQueueSchedule::execute() {
+	CalendarEvent* evt = findMin();
+	if (evt == 0) return;
+	double next = evt->repastEvent.tick;
+	currentTick = next;
+	std::vector<ScheduledEvent*> batch;
+	while (evt != 0 && evt->repastEvent.tick == next) {
+		remove(evt);
+		if (threadPool != 0 && evt->repastEvent.parallelSafe) {
+			batch.push_back(evt);
+		} else {
+			if (!batch.empty()) {
+				executeParallel(batch);
+				for (size_t i = 0; i < batch.size(); i++)
+					finish(static_cast<CalendarEvent*>(batch[i]));
+				batch.clear();
+			}
+			executeEvent(evt);
+			finish(evt);
+		}
+		evt = findMin();
+	}
+	if (!batch.empty()) {
+		executeParallel(batch);
+		for (size_t i = 0; i < batch.size(); i++)
+			finish(static_cast<CalendarEvent*>(batch[i]));
+	}
+}
+
+double CalendarQueueSchedule::getNextTick() const {
+	CalendarEvent* evt = findMin();
+	if (evt == 0) return -1;
+	return evt->repastEvent.tick;
+}
+
+ScheduleRunner::ScheduleRunner(boost::mpi::communicator* communicator, SCHEDULE_BACKEND backend) : go(true),
+		schedule_(backend == CALENDAR_QUEUE ? new CalendarQueueSchedule() : new Schedule()), comm(communicator),
+		syncInterval(0), deriveSyncInterval(false) {
+}
+
+ScheduleRunner::~ScheduleRunner() {
+	delete schedule_;
+}
 
 void ScheduleRunner::nextTick() {
-	localNextTick = schedule_.getNextTick();
+	localNextTick = schedule_->getNextTick();
 }
 
 void ScheduleRunner::scheduleStop(double at) {
 	MethodFunctor<ScheduleRunner> *mf = new MethodFunctor<ScheduleRunner> (this, &ScheduleRunner::stop);
-	schedule_.schedule_event(at, Schedule::FunctorPtr(mf));
+	schedule_->schedule_event(at, Schedule::FunctorPtr(mf));
 	nextTick();
 }
 
 ScheduledEvent* ScheduleRunner::scheduleEvent(double at, Schedule::FunctorPtr func) {
-	ScheduledEvent *evt = schedule_.schedule_event(at, func);
+	ScheduledEvent *evt = schedule_->schedule_event(at, func);
 	nextTick();
 	return evt;
 }
 
 ScheduledEvent* ScheduleRunner::scheduleEvent(double start, double interval, Schedule::FunctorPtr func) {
-	ScheduledEvent *evt = schedule_.schedule_event(start, interval, func);
+	ScheduledEvent *evt = schedule_->schedule_event(start, interval, func);
 	nextTick();
 	return evt;
 }
 
+ScheduledEvent* ScheduleRunner::scheduleEvent(double at, Schedule::FunctorPtr func, bool parallelSafe) {
+	ScheduledEvent *evt = scheduleEvent(at, func);
+	evt->get_event()->parallelSafe = parallelSafe;
+	return evt;
+}
+
+ScheduledEvent* ScheduleRunner::scheduleEvent(double start, double interval, Schedule::FunctorPtr func, bool parallelSafe) {
+	ScheduledEvent *evt = scheduleEvent(start, interval, func);
+	evt->get_event()->parallelSafe = parallelSafe;
+	return evt;
+}
+
 void ScheduleRunner::stop() {
 	go = false;
 }
@@ -175,15 +482,41 @@ void ScheduleRunner::scheduleEndEvent(Schedule::FunctorPtr func) {
 	endEvents.push_back(func);
 }
 
+void ScheduleRunner::setSynchronizationInterval(double interval) {
+	syncInterval = interval;
+	deriveSyncInterval = false;
+}
+
+void ScheduleRunner::deriveSynchronizationInterval() {
+	deriveSyncInterval = true;
+}
+
 void ScheduleRunner::run() {
-	//Timer timer;
+	if (deriveSyncInterval) {
+		// Processes without repeating events report 0; treat that as 'no constraint'
+		double localInterval = schedule_->getMinimumRepeatingInterval();
+		if (localInterval <= 0) localInterval = std::numeric_limits<double>::max();
+		all_reduce(*comm, localInterval, syncInterval, boost::mpi::minimum<double>());
+		if (syncInterval == std::numeric_limits<double>::max()) syncInterval = 0;
+	}
+
 	while (go) {
-		//timer.start();
+		Profiler* profiler = Profiler::instance();
+		double begin = (profiler != 0 ? Profiler::now() : 0);
 		all_reduce(*comm, localNextTick, globalNextTick, boost::mpi::minimum<double>());//&localNextTick, &globalNextTick, 1, MPI::DOUBLE, MPI::MIN);
-		//Log4CL::instance()->get_logger("root").log(INFO, "schedule idle, time: " + boost::lexical_cast<std::string>(timer.stop()));
-		if (localNextTick == globalNextTick)
-			schedule_.execute();
-		nextTick();
+		if (profiler != 0) profiler->phase("ScheduleRunner", "nextTickAllReduce", begin);
+		if (syncInterval > 0) {
+			// Execute every local event in the window without further collectives
+			double windowEnd = globalNextTick + syncInterval;
+			while (go && localNextTick != -1 && localNextTick < windowEnd) {
+				schedule_->execute();
+				nextTick();
+			}
+		} else {
+			if (localNextTick == globalNextTick)
+				schedule_->execute();
+			nextTick();
+		}
 	}
 	// execute end events
 	for (size_t i = 0; i < endEvents.size(); i++) {
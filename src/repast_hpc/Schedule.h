@@ -49,6 +49,8 @@
 
 namespace repast {
 
+class ThreadPool;
+
 /**
  * Functor interface.
  */
@@ -91,7 +93,13 @@ class RepastEvent {
 public:
 	double tick;
 	boost::shared_ptr<Functor> func_ptr;
+	/**
+	 * Whether the functor may run concurrently with other
+	 * parallel safe functors scheduled for the same tick.
+	 */
+	bool parallelSafe;
 
+	RepastEvent();
 	virtual ~RepastEvent();
 
 };
@@ -174,13 +182,37 @@ class Schedule {
 private:
 	typedef std::priority_queue<ScheduledEvent *, std::vector<ScheduledEvent*>, EventCompare> QueueType;
 	QueueType queue;
+
+protected:
 	double currentTick;
+	double minimumRepeatingInterval;
+	ThreadPool* threadPool;
+
+	/**
+	 * Runs the functor of the specified event, timing it if profiling is enabled.
+	 */
+	void executeEvent(ScheduledEvent* evt);
+
+	/**
+	 * Runs the functors of the specified events concurrently on the
+	 * thread pool, returning when all have completed.
+	 */
+	void executeParallel(const std::vector<ScheduledEvent*>& batch);
+
+	/**
+	 * Records the interval of a newly scheduled repeating event.
+	 */
+	void repeatingEventScheduled(double interval) {
+		if (interval > 0 && (minimumRepeatingInterval == 0 || interval < minimumRepeatingInterval))
+			minimumRepeatingInterval = interval;
+	}
 
 public:
 	/**
 	 * Typedef of for the functors that get scheduled.
 	 */
 	typedef boost::shared_ptr<Functor> FunctorPtr;
+	Schedule();
 	virtual ~Schedule();
 
 	/**
@@ -191,7 +223,7 @@ public:
 	 *
 	 * @return the event that has been scheduled
 	 */
-	ScheduledEvent* schedule_event(double at, FunctorPtr functor);
+	virtual ScheduledEvent* schedule_event(double at, FunctorPtr functor);
 
 	/**
 	 * Schedules the specified functor to execute start at start, and at the specified interval
@@ -203,8 +235,25 @@ public:
 	 *
 	 * @return the event that has been scheduled
 	 */
-	ScheduledEvent* schedule_event(double start, double interval, FunctorPtr func);
-	void execute();
+	virtual ScheduledEvent* schedule_event(double start, double interval, FunctorPtr func);
+
+	/**
+	 * Executes all the events scheduled for the next tick. Events marked as
+	 * parallel safe that are consecutive in the tick's execution order are
+	 * executed concurrently on the thread pool, if there is one, and all of
+	 * them complete before the next event that is not parallel safe starts.
+	 */
+	virtual void execute();
+
+	/**
+	 * Sets the thread pool used to execute parallel safe events. If this is
+	 * 0 (the default) all events are executed serially.
+	 *
+	 * @param pool the thread pool; it is not deleted by this Schedule
+	 */
+	void setThreadPool(ThreadPool* pool) {
+		threadPool = pool;
+	}
 
 	/**
 	 * Gets the current simulation tick.
@@ -221,12 +270,96 @@ public:
 	 *
 	 * @return the next tick at which the next events will be executed.
 	 */
-	double getNextTick() const {
+	virtual double getNextTick() const {
 		if (queue.empty())
 			return -1;
 		return queue.top()->get_event()->tick;
 	}
 	;
+
+	/**
+	 * Gets the shortest interval of all the repeating events that
+	 * have been scheduled on this Schedule.
+	 *
+	 * @return the shortest repeating interval, or 0 if no repeating
+	 * events have been scheduled.
+	 */
+	double getMinimumRepeatingInterval() const {
+		return minimumRepeatingInterval;
+	}
+};
+
+/**
+ * ScheduledEvent used by the CalendarQueueSchedule. These are
+ * allocated in blocks and recycled by the schedule, and carry
+ * their RepastEvent with them rather than allocating it separately.
+ */
+class CalendarEvent: public ScheduledEvent {
+
+	friend class CalendarQueueSchedule;
+
+private:
+	RepastEvent repastEvent;
+	double interval;
+	unsigned long sequence;
+	CalendarEvent* prev;
+	CalendarEvent* next;
+
+public:
+	CalendarEvent();
+	~CalendarEvent();
+
+	/**
+	 * Always returns false; repeating calendar events are
+	 * rescheduled by the CalendarQueueSchedule itself.
+	 */
+	virtual bool reschedule(std::priority_queue<ScheduledEvent *, std::vector<ScheduledEvent*>, EventCompare>&);
+};
+
+/**
+ * Schedule backed by a calendar queue: events are hashed by tick into
+ * an array of buckets, each one year of buckets wide, and the number of
+ * buckets and their width are adjusted as the queue grows and shrinks.
+ * Insertion and removal are amortized O(1). Event nodes are pooled, so
+ * scheduling an event does not allocate once the pool has grown.
+ *
+ * Events scheduled for the same tick are executed in the order in which
+ * they were scheduled; a repeating event counts as scheduled for its next
+ * tick when it is rescheduled after executing.
+ */
+class CalendarQueueSchedule: public Schedule {
+
+private:
+	std::vector<CalendarEvent*> heads, tails;
+	size_t mask;
+	double width;
+	size_t count;
+	unsigned long sequence;
+
+	// the search cursor: no event has a tick in a slot before this one
+	mutable long long cursorSlot;
+
+	std::vector<CalendarEvent*> blocks;
+	CalendarEvent* freeList;
+
+	long long slotOf(double tick) const;
+	CalendarEvent* acquire();
+	void release(CalendarEvent* evt);
+	void finish(CalendarEvent* evt);
+	void link(CalendarEvent* evt);
+	void insert(CalendarEvent* evt);
+	void remove(CalendarEvent* evt);
+	CalendarEvent* findMin() const;
+	void resize(size_t numBuckets);
+
+public:
+	CalendarQueueSchedule();
+	virtual ~CalendarQueueSchedule();
+
+	virtual ScheduledEvent* schedule_event(double at, FunctorPtr functor);
+	virtual ScheduledEvent* schedule_event(double start, double interval, FunctorPtr func);
+	virtual void execute();
+	virtual double getNextTick() const;
 };
 
 /**
@@ -240,14 +373,25 @@ class ScheduleRunner: public boost::noncopyable {
 private:
 
 	bool go;
-	Schedule schedule_;
+	Schedule* schedule_;
 	double globalNextTick, localNextTick;
 	void nextTick();
 	boost::mpi::communicator* comm;
 	std::vector<boost::shared_ptr<Functor> > endEvents;
+	double syncInterval;
+	bool deriveSyncInterval;
 
 public:
-	ScheduleRunner(boost::mpi::communicator* communicator);
+	/**
+	 * The data structures that can be used to hold the scheduled events.
+	 * PRIORITY_QUEUE is a binary heap; CALENDAR_QUEUE is a CalendarQueueSchedule,
+	 * which is faster when large numbers of events are scheduled.
+	 */
+	enum SCHEDULE_BACKEND {
+		PRIORITY_QUEUE, CALENDAR_QUEUE
+	};
+
+	ScheduleRunner(boost::mpi::communicator* communicator, SCHEDULE_BACKEND backend = PRIORITY_QUEUE);
 	~ScheduleRunner();
 
 	/**
@@ -272,6 +416,43 @@ public:
 	 */
 	ScheduledEvent* scheduleEvent(double start, double interval, Schedule::FunctorPtr func);
 
+	/**
+	 * Schedules the Functor to execute at the specified tick, optionally
+	 * marking it as parallel safe. Parallel safe functors that fall
+	 * together in a tick may be executed concurrently on the thread pool
+	 * set with setThreadPool. They must not schedule events, use MPI, or
+	 * modify state that other functors in the same tick read or write.
+	 *
+	 * @param at the time to execute at
+	 * @param func the functor to execute
+	 * @param parallelSafe whether the functor may run concurrently
+	 *
+	 * @return the event that was scheduled for the func
+	 */
+	ScheduledEvent* scheduleEvent(double at, Schedule::FunctorPtr func, bool parallelSafe);
+
+	/**
+	 * Schedules the Functor to execute at the specified start tick
+	 * and every interval thereafter, optionally marking it as parallel safe.
+	 *
+	 * @param start the time to start at
+	 * @param interval the interval to execute at
+	 * @param func the functor to execute
+	 * @param parallelSafe whether the functor may run concurrently
+	 *
+	 * @return the event that was scheduled for the func
+	 */
+	ScheduledEvent* scheduleEvent(double start, double interval, Schedule::FunctorPtr func, bool parallelSafe);
+
+	/**
+	 * Sets the thread pool used to execute parallel safe events.
+	 *
+	 * @param pool the thread pool, or 0 to execute all events serially
+	 */
+	void setThreadPool(ThreadPool* pool) {
+		schedule_->setThreadPool(pool);
+	}
+
 	/**
 	 * Schedules the specified functor to execute when the simulation ends.
 	 *
@@ -286,6 +467,42 @@ public:
 	 */
 	void scheduleStop(double at);
 
+	/**
+	 * Sets the interval at which the processes agree on the next tick to
+	 * execute. By default (an interval of 0) all processes agree on the
+	 * next tick before every tick. With a positive interval each process
+	 * executes all of its local events in the window [T, T + interval),
+	 * where T is the global next tick, without any collective operation,
+	 * and the processes agree again only once the window is exhausted.
+	 *
+	 * This requires a lookahead of at least the interval: any event that
+	 * involves communication between processes must be scheduled at the same
+	 * ticks on all of them, and events scheduled as a result of
+	 * communication must not fall before the end of the current window.
+	 *
+	 * @param interval the synchronization interval, or 0 to synchronize
+	 * every tick
+	 */
+	void setSynchronizationInterval(double interval);
+
+	/**
+	 * Derives the synchronization interval (see setSynchronizationInterval)
+	 * from the repeating events in the schedule when run() is called: the
+	 * interval is the shortest repeating interval on any process. If there
+	 * are no repeating events, the processes synchronize every tick.
+	 */
+	void deriveSynchronizationInterval();
+
+	/**
+	 * Gets the synchronization interval. This is 0 if processes synchronize
+	 * every tick.
+	 *
+	 * @return the synchronization interval.
+	 */
+	double getSynchronizationInterval() const {
+		return syncInterval;
+	}
+
 	/**
 	 * Starts and runs the simulation schedule.
 	 */
@@ -297,7 +514,7 @@ public:
 	 * @return the current tick
 	 */
 	double currentTick() {
-		return schedule_.getCurrentTick();
+		return schedule_->getCurrentTick();
 	}
 
 	/**
@@ -311,7 +528,7 @@ public:
 	 * @return the schedule used by this simulation runner.
 	 */
 	const Schedule& schedule() {
-		return schedule_;
+		return *schedule_;
 	}
 };
 
@@ -46,6 +46,7 @@
 #include <iostream>
 #include <algorithm>
 #include <sstream>
+#include <limits>
 
 #include "BaseGrid.h"
 #include "GridComponents.h"
@@ -56,6 +57,7 @@
 #include "RepastErrors.h"
 #include "RelativeLocation.h"
 #include "CartesianTopology.h"
+#include "SpaceFillingCurve.h"
 
 namespace repast {
 
@@ -104,6 +106,14 @@ public:
 	 */
 	void addNeighbor(Neighbor* ngh, RelativeLocation relLoc);
 
+	/**
+	 * Adds a neighbor that has no relative location (for example,
+	 * one found along a SpaceFillingCurve).
+	 */
+	void addNeighbor(Neighbor* ngh){
+	  nghs.push_back(ngh);
+	}
+
 	/**
 	 * Gets the neighbor at the specified location.
 	 *
@@ -143,6 +153,21 @@ public:
 
 std::ostream& operator<<(std::ostream& os, const Neighbors& nghs);
 
+/**
+ * Sets the region of a shared grid's cell accessor. Overloads for accessors
+ * that allocate storage for the whole region (see DenseOccupancy) may use
+ * the coverage, the fraction of the region that the process owns, to avoid
+ * allocating for a region that is mostly owned by other processes.
+ *
+ * @param cells the cell accessor
+ * @param bounds the local bounds plus the buffer
+ * @param coverage the fraction of the local bounds that the process owns
+ */
+template<typename CellAccessor>
+void initCellAccessor(CellAccessor& cells, const GridDimensions& bounds, double coverage){
+  cells.init(bounds);
+}
+
 
 
 /**
@@ -163,12 +188,15 @@ std::ostream& operator<<(std::ostream& os, const Neighbors& nghs);
  * @tparam Adder determines how objects are added to the grid from its associated context.
  * @tparam GPType the coordinate type of the grid point locations. This must
  * be an int or a double.
+ * @tparam CellAccessor implements the storage of the grid's cells. Its region
+ * is set to the local bounds plus the buffer (see initCellAccessor and DenseOccupancy).
  */
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-class SharedBaseGrid: public BaseGrid<T, MultipleOccupancy<T, GPType> , GPTransformer, Adder, GPType> {
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor = MultipleOccupancy<T, GPType> >
+class SharedBaseGrid: public BaseGrid<T, CellAccessor, GPTransformer, Adder, GPType> {
 
 private:
   CartesianTopology* cartTopology;
+  SpaceFillingCurve* curve;         // Used instead of the CartesianTopology when not null
 
 protected:
 	int _buffer;
@@ -182,12 +210,78 @@ protected:
 	virtual void synchMoveTo(const AgentId& id, const Point<GPType>& pt) = 0;
 
 	int rank;
-	typedef typename repast::BaseGrid<T, MultipleOccupancy<T, GPType> , GPTransformer, Adder, GPType> GridBaseType;
+	typedef typename repast::BaseGrid<T, CellAccessor, GPTransformer, Adder, GPType> GridBaseType;
 	boost::mpi::communicator* comm;
 
+	/**
+	 * Creates the Neighbors for the current local bounds
+	 */
+	void createNeighbors();
+
+	/**
+	 * Gets the local bounds widened by the buffer on each side, clipped
+	 * to the global bounds: the region in which this grid can hold agents.
+	 */
+	GridDimensions bufferedBounds() const;
+
+	/**
+	 * Sets the region of the cell accessor to the buffered bounds (see
+	 * initCellAccessor)
+	 */
+	void initCellRegion();
+
+	/**
+	 * Finds the local agents that lie within the buffer distance of other
+	 * processes' regions along the space-filling curve
+	 */
+	void getAgentsToPushAlongCurve(std::set<AgentId>& agentsToTest, std::map<int, std::set<AgentId> >& agentsToPush);
+
 public:
   void balance();
 
+  /**
+   * Moves the process boundaries so that the number of local agents
+   * in this grid is spread evenly across processes. See
+   * rebalance(double, double).
+   *
+   * @param threshold if greater than zero, the boundaries are only moved
+   * when the ratio of the maximum to the mean number of local agents
+   * exceeds this value
+   *
+   * @return true if the boundaries moved
+   */
+  bool rebalance(double threshold = 0);
+
+  /**
+   * Moves the process boundaries so that the given load (for example,
+   * the measured time spent on this process) is spread evenly across
+   * processes. This is a collective call. If the boundaries move, the
+   * local bounds of this grid are updated and local agents that now lie
+   * on another process are marked for moving with RepastProcess::moveAgent;
+   * the caller must then call RepastProcess::synchronizeAgentStatus and
+   * synchronizeProjectionInfo (with the POLL exchange pattern, as the
+   * neighboring processes may have changed). Other grids and value
+   * layers that share this grid's process topology must be updated
+   * with updateBoundaries or repartition before the synchronization.
+   * The boundaries of discrete grids are placed on whole units; those of
+   * continuous spaces may fall anywhere.
+   *
+   * @param load the load on this process
+   * @param threshold if greater than zero, the boundaries are only moved
+   * when the ratio of the maximum load to the mean load exceeds this value
+   *
+   * @return true if the boundaries moved
+   */
+  bool rebalance(double load, double threshold);
+
+  /**
+   * Updates the local bounds and neighbors of this grid after the
+   * boundaries of its process topology (or the ranges of its space-filling
+   * curve) have moved, and marks local agents
+   * that now lie outside the local bounds for moving.
+   */
+  void updateBoundaries();
+
 	// overriding moveTo that takes newLocation hides the moveTo in the
 	// Grid base class that takes a Point. This using directive
 	// makes the Point arg moveTo available.
@@ -204,6 +298,22 @@ public:
 	 * and its neighbors.
 	 */
 	SharedBaseGrid(std::string name, GridDimensions gridDims, std::vector<int> processDims, int buffer, boost::mpi::communicator* communicator);
+
+	/**
+	 * Creates a SharedGrid with the specified name that is divided among
+	 * processes along a space-filling curve rather than a process grid. Any
+	 * number of processes may be used. The local bounds of the grid are the
+	 * smallest box containing the region owned by this process; the region
+	 * itself need not be rectangular.
+	 *
+	 * @param name the name of this SharedBaseGrid
+	 * @param gridDims the dimensions of the entire pan-process grid
+	 * @param spaceFillingCurve the curve that divides the grid among processes;
+	 * it is not deleted by the grid, and may be shared by several grids
+	 * @param buffer the size of the buffer between this part of the pan-process grid
+	 * and its neighbors.
+	 */
+	SharedBaseGrid(std::string name, GridDimensions gridDims, SpaceFillingCurve* spaceFillingCurve, int buffer, boost::mpi::communicator* communicator);
 	virtual ~SharedBaseGrid();
 
 	/**
@@ -256,10 +366,10 @@ public:
 
 };
 
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-SharedBaseGrid<T, GPTransformer, Adder, GPType>::SharedBaseGrid(std::string name, GridDimensions gridDims, std::vector<
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::SharedBaseGrid(std::string name, GridDimensions gridDims, std::vector<
 		int> processDims, int buffer, boost::mpi::communicator* communicator) :
-	GridBaseType(name, gridDims), _buffer(buffer), comm(communicator), globalBounds(gridDims) {
+	GridBaseType(name, gridDims), curve(0), _buffer(buffer), comm(communicator), globalBounds(gridDims) {
 
   int dimCount = gridDims.dimensionCount();
 	if (processDims.size() != dimCount)
@@ -270,13 +380,40 @@ SharedBaseGrid<T, GPTransformer, Adder, GPType>::SharedBaseGrid(std::string name
 
 	cartTopology = RepastProcess::instance()->getCartesianTopology(processDims, periodic);
 
-	std::vector<int> coords;
-	cartTopology->getCoordinates(rank, coords);
-
 	localBounds = cartTopology->getDimensions(rank, gridDims);
 	GridBaseType::adder.init(localBounds, this);
+	initCellRegion();
+
+  createNeighbors();
+}
 
-  RelativeLocation relLocUntrimmed(dimCount);
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::SharedBaseGrid(std::string name, GridDimensions gridDims,
+    SpaceFillingCurve* spaceFillingCurve, int buffer, boost::mpi::communicator* communicator) :
+  GridBaseType(name, gridDims), cartTopology(0), curve(spaceFillingCurve), _buffer(buffer), comm(communicator), globalBounds(gridDims) {
+
+  rank = comm->rank();
+  localBounds = curve->getBounds(rank);
+  GridBaseType::adder.init(localBounds, this);
+  initCellRegion();
+
+  createNeighbors();
+}
+
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+void SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::createNeighbors() {
+  if(curve != 0){
+    std::set<int> ranks;
+    curve->getNeighborRanks(rank, _buffer, ranks);
+    nghs = new Neighbors(0);
+    for(std::set<int>::iterator iter = ranks.begin(); iter != ranks.end(); ++iter) nghs->addNeighbor(new Neighbor(*iter, curve->getBounds(*iter)));
+    return;
+  }
+
+  std::vector<int> coords;
+  cartTopology->getCoordinates(rank, coords);
+
+  RelativeLocation relLocUntrimmed(globalBounds.dimensionCount());
   RelativeLocation relLoc = cartTopology->trim(rank, relLocUntrimmed);
 
 	nghs = new Neighbors(relLoc.getMaxIndex() + 1);
@@ -285,21 +422,48 @@ SharedBaseGrid<T, GPTransformer, Adder, GPType>::SharedBaseGrid(std::string name
     vector<int> currentVal = relLoc.getCurrentValue();
     int rankOfNeighbor = cartTopology->getRank(coords, currentVal);
     if(rankOfNeighbor != rank && rankOfNeighbor != MPI_PROC_NULL){ // Note: the test for MPI_PROC_NULL is vestigial; by trimming the Relative Location, there should never be any
-      Neighbor* ngh = new Neighbor(rankOfNeighbor, cartTopology->getDimensions(rankOfNeighbor, gridDims));
+      Neighbor* ngh = new Neighbor(rankOfNeighbor, cartTopology->getDimensions(rankOfNeighbor, globalBounds));
       nghs->addNeighbor(ngh, relLoc);
     }
   }while(relLoc.increment());
+}
+
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+GridDimensions SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::bufferedBounds() const {
+  std::vector<double> origin, extents;
+  for(size_t i = 0; i < localBounds.dimensionCount(); i++){
+    double lower = std::max(localBounds.origin(i) - _buffer, globalBounds.origin(i));
+    double upper = std::min(localBounds.origin(i) + localBounds.extents(i) + _buffer, globalBounds.origin(i) + globalBounds.extents(i));
+    origin.push_back(lower);
+    extents.push_back(upper - lower);
+  }
+  return GridDimensions(Point<double>(origin), Point<double>(extents));
+}
 
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+void SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::initCellRegion() {
+  // The local bounds along a space-filling curve are the box around the owned blocks, which may be mostly empty
+  double coverage = 1;
+  if(curve != 0){
+    double boxVolume = 1, blockVolume = 1;
+    GridDimensions block = curve->getBlockBounds(0);
+    for(size_t i = 0; i < localBounds.dimensionCount(); i++){
+      boxVolume   *= localBounds.extents(i);
+      blockVolume *= block.extents(i);
+    }
+    if(boxVolume > 0) coverage = curve->ownedBlockCount(rank) * blockVolume / boxVolume;
+  }
+  initCellAccessor(GridBaseType::cells(), bufferedBounds(), coverage);
 }
 
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-SharedBaseGrid<T, GPTransformer, Adder, GPType>::~SharedBaseGrid() {
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::~SharedBaseGrid() {
   delete nghs;
 }
 
 
-//template<typename T, typename GPTransformer, typename Adder, typename GPType>
-//GridDimensions SharedBaseGrid<T, GPTransformer, Adder, GPType>::createSendBufferBounds(std::vector<int> relativeLocation) {
+//template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+//GridDimensions SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::createSendBufferBounds(std::vector<int> relativeLocation) {
 //	Point<double> localOrigin = localBounds.origin();
 //	Point<double> localExtent = localBounds.extents();
 //
@@ -340,45 +504,101 @@ SharedBaseGrid<T, GPTransformer, Adder, GPType>::~SharedBaseGrid() {
 //}
 
 
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-void SharedBaseGrid<T, GPTransformer, Adder, GPType>::balance() {
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+void SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::balance() {
   int r = comm->rank();
   typename GridBaseType::LocationMapConstIter iterEnd = GridBaseType::locationsEnd();
   for (typename GridBaseType::LocationMapConstIter iter = GridBaseType::locationsBegin(); iter != iterEnd; ++iter) {
     AgentId id = iter->second->ptr->getId();
     if(id.currentRank() == r){                                   // Local agents only
       Point<GPType> loc = iter->second->point;
-      if(!localBounds.contains(loc)){                            // If inside bounds, ignore
+      if(curve != 0){
+        std::vector<double> pt(loc.coords().begin(), loc.coords().end());
+        int owner = curve->rankOf(pt);
+        if(owner != r) RepastProcess::instance()->moveAgent(id, owner);
+      }
+      else if(!localBounds.contains(loc)){                       // If inside bounds, ignore
         Neighbor* ngh = nghs->findNeighbor(loc.coords());
-        RepastProcess::instance()->moveAgent(id, ngh->rank());
+        if(ngh != 0) RepastProcess::instance()->moveAgent(id, ngh->rank());
+        else{                                                    // After a rebalance the owner may not be adjacent
+          std::vector<double> pt(loc.coords().begin(), loc.coords().end());
+          RepastProcess::instance()->moveAgent(id, cartTopology->getRankContaining(pt, globalBounds));
+        }
+      }
+    }
+  }
+}
+
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+bool SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::rebalance(double threshold) {
+  double load = 0;
+  typename GridBaseType::LocationMapConstIter iterEnd = GridBaseType::locationsEnd();
+  for (typename GridBaseType::LocationMapConstIter iter = GridBaseType::locationsBegin(); iter != iterEnd; ++iter) {
+    if(iter->second->ptr->getId().currentRank() == rank) load++;
+  }
+  return rebalance(load, threshold);
+}
+
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+bool SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::rebalance(double load, double threshold) {
+  if(curve != 0){
+    // The load is attributed to the curve's blocks in proportion to the local agents in each
+    std::vector<double> blockLoads(curve->blockCount(), 0);
+    double count = 0;
+    typename GridBaseType::LocationMapConstIter iterEnd = GridBaseType::locationsEnd();
+    for (typename GridBaseType::LocationMapConstIter iter = GridBaseType::locationsBegin(); iter != iterEnd; ++iter) {
+      if(iter->second->ptr->getId().currentRank() == rank){
+        const std::vector<GPType>& loc = iter->second->point.coords();
+        blockLoads[curve->blockOf(std::vector<double>(loc.begin(), loc.end()))]++;
+        count++;
       }
     }
+    if(count > 0) for(size_t i = 0; i < blockLoads.size(); i++) blockLoads[i] *= load / count;
+    if(!curve->partition(blockLoads, threshold)) return false;
   }
+  else if(!cartTopology->rebalance(load, globalBounds, (_buffer > 0 ? _buffer : 1), threshold, std::numeric_limits<GPType>::is_integer)) return false;
+  updateBoundaries();
+  return true;
 }
 
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-bool SharedBaseGrid<T, GPTransformer, Adder, GPType>::moveTo(const AgentId& id, const Point<GPType>& newLocation) {
-	return SharedBaseGrid<T, GPTransformer, Adder, GPType>::moveTo(id, newLocation.coords());
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+void SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::updateBoundaries() {
+  localBounds = (curve != 0 ? curve->getBounds(rank) : cartTopology->getDimensions(rank, globalBounds));
+  GridBaseType::adder.init(localBounds, this);
+  initCellRegion();
+  delete nghs;
+  createNeighbors();
+  balance();
 }
 
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-bool SharedBaseGrid<T, GPTransformer, Adder, GPType>::moveTo(const AgentId& id, const std::vector<GPType>& newLocation) {
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+bool SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::moveTo(const AgentId& id, const Point<GPType>& newLocation) {
+	return SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::moveTo(id, newLocation.coords());
+}
+
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+bool SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::moveTo(const AgentId& id, const std::vector<GPType>& newLocation) {
 	return GridBaseType::moveTo(id, newLocation);
 }
 
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-void SharedBaseGrid<T, GPTransformer, Adder, GPType>::removeAgent(T* agent) {
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+void SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::removeAgent(T* agent) {
 	GridBaseType::removeAgent(agent);
 }
 
 
 // Beta
 
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-void SharedBaseGrid<T, GPTransformer, Adder, GPType>::getAgentsToPush(std::set<AgentId>& agentsToTest, std::map<int, std::set<AgentId> >& agentsToPush){
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+void SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::getAgentsToPush(std::set<AgentId>& agentsToTest, std::map<int, std::set<AgentId> >& agentsToPush){
 
   if(_buffer == 0) return; // A buffer zone of zero means that no agents will be pushed.
 
+  if(curve != 0){
+    getAgentsToPushAlongCurve(agentsToTest, agentsToPush);
+    return;
+  }
+
   int numDims = localBounds.dimensionCount();
   RelativeLocation relLocOrig(numDims);
 
@@ -456,7 +676,7 @@ void SharedBaseGrid<T, GPTransformer, Adder, GPType>::getAgentsToPush(std::set<A
       Point<GPType> loc(locationVector);
       if(!unbuffered.contains(loc)){
         for(int i = 0; i < numOutgoing; i++){
-          if((outgoing[i] > 0) && (outgoing[i]->contains(loc))){
+          if((outgoing[i] != 0) && (outgoing[i]->contains(loc))){
             agentsToPush[outRanks[i]].insert(id);
             found = true;
           }
@@ -473,12 +693,44 @@ void SharedBaseGrid<T, GPTransformer, Adder, GPType>::getAgentsToPush(std::set<A
     }
   }
 //  if(NW_set.size() > 0) agentsToPush[NW_rank].insert(NW_set.begin(), NW_set.end());
+  for(int i = 0; i < numOutgoing; i++) delete outgoing[i];
   delete[] outgoing;
   delete[] outRanks;
 }
 
-template<typename T, typename GPTransformer, typename Adder, typename GPType>
-void SharedBaseGrid<T, GPTransformer, Adder, GPType>::updateProjectionInfo(ProjectionInfoPacket* pip, Context<T>* context){
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+void SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::getAgentsToPushAlongCurve(std::set<AgentId>& agentsToTest, std::map<int, std::set<AgentId> >& agentsToPush){
+  int r = comm->rank();
+  std::set<AgentId>::iterator idIter = agentsToTest.begin();
+  while(idIter != agentsToTest.end()){
+    AgentId id = *idIter;
+    bool found = false;
+    if(id.currentRank() == r){ // Local agents only
+      std::vector<GPType> locationVector;
+      GridBaseType::getLocation(id, locationVector);
+      std::vector<double> pt(locationVector.begin(), locationVector.end());
+      std::set<int> ranks;
+      curve->getRanksNear(pt, _buffer, ranks);
+      for(std::set<int>::iterator rankIter = ranks.begin(); rankIter != ranks.end(); ++rankIter){
+        if(*rankIter != r){
+          agentsToPush[*rankIter].insert(id);
+          found = true;
+        }
+      }
+    }
+    if(found){
+      std::set<AgentId>::iterator tmp = idIter;
+      idIter++;
+      agentsToTest.erase(tmp);
+    }
+    else{
+      idIter++;
+    }
+  }
+}
+
+template<typename T, typename GPTransformer, typename Adder, typename GPType, typename CellAccessor>
+void SharedBaseGrid<T, GPTransformer, Adder, GPType, CellAccessor>::updateProjectionInfo(ProjectionInfoPacket* pip, Context<T>* context){
   SpecializedProjectionInfoPacket<GPType>* spip = static_cast<SpecializedProjectionInfoPacket<GPType>*>(pip);
   synchMoveTo(spip->id, spip->data);
 }
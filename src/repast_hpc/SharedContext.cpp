@@ -47,4 +47,8 @@ void rpRemoveAgent(const AgentId& id) {
 	RepastProcess::instance()->agentRemoved(id);
 }
 
+ThreadPool* rpThreadPool() {
+	return RepastProcess::instance()->getThreadPool();
+}
+
 }
@@ -43,9 +43,15 @@
 
 #include "Context.h"
 #include "RepastErrors.h"
+#include "ThreadPool.h"
 
 #include <boost/mpi.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <algorithm>
 #include <exception>
+#include <map>
+#include <vector>
 
 namespace repast {
 
@@ -78,6 +84,10 @@ struct AgentStateFilter{
 	bool operator()(const boost::shared_ptr<T>& ptr) {
 		return (local ? ptr->getId().currentRank() == rank : ptr->getId().currentRank() != rank);
 	}
+
+	bool operator()(const T* agent) {
+		return (local ? agent->getId().currentRank() == rank : agent->getId().currentRank() != rank);
+	}
 };
 //
 ///*
@@ -102,6 +112,107 @@ struct AgentStateFilter{
  */
 void rpRemoveAgent(const AgentId& id);
 
+/**
+ * Used to get the process's thread pool; 0 if there is none.
+ */
+ThreadPool* rpThreadPool();
+
+/**
+ * Applies a functor to a contiguous chunk of agents, giving it a Random
+ * stream of its own. Used by SharedContext::parallelForLocal.
+ */
+template<typename T, typename F>
+class LocalAgentChunk: public Functor {
+
+private:
+	F* functor;
+	T* const * first;
+	T* const * last;
+	boost::uint32_t seed;
+
+public:
+	LocalAgentChunk(F* func, T* const * firstAgent, T* const * lastAgent, boost::uint32_t streamSeed) :
+			functor(func), first(firstAgent), last(lastAgent), seed(streamSeed) {
+	}
+
+	void operator()() {
+		boost::scoped_ptr<Random> random(Random::createStream(seed));
+		for (T* const * agent = first; agent != last; ++agent)
+			(*functor)(*agent, *random);
+	}
+};
+
+/**
+ * Holds non-local agent objects that have been removed from a SharedContext,
+ * keyed by agent type, so that they can be reused for later non-local agents
+ * instead of being deleted and reallocated. Local agents are always deleted.
+ */
+template<typename T>
+class NonLocalAgentPool: public boost::noncopyable {
+
+private:
+	int rank;
+	std::map<int, std::vector<T*> > pool;
+
+public:
+	NonLocalAgentPool(int rankInCommunicator) :
+			rank(rankInCommunicator) {
+	}
+
+	~NonLocalAgentPool() {
+		clear();
+	}
+
+	/**
+	 * Takes ownership of an agent that is no longer in the context.
+	 */
+	void release(T* agent) {
+		if (agent->getId().currentRank() == rank) delete agent;
+		else pool[agent->getId().agentType()].push_back(agent);
+	}
+
+	/**
+	 * Gets a pooled agent of the specified type, or 0 if there is none.
+	 * Ownership passes to the caller.
+	 */
+	T* take(int agentType) {
+		typename std::map<int, std::vector<T*> >::iterator iter = pool.find(agentType);
+		if (iter == pool.end() || iter->second.empty()) return 0;
+		T* agent = iter->second.back();
+		iter->second.pop_back();
+		return agent;
+	}
+
+	/**
+	 * Deletes all the pooled agents.
+	 */
+	void clear() {
+		for (typename std::map<int, std::vector<T*> >::iterator iter = pool.begin(); iter != pool.end(); ++iter) {
+			for (size_t i = 0; i < iter->second.size(); i++)
+				delete iter->second[i];
+		}
+		pool.clear();
+	}
+};
+
+/**
+ * shared_ptr deleter that returns agents to a NonLocalAgentPool. The
+ * pool is shared, so it outlives the context if agents are released
+ * after the context itself is destroyed.
+ */
+template<typename T>
+struct NonLocalAgentRecycler {
+	boost::shared_ptr<NonLocalAgentPool<T> > pool;
+
+	NonLocalAgentRecycler(const boost::shared_ptr<NonLocalAgentPool<T> >& agentPool) :
+			pool(agentPool) {
+	}
+
+	void operator()(T* agent) const {
+		pool->release(agent);
+	}
+};
+
 
 /**
  * Context implementation specialized for the parallel distributed
@@ -126,6 +237,15 @@ private:
 	RefMap projRefMap;
 	int _rank;
 
+	// recycles non-local agents, if enabled
+	boost::shared_ptr<NonLocalAgentPool<T> > nonLocalAgentPool;
+
+	// number of parallelForLocal calls, used to seed their Random streams
+	boost::uint32_t parallelCalls;
+
+	template<typename F>
+	void parallelFor(const std::vector<T*>& agents, F& functor, size_t grain);
+
 public:
 
 	// Create single instances for these and reuse them
@@ -162,6 +282,104 @@ public:
 	 */
 	const_local_iterator localEnd() const;
 
+	/**
+	 * Applies the functor to every local agent in this context, using the
+	 * process's thread pool (see RepastProcess::useThreads) if there is one.
+	 * The local agents are split into chunks of grain agents, and each chunk
+	 * is run as a single task on one of the pool's threads, so that the work
+	 * of this process is shared among its threads. This returns only once the
+	 * functor has been applied to all of the agents. Without a thread pool,
+	 * the chunks are run one after the other on the calling thread.
+	 *
+	 * The functor is called as functor(T* agent, Random& random). Random::instance()
+	 * must not be used by the functor; each chunk instead gets its own Random,
+	 * seeded from the singleton's seed, this process's rank, the number of
+	 * previous parallelForLocal calls on this context and the chunk's position,
+	 * so a run is reproducible regardless of the number of threads as long as
+	 * the grain and the order of the agents in the context do not change. For results
+	 * that also do not depend on the number of processes, use a RandomStream for
+	 * each agent instead.
+	 *
+	 * The functor is called concurrently for different agents and so may only
+	 * modify the agent it is given (and state of its own that is protected
+	 * from concurrent access). While parallelForLocal is running, the following
+	 * are safe because they only read:
+	 *
+	 * - getting agents from this context (getAgent, contains)
+	 * - getting an agent's location in a grid or continuous space
+	 * (getLocation, getObjectAt, getObjectsAt), and the neighbors and edges
+	 * of an agent in a network (successors, predecessors, adjacent, findEdge)
+	 * - getting values from a ValueLayerND (getValueAt); note that the get methods
+	 * of the older ValueLayer classes may insert default values and so are not safe.
+	 *
+	 * Anything that modifies a context or projection is not safe: adding or
+	 * removing agents, moving agents in a grid or continuous space (moveTo,
+	 * moveByDisplacement, moveByVector), adding or removing network edges,
+	 * and setting value layer values. Nor is anything that uses MPI or the
+	 * schedule, such as moving agents between processes or synchronizing. Such
+	 * changes should be recorded by the functor and applied after parallelForLocal
+	 * returns.
+	 *
+	 * @param functor the functor to apply to each local agent
+	 * @param grain the number of agents in each chunk
+	 *
+	 * @tparam F the type of the functor
+	 */
+	template<typename F>
+	void parallelForLocal(F& functor, size_t grain = 256);
+
+	/**
+	 * Applies the functor to every local agent of the specified type
+	 * (per its AgentId) in this context, as parallelForLocal(functor, grain).
+	 *
+	 * @param type the type of agent to which the functor is applied
+	 * @param functor the functor to apply to each local agent of that type
+	 * @param grain the number of agents in each chunk
+	 *
+	 * @tparam F the type of the functor
+	 */
+	template<typename F>
+	void parallelForLocal(int type, F& functor, size_t grain = 256);
+
+	/**
+	 * Adds the agent to the context, as Context::addAgent. If non-local agents
+	 * are being recycled and the agent is non-local, the agent will be returned
+	 * to the pool rather than deleted once it has been removed.
+	 *
+	 * @param agent the agent to add
+	 *
+	 * @return the address of the agent in the context
+	 */
+	T* addAgent(T* agent);
+
+	using Context<T>::addAgent;
+
+	/**
+	 * Sets whether the objects of non-local agents are recycled. When enabled, a
+	 * non-local agent that is dropped from this context (for example when it is
+	 * no longer needed after a projection synchronization) is kept in a pool
+	 * instead of being deleted, and RepastProcess reuses pooled objects when it
+	 * receives new non-local agents of the same type, calling the Updater's
+	 * updateAgent to set their state instead of creating new agents.
+	 *
+	 * This requires that agents of the same agent type have the same
+	 * class, and that updateAgent restores the complete state of a
+	 * non-local agent from its Content. Disabling recycling deletes the
+	 * pooled objects.
+	 *
+	 * @param recycle true to recycle non-local agent objects
+	 */
+	void recycleNonLocalAgents(bool recycle);
+
+	/**
+	 * Gets a pooled non-local agent object of the specified id's type, with
+	 * its id set to the specified id, or 0 if recycling is not enabled or there
+	 * is no pooled object of that type. The agent is not added to the context.
+	 *
+	 * @param id the id of the non-local agent to be reused
+	 */
+	T* recycledAgent(const AgentId& id);
+
 	/**
 	 * Removes the specified agent from this context. If the
 	 * agent is non-local, this checks to make sure that it
@@ -779,7 +997,7 @@ public:
 };
 
 template<typename T>
-SharedContext<T>::SharedContext(boost::mpi::communicator* comm) : Context<T> (), _rank(comm->rank()), localPredicate(comm->rank()),
+SharedContext<T>::SharedContext(boost::mpi::communicator* comm) : Context<T> (), _rank(comm->rank()), parallelCalls(0), localPredicate(comm->rank()),
   LOCAL_FILTER(true, comm->rank()),
   NON_LOCAL_FILTER(false, comm->rank()){
 }
@@ -787,6 +1005,79 @@ SharedContext<T>::SharedContext(boost::mpi::communicator* comm) : Context<T> (),
 template<typename T>
 SharedContext<T>::~SharedContext() { }
 
+template<typename T>
+T* SharedContext<T>::addAgent(T* agent) {
+	if (nonLocalAgentPool.get() == 0 || agent->getId().currentRank() == _rank)
+		return Context<T>::addAgent(agent);
+
+	T* inContext = Context<T>::getAgent(agent->getId());
+	if (inContext != 0) return inContext;
+	Context<T>::insertAgent(boost::shared_ptr<T>(agent, NonLocalAgentRecycler<T>(nonLocalAgentPool)));
+	return agent;
+}
+
+template<typename T>
+void SharedContext<T>::recycleNonLocalAgents(bool recycle) {
+	if (recycle) {
+		if (nonLocalAgentPool.get() == 0) nonLocalAgentPool.reset(new NonLocalAgentPool<T>(_rank));
+	} else if (nonLocalAgentPool.get() != 0) {
+		nonLocalAgentPool->clear();
+		nonLocalAgentPool.reset();
+	}
+}
+
+template<typename T>
+template<typename F>
+void SharedContext<T>::parallelForLocal(F& functor, size_t grain) {
+	std::vector<T*> agents;
+	for (const_local_iterator iter = localBegin(); iter != localEnd(); ++iter)
+		agents.push_back(iter->get());
+	parallelFor(agents, functor, grain);
+}
+
+template<typename T>
+template<typename F>
+void SharedContext<T>::parallelForLocal(int type, F& functor, size_t grain) {
+	std::vector<T*> agents;
+	for (const_state_aware_bytype_iterator iter = byTypeBegin(LOCAL, type); iter != byTypeEnd(LOCAL, type); ++iter)
+		agents.push_back(iter->get());
+	parallelFor(agents, functor, grain);
+}
+
+template<typename T>
+template<typename F>
+void SharedContext<T>::parallelFor(const std::vector<T*>& agents, F& functor, size_t grain) {
+	if (grain == 0) grain = 1;
+	boost::uint32_t seed = Random::streamSeed(Random::streamSeed(Random::instance()->seed(), _rank), parallelCalls++);
+
+	std::vector<LocalAgentChunk<T, F> > chunks;
+	chunks.reserve((agents.size() + grain - 1) / grain);
+	for (size_t start = 0; start < agents.size(); start += grain) {
+		size_t end = std::min(start + grain, agents.size());
+		chunks.push_back(LocalAgentChunk<T, F>(&functor, &agents[0] + start, &agents[0] + end,
+				Random::streamSeed(seed, (boost::uint32_t) chunks.size())));
+	}
+
+	ThreadPool* pool = rpThreadPool();
+	if (pool != 0 && chunks.size() > 1) {
+		std::vector<Functor*> tasks;
+		for (size_t i = 0; i < chunks.size(); i++)
+			tasks.push_back(&chunks[i]);
+		pool->run(tasks);
+	} else {
+		for (size_t i = 0; i < chunks.size(); i++)
+			chunks[i]();
+	}
+}
+
+template<typename T>
+T* SharedContext<T>::recycledAgent(const AgentId& id) {
+	if (nonLocalAgentPool.get() == 0) return 0;
+	T* agent = nonLocalAgentPool->take(id.agentType());
+	if (agent != 0) agent->getId() = id;
+	return agent;
+}
+
 template<typename T>
 void SharedContext<T>::removeAgent(T* agent) {
 	removeAgent(agent->getId());
@@ -916,14 +1207,14 @@ void SharedContext<T>::selectAgents(filterLocalFlag localOrNonLocalOnly, std::ve
 
 template<typename T>
 void SharedContext<T>::selectAgents(filterLocalFlag localOrNonLocalOnly, int count, std::set<T*>& selectedAgents, bool remove, int popSize){
-	if(popSize <= -1) selectNElementsAtRandom(begin(localOrNonLocalOnly), end(localOrNonLocalOnly), count, selectedAgents, remove);
-	else              selectNElementsAtRandom(begin(localOrNonLocalOnly), popSize, count, selectedAgents, remove);
+	Context<T>::sampleAgents(Context<T>::indexedAgents(), localOrNonLocalOnly ? LOCAL_FILTER : NON_LOCAL_FILTER,
+			begin(localOrNonLocalOnly), end(localOrNonLocalOnly), popSize, count, selectedAgents, remove);
 }
 
 template<typename T>
 void SharedContext<T>::selectAgents(filterLocalFlag localOrNonLocalOnly, int count, std::vector<T*>& selectedAgents, bool remove, int popSize){
-	if(popSize <= -1) selectNElementsInRandomOrder(begin(localOrNonLocalOnly), end(localOrNonLocalOnly), count, selectedAgents, remove);
-	else              selectNElementsInRandomOrder(begin(localOrNonLocalOnly), popSize, count, selectedAgents, remove);
+	Context<T>::sampleAgents(Context<T>::indexedAgents(), localOrNonLocalOnly ? LOCAL_FILTER : NON_LOCAL_FILTER,
+			begin(localOrNonLocalOnly), end(localOrNonLocalOnly), popSize, count, selectedAgents, remove);
 }
 
 template<typename T>
@@ -940,14 +1231,14 @@ void SharedContext<T>::selectAgents(filterLocalFlag localOrNonLocalOnly, std::ve
 
 template<typename T>
 void SharedContext<T>::selectAgents(filterLocalFlag localOrNonLocalOnly, int count, std::set<T*>& selectedAgents, int type, bool remove, int popSize){
-	if(popSize <= -1) selectNElementsAtRandom(byTypeBegin(localOrNonLocalOnly, type), byTypeEnd(localOrNonLocalOnly, type), count, selectedAgents, remove);
-	else              selectNElementsAtRandom(byTypeBegin(localOrNonLocalOnly, type), popSize, count, selectedAgents, remove);
+	Context<T>::sampleAgents(Context<T>::agentsOfType(type), localOrNonLocalOnly ? LOCAL_FILTER : NON_LOCAL_FILTER, byTypeBegin(localOrNonLocalOnly, type),
+			byTypeEnd(localOrNonLocalOnly, type), popSize, count, selectedAgents, remove);
 }
 
 template<typename T>
 void SharedContext<T>::selectAgents(filterLocalFlag localOrNonLocalOnly, int count, std::vector<T*>& selectedAgents, int type, bool remove, int popSize){
-	if(popSize <= -1) selectNElementsInRandomOrder(byTypeBegin(localOrNonLocalOnly, type), byTypeEnd(localOrNonLocalOnly, type), count, selectedAgents, remove);
-	else              selectNElementsInRandomOrder(byTypeBegin(localOrNonLocalOnly, type), popSize, count, selectedAgents, remove);
+	Context<T>::sampleAgents(Context<T>::agentsOfType(type), localOrNonLocalOnly ? LOCAL_FILTER : NON_LOCAL_FILTER, byTypeBegin(localOrNonLocalOnly, type),
+			byTypeEnd(localOrNonLocalOnly, type), popSize, count, selectedAgents, remove);
 }
 
 template<typename T>
@@ -44,13 +44,16 @@
 #include <boost/mpi/communicator.hpp>
 
 #include "SharedBaseGrid.h"
+#include "CellListOccupancy.h"
 
 namespace repast {
 
 /**
  * Continuous space SharedBaseGrid implementation. This
  * primarily adds the buffer synchronization appropriate for this
- * type. Default templated typical SharedContinuousSpaces are defined in SharedGrids.
+ * type, and queries for the agents near a point, which are answered
+ * from a cell list (see CellListOccupancy) covering the local bounds and
+ * the buffer. Default templated typical SharedContinuousSpaces are defined in SharedGrids.
  *
  * @see SharedBaseGrid for more details.
  *
@@ -60,25 +63,79 @@ namespace repast {
  * @tparam Adder determines how objects are added to the grid from its associated context.
  */
 template<typename T, typename GPTransformer, typename Adder>
-class SharedContinuousSpace: public SharedBaseGrid<T, GPTransformer, Adder, double> {
+class SharedContinuousSpace: public SharedBaseGrid<T, GPTransformer, Adder, double, CellListOccupancy<T, double> > {
 
 protected:
 	virtual void synchMoveTo(const AgentId& id, const Point<double>& pt);
 
 private:
 
-	typedef SharedBaseGrid<T, GPTransformer, Adder, double> SharedBaseGridType;
+	typedef SharedBaseGrid<T, GPTransformer, Adder, double, CellListOccupancy<T, double> > SharedBaseGridType;
 
 public:
 	virtual ~SharedContinuousSpace();
 	SharedContinuousSpace(std::string name, GridDimensions gridDims, std::vector<int> processDims, int buffer, boost::mpi::communicator* communicator);
+	SharedContinuousSpace(std::string name, GridDimensions gridDims, SpaceFillingCurve* curve, int buffer, boost::mpi::communicator* communicator);
+
+	/**
+	 * Sets the size of the cells used to answer getAgentsWithin and
+	 * getNearestAgents. By default this is the buffer size (or 1 if the
+	 * buffer is 0); it works best when it is close to the typical
+	 * search radius.
+	 *
+	 * @param size the length of the side of a cell
+	 */
+	void setCellSize(double size);
+
+	/**
+	 * Gets the agents in this space, local or in the buffer, within the
+	 * specified distance of a point, in no particular order. Agents on other
+	 * processes beyond the buffer are not found, so the results are
+	 * complete only for searches that lie within the local bounds
+	 * widened by the buffer.
+	 *
+	 * @param center the point to search around
+	 * @param radius the maximum distance from center
+	 * @param [out] out the agents found are appended to this vector
+	 */
+	void getAgentsWithin(const Point<double>& center, double radius, std::vector<T*>& out) const {
+		SharedBaseGridType::GridBaseType::cells().getWithin(center, radius, out);
+	}
+
+	/**
+	 * Gets the specified number of agents in this space, local or in the
+	 * buffer, nearest to a point, ordered by their distance from it (and then
+	 * by AgentId). Fewer agents are returned if there are not that many. As
+	 * with getAgentsWithin, agents beyond the buffer are not considered.
+	 *
+	 * @param center the point to search around
+	 * @param count the number of agents to get
+	 * @param [out] out the agents found are appended to this vector
+	 */
+	void getNearestAgents(const Point<double>& center, size_t count, std::vector<T*>& out) const {
+		SharedBaseGridType::GridBaseType::cells().getNearest(center, count, out);
+	}
 
 };
 
 template<typename T, typename GPTransformer, typename Adder>
 SharedContinuousSpace<T, GPTransformer, Adder>::SharedContinuousSpace(std::string name, GridDimensions gridDims,
 		std::vector<int> processDims, int buffer, boost::mpi::communicator* communicator) :
-	SharedBaseGrid<T, GPTransformer, Adder, double> (name, gridDims, processDims, buffer, communicator) {
+	SharedBaseGridType(name, gridDims, processDims, buffer, communicator) {
+	setCellSize(buffer > 0 ? buffer : 1);
+}
+
+template<typename T, typename GPTransformer, typename Adder>
+SharedContinuousSpace<T, GPTransformer, Adder>::SharedContinuousSpace(std::string name, GridDimensions gridDims,
+		SpaceFillingCurve* curve, int buffer, boost::mpi::communicator* communicator) :
+	SharedBaseGridType(name, gridDims, curve, buffer, communicator) {
+	setCellSize(buffer > 0 ? buffer : 1);
+}
+
+template<typename T, typename GPTransformer, typename Adder>
+void SharedContinuousSpace<T, GPTransformer, Adder>::setCellSize(double size) {
+	SharedBaseGridType::GridBaseType::cells().setTopology(SharedBaseGridType::globalBounds,
+			SharedBaseGridType::GridBaseType::isPeriodic(), size);
 }
 
 template<typename T, typename GPTransformer, typename Adder>
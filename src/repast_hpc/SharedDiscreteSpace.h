@@ -44,6 +44,7 @@
 #include <boost/mpi/communicator.hpp>
 
 #include "SharedBaseGrid.h"
+#include "DenseOccupancy.h"
 
 namespace repast {
 
@@ -60,18 +61,19 @@ namespace repast {
  * @tparam Adder determines how objects are added to the grid from its associated context.
  */
 template<typename T, typename GPTransformer, typename Adder>
-class SharedDiscreteSpace: public SharedBaseGrid<T, GPTransformer, Adder, int> {
+class SharedDiscreteSpace: public SharedBaseGrid<T, GPTransformer, Adder, int, DenseOccupancy<T, int> > {
 
 protected:
 	virtual void synchMoveTo(const AgentId& id, const Point<int>& pt);
 
 private:
 
-	typedef SharedBaseGrid<T, GPTransformer, Adder, int> SharedBaseGridType;
+	typedef SharedBaseGrid<T, GPTransformer, Adder, int, DenseOccupancy<T, int> > SharedBaseGridType;
 
 public:
 	virtual ~SharedDiscreteSpace();
 	SharedDiscreteSpace(std::string name, GridDimensions gridDims, std::vector<int> processDims, int buffer, boost::mpi::communicator* communicator);
+	SharedDiscreteSpace(std::string name, GridDimensions gridDims, SpaceFillingCurve* curve, int buffer, boost::mpi::communicator* communicator);
 
 //  virtual void getAgentsToPush(std::set<AgentId>& agentsToTest, std::map<int, std::set<AgentId> >& agentsToPush);
 
@@ -80,7 +82,13 @@ public:
 template<typename T, typename GPTransformer, typename Adder>
 SharedDiscreteSpace<T, GPTransformer, Adder>::SharedDiscreteSpace(std::string name, GridDimensions gridDims,
 		std::vector<int> processDims, int buffer, boost::mpi::communicator* communicator) :
-	SharedBaseGrid<T, GPTransformer, Adder, int> (name, gridDims, processDims, buffer, communicator) {
+	SharedBaseGridType(name, gridDims, processDims, buffer, communicator) {
+}
+
+template<typename T, typename GPTransformer, typename Adder>
+SharedDiscreteSpace<T, GPTransformer, Adder>::SharedDiscreteSpace(std::string name, GridDimensions gridDims,
+		SpaceFillingCurve* curve, int buffer, boost::mpi::communicator* communicator) :
+	SharedBaseGridType(name, gridDims, curve, buffer, communicator) {
 }
 
 template<typename T, typename GPTransformer, typename Adder>
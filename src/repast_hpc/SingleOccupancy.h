@@ -45,6 +45,7 @@
 #include <boost/shared_ptr.hpp>
 
 #include "Point.h"
+#include "GridDimensions.h"
 
 namespace repast {
 
@@ -68,6 +69,13 @@ private:
 
 public:
 
+	/**
+	 * Sets the bounds of the grid this accessor is used by. SingleOccupancy
+	 * does not depend on the bounds, so this does nothing.
+	 */
+	void init(const GridDimensions& bounds) {
+	}
+
 	/**
 	 * Gets the object found at the specified location.
 	 *
@@ -0,0 +1,280 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  SpaceFillingCurve.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jtm
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "SpaceFillingCurve.h"
+#include "RepastErrors.h"
+
+using namespace std;
+
+namespace repast {
+
+SpaceFillingCurve::SpaceFillingCurve(GridDimensions globalBoundaries, int curveOrder, CurveType type, bool spaceIsPeriodic,
+    boost::mpi::communicator* communicator) : globalBounds(globalBoundaries), order(curveOrder), curveType(type),
+    periodic(spaceIsPeriodic), comm(*communicator) {
+  numDims = globalBounds.dimensionCount();
+  if(order < 0 || order * numDims > 24) throw Repast_Error_58(order, numDims); // Too many blocks
+
+  blocksPerDim = 1 << order;
+  worldSize = communicator->size();
+  for(int i = 0; i < numDims; i++) blockSize.push_back(globalBounds.extents(i) / blocksPerDim);
+
+  int numBlocks = 1;
+  for(int i = 0; i < numDims; i++) numBlocks *= blocksPerDim;
+
+  // Order the blocks along the curve
+  vector<pair<unsigned long long, int> > keys;
+  keys.reserve(numBlocks);
+  vector<unsigned int> coords(numDims, 0);
+  for(int b = 0; b < numBlocks; b++){
+    int remainder = b;
+    for(int i = 0; i < numDims; i++){
+      coords[i] = remainder % blocksPerDim;
+      remainder /= blocksPerDim;
+    }
+    keys.push_back(make_pair(curveKey(coords), b));
+  }
+  sort(keys.begin(), keys.end());
+  for(int b = 0; b < numBlocks; b++) blocksAlongCurve.push_back(keys[b].second);
+
+  owners.assign(numBlocks, 0);
+  assignRanges(vector<double>(numBlocks, 1.0));
+}
+
+SpaceFillingCurve::~SpaceFillingCurve(){}
+
+unsigned long long SpaceFillingCurve::curveKey(vector<unsigned int> coords){
+  if(order == 0) return 0;
+  if(curveType == HILBERT){
+    // Skilling's transform of the axes to the 'transposed' Hilbert index (AIP Conf. Proc. 707, 2004)
+    unsigned int M = 1u << (order - 1);
+    for(unsigned int Q = M; Q > 1; Q >>= 1){
+      unsigned int P = Q - 1;
+      for(int i = 0; i < numDims; i++){
+        if(coords[i] & Q) coords[0] ^= P;
+        else{
+          unsigned int t = (coords[0] ^ coords[i]) & P;
+          coords[0] ^= t;
+          coords[i] ^= t;
+        }
+      }
+    }
+    for(int i = 1; i < numDims; i++) coords[i] ^= coords[i - 1];
+    unsigned int t = 0;
+    for(unsigned int Q = M; Q > 1; Q >>= 1) if(coords[numDims - 1] & Q) t ^= Q - 1;
+    for(int i = 0; i < numDims; i++) coords[i] ^= t;
+  }
+  // Interleave the bits, most significant first; for MORTON this is the Z-order index
+  unsigned long long key = 0;
+  for(int j = order - 1; j >= 0; j--){
+    for(int i = 0; i < numDims; i++) key = (key << 1) | ((coords[i] >> j) & 1u);
+  }
+  return key;
+}
+
+void SpaceFillingCurve::assignRanges(const vector<double>& blockLoads){
+  int numBlocks = blocksAlongCurve.size();
+  double total = 0;
+  for(int b = 0; b < numBlocks; b++) total += blockLoads[b];
+  bool uniform = (total <= 0);
+  if(uniform) total = numBlocks;
+
+  // starts[r] is the first position along the curve owned by rank r
+  vector<int> starts(worldSize + 1, numBlocks);
+  starts[0] = 0;
+  int r = 1;
+  double cumulative = 0;
+  for(int p = 0; p < numBlocks; p++){
+    double load = (uniform ? 1.0 : blockLoads[blocksAlongCurve[p]]);
+    int desired = (int)((cumulative + load / 2) * worldSize / total);
+    while(r <= desired && r < worldSize){
+      starts[r] = p;
+      r++;
+    }
+    cumulative += load;
+  }
+
+  // Give every rank at least one block, if there are enough
+  if(numBlocks >= worldSize){
+    for(int i = 1; i < worldSize; i++)  if(starts[i] < starts[i - 1] + 1) starts[i] = starts[i - 1] + 1;
+    for(int i = worldSize - 1; i > 0; i--) if(starts[i] > numBlocks - (worldSize - i)) starts[i] = numBlocks - (worldSize - i);
+  }
+
+  for(int i = 0; i < worldSize; i++){
+    for(int p = starts[i]; p < starts[i + 1]; p++) owners[blocksAlongCurve[p]] = i;
+  }
+}
+
+bool SpaceFillingCurve::partition(const vector<double>& blockLoads, double threshold){
+  int numBlocks = owners.size();
+  vector<double> totals(numBlocks, 0);
+  vector<double> loads(blockLoads);
+  loads.resize(numBlocks, 0);
+  MPI_Allreduce(&loads[0], &totals[0], numBlocks, MPI_DOUBLE, MPI_SUM, comm);
+
+  if(threshold > 0){
+    vector<double> rankLoads(worldSize, 0);
+    double total = 0;
+    for(int b = 0; b < numBlocks; b++){
+      rankLoads[owners[b]] += totals[b];
+      total += totals[b];
+    }
+    if(total <= 0) return false;
+    double maxLoad = *max_element(rankLoads.begin(), rankLoads.end());
+    if(maxLoad / (total / worldSize) <= threshold) return false;
+  }
+
+  vector<int> previous(owners);
+  assignRanges(totals);
+  return owners != previous;
+}
+
+int SpaceFillingCurve::blockCoordinate(double position, int dimension){
+  return (int)floor((position - globalBounds.origin(dimension)) / blockSize[dimension]);
+}
+
+int SpaceFillingCurve::blockOf(const vector<double>& pt){
+  int block = 0;
+  int multiplier = 1;
+  for(int i = 0; i < numDims; i++){
+    int c = blockCoordinate(pt[i], i);
+    if(c < 0) c = 0;
+    if(c >= blocksPerDim) c = blocksPerDim - 1;
+    block += c * multiplier;
+    multiplier *= blocksPerDim;
+  }
+  return block;
+}
+
+GridDimensions SpaceFillingCurve::getBlockBounds(int block){
+  vector<double> origin, extents;
+  for(int i = 0; i < numDims; i++){
+    origin.push_back(globalBounds.origin(i) + (block % blocksPerDim) * blockSize[i]);
+    extents.push_back(blockSize[i]);
+    block /= blocksPerDim;
+  }
+  return GridDimensions(Point<double>(origin), Point<double>(extents));
+}
+
+GridDimensions SpaceFillingCurve::getBounds(int rank){
+  vector<int> lower(numDims, blocksPerDim);
+  vector<int> upper(numDims, -1);
+  for(size_t b = 0; b < owners.size(); b++){
+    if(owners[b] != rank) continue;
+    int remainder = b;
+    for(int i = 0; i < numDims; i++){
+      int c = remainder % blocksPerDim;
+      remainder /= blocksPerDim;
+      if(c < lower[i]) lower[i] = c;
+      if(c > upper[i]) upper[i] = c;
+    }
+  }
+  vector<double> origin, extents;
+  for(int i = 0; i < numDims; i++){
+    if(upper[i] < 0){
+      origin.push_back(globalBounds.origin(i));
+      extents.push_back(0);
+    }
+    else{
+      origin.push_back(globalBounds.origin(i) + lower[i] * blockSize[i]);
+      extents.push_back((upper[i] - lower[i] + 1) * blockSize[i]);
+    }
+  }
+  return GridDimensions(Point<double>(origin), Point<double>(extents));
+}
+
+int SpaceFillingCurve::ownedBlockCount(int rank){
+  return (int)std::count(owners.begin(), owners.end(), rank);
+}
+
+void SpaceFillingCurve::collectOwners(const vector<int>& lower, const vector<int>& upper, set<int>& ranks){
+  vector<int> low(lower), high(upper);
+  for(int i = 0; i < numDims; i++){
+    if(!periodic || high[i] - low[i] + 1 >= blocksPerDim){
+      if(low[i] < 0) low[i] = 0;
+      if(high[i] >= blocksPerDim) high[i] = blocksPerDim - 1;
+    }
+  }
+  vector<int> current(low);
+  while(true){
+    int block = 0;
+    int multiplier = 1;
+    for(int i = 0; i < numDims; i++){
+      int c = ((current[i] % blocksPerDim) + blocksPerDim) % blocksPerDim; // Wraps when periodic
+      block += c * multiplier;
+      multiplier *= blocksPerDim;
+    }
+    ranks.insert(owners[block]);
+    int i = 0;
+    while(i < numDims && ++current[i] > high[i]){
+      current[i] = low[i];
+      i++;
+    }
+    if(i == numDims) return;
+  }
+}
+
+void SpaceFillingCurve::getRanksNear(const vector<double>& pt, double distance, set<int>& ranks){
+  vector<int> lower, upper;
+  for(int i = 0; i < numDims; i++){
+    lower.push_back(blockCoordinate(pt[i] - distance, i));
+    upper.push_back(blockCoordinate(pt[i] + distance, i));
+  }
+  collectOwners(lower, upper, ranks);
+}
+
+void SpaceFillingCurve::getNeighborRanks(int rank, double distance, set<int>& ranks){
+  set<int> found;
+  vector<int> lower(numDims), upper(numDims);
+  for(size_t b = 0; b < owners.size(); b++){
+    if(owners[b] != rank) continue;
+    GridDimensions bounds = getBlockBounds(b);
+    for(int i = 0; i < numDims; i++){
+      lower[i] = blockCoordinate(bounds.origin(i) - distance, i);
+      upper[i] = blockCoordinate(bounds.origin(i) + bounds.extents(i) + distance, i);
+    }
+    collectOwners(lower, upper, found);
+  }
+  found.erase(rank);
+  ranks.insert(found.begin(), found.end());
+}
+
+}
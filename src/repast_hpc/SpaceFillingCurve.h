@@ -0,0 +1,202 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *  SpaceFillingCurve.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jtm
+ */
+
+#ifndef SPACEFILLINGCURVE_H_
+#define SPACEFILLINGCURVE_H_
+
+#include <set>
+#include <vector>
+#include "mpi.h"
+#include <boost/mpi.hpp>
+
+#include "GridDimensions.h"
+
+namespace repast {
+
+/**
+ * Decomposes a space among processes along a space-filling curve,
+ * as an alternative to the regular process grid of CartesianTopology.
+ *
+ * The global space is divided into 2^order blocks along each dimension;
+ * the blocks are ordered along a Hilbert or Morton (Z-order) curve, and each
+ * process owns a contiguous range of the curve. Because the ranges can be
+ * placed anywhere along the curve, any number of processes can be used and
+ * the ranges can be weighted by load (see partition). Blocks that are
+ * close together on the curve are close together in space, so the region
+ * owned by each process stays compact.
+ *
+ * The region owned by a process is generally not a rectangle; use rankOf
+ * to find the owner of a point and getRanksNear to find the processes
+ * whose regions lie within a buffer distance of a point.
+ */
+class SpaceFillingCurve {
+
+public:
+  enum CurveType { HILBERT, MORTON };
+
+private:
+  GridDimensions     globalBounds;
+  int                order;
+  CurveType          curveType;
+  bool               periodic;
+  int                numDims;
+  int                blocksPerDim;
+  int                worldSize;
+  std::vector<double> blockSize;
+  std::vector<int>   blocksAlongCurve;    // Block index at each position along the curve
+  std::vector<int>   owners;              // Owning rank of each block (by block index)
+  MPI_Comm           comm;
+
+  /**
+   * Gets the position along the curve of the block with the given
+   * per-dimension block coordinates
+   */
+  unsigned long long curveKey(std::vector<unsigned int> coords);
+
+  /**
+   * Assigns contiguous ranges of the curve to processes so that each
+   * process receives an equal share of the given per-block loads
+   */
+  void assignRanges(const std::vector<double>& blockLoads);
+
+  /**
+   * Gets the block coordinate along one dimension for a position,
+   * without wrapping or clamping
+   */
+  int blockCoordinate(double position, int dimension);
+
+  /**
+   * Adds the owners of all blocks whose coordinates lie between
+   * lower and upper (inclusive) to the set of ranks, wrapping or
+   * clamping the coordinates as appropriate
+   */
+  void collectOwners(const std::vector<int>& lower, const std::vector<int>& upper, std::set<int>& ranks);
+
+public:
+
+  /**
+   * Creates a SpaceFillingCurve over the specified space. Initially each
+   * process owns an equal number of blocks.
+   *
+   * @param globalBoundaries the global boundaries of the space
+   * @param curveOrder the number of times the space is halved along each
+   * dimension; there are 2^(curveOrder x dimensions) blocks
+   * @param type HILBERT or MORTON
+   * @param spaceIsPeriodic true if the space wraps around
+   * @param communicator the communicator whose processes share the space
+   */
+  SpaceFillingCurve(GridDimensions globalBoundaries, int curveOrder, CurveType type, bool spaceIsPeriodic, boost::mpi::communicator* communicator);
+  virtual ~SpaceFillingCurve();
+
+  /**
+   * Gets the index of the block that contains the specified point
+   */
+  int blockOf(const std::vector<double>& pt);
+
+  /**
+   * Gets the rank of the process that owns the specified point
+   */
+  int rankOf(const std::vector<double>& pt){
+    return owners[blockOf(pt)];
+  }
+
+  /**
+   * Returns true if the specified rank owns the specified point
+   */
+  bool owns(int rank, const std::vector<double>& pt){
+    return rankOf(pt) == rank;
+  }
+
+  /**
+   * Gets the boundaries of the specified block
+   */
+  GridDimensions getBlockBounds(int block);
+
+  /**
+   * Gets the smallest box that contains all of the blocks owned by the
+   * specified rank. If the rank owns no blocks, the extents are zero.
+   */
+  GridDimensions getBounds(int rank);
+
+  /**
+   * Gets the number of blocks owned by the specified rank
+   */
+  int ownedBlockCount(int rank);
+
+  /**
+   * Gets the ranks of the processes (including the specified one)
+   * that own any part of the space within the given distance of the
+   * specified point along each dimension.
+   */
+  void getRanksNear(const std::vector<double>& pt, double distance, std::set<int>& ranks);
+
+  /**
+   * Gets the ranks of the processes, other than the specified one, that own
+   * any part of the space within the given distance of the region owned by
+   * the specified rank.
+   */
+  void getNeighborRanks(int rank, double distance, std::set<int>& ranks);
+
+  /**
+   * Gets the total number of blocks
+   */
+  int blockCount(){
+    return owners.size();
+  }
+
+  /**
+   * Reassigns the curve ranges so that each process receives an equal
+   * share of the load. Each process passes the load it has measured in
+   * each block (for example, the number of its local agents in each block);
+   * the loads are summed across processes. This is a collective call.
+   *
+   * @param blockLoads the load measured by this process in each block
+   * (indexed by block)
+   * @param threshold if greater than zero, the ranges are only reassigned when
+   * the ratio of the maximum to the mean load per process exceeds this value
+   *
+   * @return true if the owner of any block changed
+   */
+  bool partition(const std::vector<double>& blockLoads, double threshold = 0);
+
+};
+
+}
+
+#endif /* SPACEFILLINGCURVE_H_ */
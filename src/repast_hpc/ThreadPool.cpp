@@ -0,0 +1,176 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  ThreadPool.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jtm
+ */
+
+#include "ThreadPool.h"
+
+namespace repast {
+
+namespace {
+thread_local unsigned int currentThreadIndex = 0;
+thread_local bool runningTask = false; // True while this thread executes a pool task
+}
+
+ThreadPool::ThreadPool(unsigned int numThreads) :
+	generation(0), shuttingDown(false), pending(0) {
+	if (numThreads == 0) numThreads = std::thread::hardware_concurrency();
+	if (numThreads == 0) numThreads = 1;
+	for (unsigned int i = 0; i < numThreads; i++)
+		queues.push_back(new WorkQueue());
+	for (unsigned int i = 1; i < numThreads; i++)
+		workers.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		shuttingDown = true;
+	}
+	startSignal.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	for (size_t i = 0; i < queues.size(); i++)
+		delete queues[i];
+}
+
+unsigned int ThreadPool::threadIndex() {
+	return currentThreadIndex;
+}
+
+bool ThreadPool::runOne(unsigned int index) {
+	Functor* task = 0;
+	// Own queue first, from the back ...
+	{
+		WorkQueue* own = queues[index];
+		std::lock_guard<std::mutex> guard(own->lock);
+		if (!own->tasks.empty()) {
+			task = own->tasks.back();
+			own->tasks.pop_back();
+		}
+	}
+	// ... then steal from the front of the others
+	for (size_t i = 1, n = queues.size(); task == 0 && i < n; i++) {
+		WorkQueue* other = queues[(index + i) % n];
+		std::lock_guard<std::mutex> guard(other->lock);
+		if (!other->tasks.empty()) {
+			task = other->tasks.front();
+			other->tasks.pop_front();
+		}
+	}
+	if (task == 0) return false;
+
+	runningTask = true;
+	try {
+		(*task)();
+	} catch (...) {
+		std::lock_guard<std::mutex> guard(lock);
+		if (!error) error = std::current_exception();
+	}
+	runningTask = false;
+	if (--pending == 0) {
+		std::lock_guard<std::mutex> guard(lock);
+		doneSignal.notify_all();
+	}
+	return true;
+}
+
+void ThreadPool::work(unsigned int index) {
+	currentThreadIndex = index;
+	unsigned long seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			while (!shuttingDown && generation == seen)
+				startSignal.wait(guard);
+			if (shuttingDown) return;
+			seen = generation;
+		}
+		while (runOne(index)) {
+		}
+	}
+}
+
+void ThreadPool::run(const std::vector<Functor*>& tasks) {
+	if (tasks.empty()) return;
+	// Nested calls (from a task already running on a pool) execute inline
+	if (queues.size() == 1 || runningTask) {
+		for (size_t i = 0; i < tasks.size(); i++)
+			(*tasks[i])();
+		return;
+	}
+
+	// The counters are set before any task is visible: a worker still
+	// draining the previous batch may pick up (and count down) a new task
+	// as soon as it is queued
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending = tasks.size();
+		error = std::exception_ptr();
+	}
+
+	// Deal contiguous blocks of tasks to the threads
+	size_t n = queues.size();
+	for (size_t q = 0; q < n; q++) {
+		size_t begin = tasks.size() * q / n;
+		size_t end = tasks.size() * (q + 1) / n;
+		std::lock_guard<std::mutex> guard(queues[q]->lock);
+		queues[q]->tasks.insert(queues[q]->tasks.end(), tasks.begin() + begin, tasks.begin() + end);
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		generation++;
+	}
+	startSignal.notify_all();
+
+	while (runOne(0)) {
+	}
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		while (pending != 0)
+			doneSignal.wait(guard);
+	}
+
+	if (error) {
+		std::exception_ptr thrown = error;
+		error = std::exception_ptr();
+		std::rethrow_exception(thrown);
+	}
+}
+
+}
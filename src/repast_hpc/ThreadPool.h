@@ -0,0 +1,132 @@
+/*
+ *   Repast for High Performance Computing (Repast HPC)
+ *
+ *   Copyright (c) 2010 Argonne National Laboratory
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with
+ *   or without modification, are permitted provided that the following
+ *   conditions are met:
+ *
+ *     Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ *     Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ *     Neither the name of the Argonne National Laboratory nor the names of its
+ *     contributors may be used to endorse or promote products derived from
+ *     this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ *   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE TRUSTEES OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ *   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ *   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *   EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ *  ThreadPool.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: jtm
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+#include <boost/noncopyable.hpp>
+
+#include "Schedule.h"
+
+namespace repast {
+
+/**
+ * A fixed set of worker threads that execute batches of Functors.
+ * The Functors in a batch are dealt out to per-thread queues; each thread
+ * works through its own queue and then steals from the others, so uneven
+ * tasks are balanced without a shared queue. The calling thread takes part
+ * in the work, and run() returns only when every Functor in the batch has
+ * completed.
+ *
+ * Functors run by the pool must not use MPI or modify the simulation
+ * schedule. A Functor may itself call run() (for example, a parallel-safe
+ * scheduled event that calls SharedContext::parallelForLocal); such a nested
+ * batch is executed inline, in order, on the calling thread. run() must not
+ * be called concurrently from two threads that are not running pool tasks.
+ */
+class ThreadPool: public boost::noncopyable {
+
+private:
+	struct WorkQueue {
+		std::mutex lock;
+		std::deque<Functor*> tasks;
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<WorkQueue*> queues;
+
+	std::mutex lock;
+	std::condition_variable startSignal;
+	std::condition_variable doneSignal;
+	unsigned long generation;
+	bool shuttingDown;
+	std::atomic<size_t> pending;
+	std::exception_ptr error;
+
+	void work(unsigned int index);
+	bool runOne(unsigned int index);
+
+public:
+	/**
+	 * Creates a ThreadPool.
+	 *
+	 * @param numThreads the total number of threads, including the thread
+	 * that calls run(); if 0, the hardware concurrency is used
+	 */
+	ThreadPool(unsigned int numThreads = 0);
+	~ThreadPool();
+
+	/**
+	 * Gets the total number of threads, including the calling thread.
+	 */
+	unsigned int size() const {
+		return (unsigned int) queues.size();
+	}
+
+	/**
+	 * Executes all the Functors in tasks and waits for them to complete.
+	 * If any Functor throws, the first exception is rethrown here once
+	 * the rest of the batch has finished. If called from a Functor that the
+	 * pool is running, the tasks are executed inline on the calling thread
+	 * and the first exception propagates immediately.
+	 *
+	 * @param tasks the Functors to execute; they are not deleted
+	 */
+	void run(const std::vector<Functor*>& tasks);
+
+	/**
+	 * Gets the index of the pool thread that is executing the caller,
+	 * from 0 (the thread that called run()) to size() - 1. Outside of
+	 * a pool this is 0.
+	 */
+	static unsigned int threadIndex();
+};
+
+}
+
+#endif /* THREADPOOL_H_ */
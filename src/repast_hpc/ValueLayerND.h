@@ -42,18 +42,27 @@
 #define VALUELAYERND_H_
 
 #include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
 
 #include "mpi.h"
 
 #include "Point.h"
 #include "GridDimensions.h"
 #include "RepastProcess.h"
+#include "RepastErrors.h"
 
 
 using namespace std;
 
 namespace repast {
 
+// Identifies a value layer snapshot file (see ValueLayerND::writeSnapshot); the
+// trailing digits are the format version
+static const char SNAPSHOT_MAGIC[]      = "RHPCVL01";
+static const int  SNAPSHOT_MAGIC_LENGTH = 8;
+
 /**
  * The RankDatum struct stores the data that the ValueLayerND
  * class will need for each of its 3^N - 1 neighboring ranks.
@@ -249,6 +258,9 @@ bool DimensionDatum<T>::isInLocalBounds(int originalCoord){
  * An AbstractValueLayerND is the abstract parent class for N-dimensional value
  * layers
  */
+template<typename T, typename R>
+class ValueLayerSlab;
+
 template<typename T>
 class AbstractValueLayerND{
 
@@ -257,7 +269,9 @@ private:
 
 protected:
   CartesianTopology*         cartTopology;
+  GridDimensions             globalBoundaries;
   GridDimensions             localBoundaries;
+  int                        bufferSize;             // Size of the buffer zone
   int                        length;                 // Total length of the entire array (one data space)
 
   int                        numDims;                // Number of dimensions
@@ -272,6 +286,7 @@ protected:
 
   int                        instanceID;             // Unique ID for managing MPI requests without mix-ups
   int                        syncCount;
+  T                          bufferZoneFillValue;    // Value last placed in the buffer zones by fill; kept at non-periodic edges
 
   /**
    * Constructor
@@ -315,6 +330,21 @@ public:
     return localBoundaries;
   }
 
+  /**
+   * Moves this value layer's data to match the current boundaries of
+   * its process topology, after those have been moved by
+   * CartesianTopology::rebalance (for example, via SharedBaseGrid::rebalance
+   * on a grid that shares the topology). Values in the local cells are
+   * sent to the processes that now own them and the buffer zones are
+   * synchronized; buffer zones at non-periodic global edges keep the
+   * value they were initialized with. This is a collective call; if no
+   * boundaries have moved it does nothing. The boundaries must lie on
+   * whole units (see CartesianTopology::rebalance).
+   *
+   * @return true if the boundaries had moved and the data was redistributed
+   */
+  virtual bool repartition() = 0;
+
 protected:
   // Methods implemented in this class but visible only to child classes:
 
@@ -359,6 +389,121 @@ protected:
    */
   int getIndex(Point<int> location);
 
+  /**
+   * Redistributes the local cells of each of the given data banks to
+   * match the current boundaries of the process topology. The banks
+   * are reallocated (so the pointers passed will be changed) and the
+   * geometry of this layer is rebuilt. Buffer zones get the value that
+   * fill last placed in them, which the buffer zones shared with
+   * neighbors lose on the next synchronization but the buffer zones at
+   * non-periodic global edges keep.
+   *
+   * @param banks the data spaces to be redistributed
+   * @return true if the boundaries had moved
+   */
+  bool redistribute(vector<T*>& banks);
+
+  /**
+   * Posts the non-blocking sends and receives that exchange the
+   * buffer zones of the given data space with the adjacent
+   * processes, using the datatypes in neighborData. The local
+   * cells being sent must not be modified and the buffer zones
+   * must not be read until finishSynchronization is called;
+   * everything else may be used in between.
+   *
+   * @param dataSpace the data space whose buffer zones are exchanged
+   */
+  void startSynchronization(T* dataSpace);
+
+  /**
+   * Waits for the exchange posted by startSynchronization
+   * to complete.
+   */
+  void finishSynchronization();
+
+  /**
+   * Applies a row operation to every row (a run of cells along
+   * dimension 0, which is contiguous) of the box [lower, upper),
+   * given in cells from the local origin; negative values and values
+   * past the local width reach into the buffer zones. The box is cut
+   * into slabs along its outermost dimension, so that each slab is a
+   * contiguous block of memory, and if the process has a ThreadPool
+   * (see RepastProcess::useThreads) and the box is large enough the
+   * slabs are run on it. If tileRows is non-zero and the layer has
+   * three or more dimensions, each slab is further swept in tiles of
+   * that many rows of dimension 1, so that rows read by neighboring
+   * planes are still in cache when they are read again.
+   *
+   * rowOps must hold one operation on entry; it is copied for each slab,
+   * and on return holds the slabs' copies, in order. A row operation is
+   * called as op(index, position, rowLength), where index is the
+   * offset of the row's first cell in the data space and position its
+   * coordinates (in cells from the local origin).
+   *
+   * @param lower the lowest corner of the box
+   * @param upper the (exclusive) highest corner of the box
+   * @param rowOps the row operation, and on return the slabs' copies of it
+   * @param tileRows the height of cache tiles along dimension 1, or 0
+   */
+  template<typename R>
+  void parallelSweep(const vector<int>& lower, const vector<int>& upper, vector<R>& rowOps, int tileRows = 0) const;
+
+  /**
+   * Applies a row operation to every row of the box [lower, upper),
+   * in order, on the calling thread
+   */
+  template<typename R>
+  void forEachRow(const vector<int>& lower, const vector<int>& upper, R& rowOp) const;
+
+  /**
+   * Fills the given data spaces: local cells get one value and
+   * buffer zone cells another. Used for initialization and clearing.
+   *
+   * @param banks the data spaces to fill
+   * @param localValue the value to be placed in local cells
+   * @param bufferZoneValue the value to be placed in non-local cells
+   * @param doBufferZone if true, places values in the buffer zone
+   * @param doLocal if true, places values in the local cells
+   */
+  void fill(const vector<T*>& banks, T localValue, T bufferZoneValue, bool doBufferZone, bool doLocal);
+
+  /**
+   * Writes the non-zero cells of the given data space to a csv file,
+   * one line per cell, in the order of the data space. Lines are
+   * formatted by slab (on the ThreadPool, if there is one) and then
+   * written in order.
+   *
+   * @param outfile output file
+   * @param dataSpace the data space to be written
+   * @param writeSharedBoundaryAreas if true, write the areas that are non-local to this process
+   */
+  void writeValues(std::ostream& outfile, const T* dataSpace, bool writeSharedBoundaryAreas);
+
+  /**
+   * Writes the local cells of the given data space into a single binary
+   * snapshot file shared by all processes in this layer's topology,
+   * using collective MPI-IO. The file holds a header (see
+   * writeSnapshot) followed by the values of the whole global space,
+   * with dimension 0 varying fastest; each process writes its block
+   * through a subarray file view. This is a collective call.
+   *
+   * @param fileName name of the snapshot file; an existing file is replaced
+   * @param dataSpace the data space to be written
+   */
+  void writeSnapshotData(const string& fileName, const T* dataSpace);
+
+  /**
+   * Reads the local cells of the given data space from a snapshot file
+   * written by writeSnapshotData. The writing layer must have had the
+   * same global boundaries and element type, but may have been
+   * decomposed differently. Buffer zones are not set. This is a
+   * collective call.
+   *
+   * @param fileName name of the snapshot file
+   * @param dataSpace the data space to be filled
+   */
+  void readSnapshotData(const string& fileName, T* dataSpace);
+
 
   // Virtual methods (implemented by child classes
 
@@ -476,6 +621,10 @@ protected:
 
 private:
 
+  template<typename, typename> friend class ValueLayerSlab;
+
+  enum { MIN_SLAB_CELLS = 4096 }; // Slabs smaller than this are not worth a thread
+
   /**
    * Gets an MPI data type given the RelativeLocation
    * and an index indicating which entry in the RelativeLocation
@@ -550,16 +699,156 @@ private:
    */
   int getReceivePointerOffset(RelativeLocation relLoc);
 
+  /**
+   * Creates the per-dimension and per-neighbor data for the
+   * current local boundaries
+   */
+  void createGeometry();
+
+  /**
+   * Copies the cells of a box between a data space and a
+   * contiguous buffer, visiting the cells in the same order
+   * on both sides of an exchange
+   *
+   * @param dataSpace the data space
+   * @param boxMin the lowest corner of the cells to be copied, in global coordinates
+   * @param boxMax the (exclusive) highest corner of the cells to be copied
+   * @param buffer the contiguous buffer; advanced past the cells copied
+   * @param toBuffer if true, copies from the data space into the buffer;
+   * if false, from the buffer into the data space
+   */
+  void copyBox(T* dataSpace, const vector<int>& boxMin, const vector<int>& boxMax, T*& buffer, bool toBuffer);
+
+  /**
+   * Gets the snapshot header fields that follow the magic string:
+   * number of dimensions, element size in bytes, element kind
+   * ('f' floating point, 'i' signed or 'u' unsigned integer), and
+   * the global origin and extent of each dimension
+   *
+   * @return the header fields for this layer
+   */
+  vector<int> getSnapshotHeader();
+
+  /**
+   * Creates the MPI data types that map this process's local cells
+   * between a data space and a snapshot file
+   *
+   * @param memoryType set to the local cells within the data space
+   * @param fileType set to the local cells within the global space
+   */
+  void getSnapshotDataTypes(MPI_Datatype& memoryType, MPI_Datatype& fileType);
+
 
 };
 
 
+/**
+ * A slab of a value layer (a range of its outermost dimension) to
+ * which a row operation is applied. Used by AbstractValueLayerND::parallelSweep.
+ */
+template<typename T, typename R>
+class ValueLayerSlab: public Functor{
+
+private:
+  const AbstractValueLayerND<T>* layer;
+  R* rowOp;
+  vector<int> lower;
+  vector<int> upper;
+  int tileRows;
+
+public:
+  ValueLayerSlab(const AbstractValueLayerND<T>* valueLayer, R* op, const vector<int>& slabLower, const vector<int>& slabUpper, int tile):
+    layer(valueLayer), rowOp(op), lower(slabLower), upper(slabUpper), tileRows(tile){ }
+
+  void operator()(){
+    if(tileRows <= 0 || lower.size() < 3){
+      layer->forEachRow(lower, upper, *rowOp);
+      return;
+    }
+    vector<int> tileLower(lower);
+    vector<int> tileUpper(upper);
+    for(int row = lower[1]; row < upper[1]; row += tileRows){
+      tileLower[1] = row;
+      tileUpper[1] = std::min(row + tileRows, upper[1]);
+      layer->forEachRow(tileLower, tileUpper, *rowOp);
+    }
+  }
+};
+
+/**
+ * Row operation that fills rows of one or more data spaces,
+ * placing one value in local cells and another in buffer zone
+ * cells. Used by AbstractValueLayerND::fill.
+ */
+template<typename T>
+struct ValueLayerFill{
+  const vector<DimensionDatum<T> >* dimensionData;
+  vector<T*> banks;
+  T localValue;
+  T bufferZoneValue;
+  bool doBufferZone;
+  bool doLocal;
+
+  void operator()(int index, const vector<int>& position, int rowLength){
+    const vector<DimensionDatum<T> >& dims = *dimensionData;
+    bool bufferRow = false;
+    for(size_t d = 1; d < dims.size(); d++) if(position[d] < 0 || position[d] >= dims[d].localWidth) bufferRow = true;
+
+    // The row is a left buffer segment, a local segment and a right buffer segment
+    int first = position[0];
+    int localStart = (bufferRow ? first + rowLength : std::min(std::max(0, first), first + rowLength));
+    int localEnd   = (bufferRow ? first + rowLength : std::max(localStart, std::min(dims[0].localWidth, first + rowLength)));
+    for(size_t b = 0; b < banks.size(); b++){
+      T* row = banks[b] + index - first;
+      if(doBufferZone){
+        std::fill(row + first, row + localStart, bufferZoneValue);
+        std::fill(row + localEnd, row + first + rowLength, bufferZoneValue);
+      }
+      if(doLocal) std::fill(row + localStart, row + localEnd, localValue);
+    }
+  }
+};
+
+/**
+ * Row operation that formats the non-zero cells of rows of a data
+ * space as csv lines. Used by AbstractValueLayerND::writeValues.
+ */
+template<typename T>
+struct ValueLayerWriter{
+  const vector<DimensionDatum<T> >* dimensionData;
+  const T* dataSpace;
+  bool writeSharedBoundaryAreas;
+  string text;
+
+  void operator()(int index, const vector<int>& position, int rowLength){
+    const vector<DimensionDatum<T> >& dims = *dimensionData;
+    bool bufferRow = false;
+    for(size_t d = 1; d < dims.size(); d++) if(position[d] < 0 || position[d] >= dims[d].localWidth) bufferRow = true;
+    if(bufferRow && !writeSharedBoundaryAreas) return;
+
+    std::ostringstream out;
+    for(int x = 0; x < rowLength; x++){
+      int cell = position[0] + x;
+      if(!writeSharedBoundaryAreas && (cell < 0 || cell >= dims[0].localWidth)) continue;
+      T val = dataSpace[index + x];
+      if(val != 0){
+        out << (cell + dims[0].localBoundariesMin) << ",";
+        for(size_t d = 1; d < dims.size(); d++) out << (position[d] + dims[d].localBoundariesMin) << ",";
+        out << val << endl;
+      }
+    }
+    text += out.str();
+  }
+};
+
+
 
 template<typename T>
 int AbstractValueLayerND<T>::instanceCount = 0;
 
 template<typename T>
-AbstractValueLayerND<T>::AbstractValueLayerND(vector<int> processesPerDim, GridDimensions globalBoundaries,int bufferSize, bool periodic): globalSpaceIsPeriodic(periodic), syncCount(0){
+AbstractValueLayerND<T>::AbstractValueLayerND(vector<int> processesPerDim, GridDimensions globalBoundaries,int bufferSize, bool periodic):
+    globalBoundaries(globalBoundaries), bufferSize(bufferSize), globalSpaceIsPeriodic(periodic), syncCount(0), bufferZoneFillValue(){
   instanceID = AbstractValueLayerND<T>::instanceCount;
   AbstractValueLayerND<T>::instanceCount++;
   cartTopology = RepastProcess::instance()->getCartesianTopology(processesPerDim, periodic);
@@ -569,6 +858,17 @@ AbstractValueLayerND<T>::AbstractValueLayerND(vector<int> processesPerDim, GridD
   int rank = RepastProcess::instance()->rank();
   localBoundaries = cartTopology->getDimensions(rank, globalBoundaries);
 
+  createGeometry();
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::createGeometry(){
+  int rank = RepastProcess::instance()->rank();
+  bool periodic = globalSpaceIsPeriodic;
+  dimensionData.clear();
+  places.clear();
+  strides.clear();
+
   // First create the basic coordinate data per dimension
   length = 1;
   int val = 1;
@@ -618,6 +918,338 @@ AbstractValueLayerND<T>::~AbstractValueLayerND(){
   delete[] requests;
 }
 
+template<typename T>
+bool AbstractValueLayerND<T>::redistribute(vector<T*>& banks){
+  int worldSize;
+  MPI_Comm_size(cartTopology->topologyComm, &worldSize);
+
+  // Gather the previous local boundaries of every process
+  vector<int> oldBounds(2 * numDims);
+  for(int i = 0; i < numDims; i++){
+    oldBounds[2 * i]     = dimensionData[i].localBoundariesMin;
+    oldBounds[2 * i + 1] = dimensionData[i].localBoundariesMax;
+  }
+  vector<int> allOldBounds(2 * numDims * worldSize);
+  MPI_Allgather(&oldBounds[0], 2 * numDims, MPI_INT, &allOldBounds[0], 2 * numDims, MPI_INT, cartTopology->topologyComm);
+
+  // And calculate the new local boundaries of every process, truncated as DimensionDatum does
+  vector<int> allNewBounds(2 * numDims * worldSize);
+  bool changed = false;
+  for(int r = 0; r < worldSize; r++){
+    GridDimensions dims = cartTopology->getDimensions(r, globalBoundaries);
+    for(int i = 0; i < numDims; i++){
+      allNewBounds[2 * numDims * r + 2 * i]     = (int)(dims.origin(i));
+      allNewBounds[2 * numDims * r + 2 * i + 1] = (int)(dims.origin(i) + dims.extents(i));
+    }
+  }
+  for(size_t i = 0; i < allNewBounds.size(); i++) if(allNewBounds[i] != allOldBounds[i]) changed = true;
+  if(!changed) return false;
+
+  int rank = RepastProcess::instance()->rank();
+  int* myOld = &allOldBounds[2 * numDims * rank];
+  int* myNew = &allNewBounds[2 * numDims * rank];
+
+  // The overlap of this process's old region with each process's new region is sent to that process
+  int banksCount = banks.size();
+  vector<int> sendCounts(worldSize, 0), sendOffsets(worldSize, 0), recvCounts(worldSize, 0), recvOffsets(worldSize, 0);
+  vector<vector<int> > sendMin(worldSize), sendMax(worldSize), recvMin(worldSize), recvMax(worldSize);
+  int sendTotal = 0;
+  int recvTotal = 0;
+  for(int r = 0; r < worldSize; r++){
+    int* theirOld = &allOldBounds[2 * numDims * r];
+    int* theirNew = &allNewBounds[2 * numDims * r];
+    int sendCells = 1;
+    int recvCells = 1;
+    for(int i = 0; i < numDims; i++){
+      sendMin[r].push_back(std::max(myOld[2 * i], theirNew[2 * i]));
+      sendMax[r].push_back(std::min(myOld[2 * i + 1], theirNew[2 * i + 1]));
+      recvMin[r].push_back(std::max(theirOld[2 * i], myNew[2 * i]));
+      recvMax[r].push_back(std::min(theirOld[2 * i + 1], myNew[2 * i + 1]));
+      sendCells *= std::max(0, sendMax[r][i] - sendMin[r][i]);
+      recvCells *= std::max(0, recvMax[r][i] - recvMin[r][i]);
+    }
+    sendCounts[r]  = sendCells * banksCount;
+    sendOffsets[r] = sendTotal;
+    sendTotal     += sendCounts[r];
+    recvCounts[r]  = recvCells * banksCount;
+    recvOffsets[r] = recvTotal;
+    recvTotal     += recvCounts[r];
+  }
+
+  vector<T> sendBuffer(sendTotal + 1);
+  vector<T> recvBuffer(recvTotal + 1);
+  for(int r = 0; r < worldSize; r++){
+    if(sendCounts[r] == 0) continue;
+    T* pt = &sendBuffer[sendOffsets[r]];
+    for(int b = 0; b < banksCount; b++) copyBox(banks[b], sendMin[r], sendMax[r], pt, true);
+  }
+
+  MPI_Alltoallv(&sendBuffer[0], &sendCounts[0], &sendOffsets[0], getRawMPIDataType(),
+                &recvBuffer[0], &recvCounts[0], &recvOffsets[0], getRawMPIDataType(), cartTopology->topologyComm);
+
+  // Rebuild this layer for the new boundaries
+  for(int i = 0; i < neighborCount; i++) MPI_Type_free(&neighborData[i].datatype);
+  delete[] neighborData;
+  delete[] requests;
+  localBoundaries = cartTopology->getDimensions(rank, globalBoundaries);
+  createGeometry();
+
+  for(int b = 0; b < banksCount; b++){
+    delete[] banks[b];
+    banks[b] = new T[length]();
+  }
+  fill(banks, T(), bufferZoneFillValue, true, false);
+  for(int r = 0; r < worldSize; r++){
+    if(recvCounts[r] == 0) continue;
+    T* pt = &recvBuffer[recvOffsets[r]];
+    for(int b = 0; b < banksCount; b++) copyBox(banks[b], recvMin[r], recvMax[r], pt, false);
+  }
+  return true;
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::startSynchronization(T* dataSpace){
+  syncCount++;
+  if(syncCount > 9) syncCount = 0;
+  int mpiTag = instanceID * 10 + syncCount;
+  // Note: the syncCount and send/recv directions are used to create a unique tag value for the
+  // mpi sends and receives. The tag value must be unique in two ways: first, successive calls to this
+  // function must be different enough that they can't be confused. The 'syncCount' value is used to
+  // achieve this, and it will loop from 0-9 and then repeat. The second, the tag must sometimes
+  // differentiate between sends and receives that are going to the same rank. If a dimension
+  // has only 2 processes but wrap-around borders, then one process may be sending to the other
+  // process twice (once left and once right). The 'sendDir' and 'recvDir' values trap this
+
+  // For each entry in neighbors:
+  for(int i = 0; i < neighborCount; i++){
+    MPI_Isend(&dataSpace[neighborData[i].sendPtrOffset], 1, neighborData[i].datatype,
+        neighborData[i].rank, 10 * (neighborData[i].sendDir + 1) + mpiTag, cartTopology->topologyComm, &requests[i]);
+    MPI_Irecv(&dataSpace[neighborData[i].receivePtrOffset], 1, neighborData[i].datatype,
+        neighborData[i].rank, 10 * (neighborData[i].recvDir + 1) + mpiTag, cartTopology->topologyComm, &requests[neighborCount + i]);
+  }
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::finishSynchronization(){
+  MPI_Status statuses[neighborCount * 2];
+  MPI_Waitall(neighborCount * 2, requests, statuses);
+}
+
+template<typename T>
+template<typename R>
+void AbstractValueLayerND<T>::forEachRow(const vector<int>& lower, const vector<int>& upper, R& rowOp) const{
+  int index = 0;
+  for(int d = 0; d < numDims; d++){
+    if(upper[d] <= lower[d]) return;
+    index += (dimensionData[d].leftBufferSize + lower[d]) * places[d];
+  }
+
+  // Step through the rows with a counter over dimensions 1 and up
+  int rowLength = upper[0] - lower[0];
+  vector<int> position(lower);
+  while(true){
+    rowOp(index, position, rowLength);
+    int d = 1;
+    for(; d < numDims; d++){
+      index += places[d];
+      if(++position[d] < upper[d]) break;
+      index -= (position[d] - lower[d]) * places[d];
+      position[d] = lower[d];
+    }
+    if(d >= numDims) break;
+  }
+}
+
+template<typename T>
+template<typename R>
+void AbstractValueLayerND<T>::parallelSweep(const vector<int>& lower, const vector<int>& upper, vector<R>& rowOps, int tileRows) const{
+  int outer = numDims - 1;
+  long cells = 1;
+  for(int d = 0; d < numDims; d++) cells *= std::max(0, upper[d] - lower[d]);
+
+  ThreadPool* pool = RepastProcess::instance()->getThreadPool();
+  int slabs = 1;
+  if(pool != 0) slabs = (int)std::min((long)(upper[outer] - lower[outer]), std::min((long)(pool->size() * 4), cells / MIN_SLAB_CELLS));
+  if(slabs <= 1){
+    ValueLayerSlab<T, R>(this, &rowOps[0], lower, upper, tileRows)();
+    return;
+  }
+
+  rowOps.resize(slabs, rowOps[0]);
+  vector<ValueLayerSlab<T, R> > slabTasks;
+  slabTasks.reserve(slabs);
+  vector<int> slabLower(lower);
+  vector<int> slabUpper(upper);
+  int extent = upper[outer] - lower[outer];
+  for(int i = 0; i < slabs; i++){
+    slabLower[outer] = lower[outer] + (int)((long)extent * i / slabs);
+    slabUpper[outer] = lower[outer] + (int)((long)extent * (i + 1) / slabs);
+    slabTasks.push_back(ValueLayerSlab<T, R>(this, &rowOps[i], slabLower, slabUpper, tileRows));
+  }
+  vector<Functor*> tasks;
+  for(int i = 0; i < slabs; i++) tasks.push_back(&slabTasks[i]);
+  pool->run(tasks);
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::fill(const vector<T*>& banks, T localValue, T bufferZoneValue, bool doBufferZone, bool doLocal){
+  if(!doBufferZone && !doLocal) return;
+  if(doBufferZone) bufferZoneFillValue = bufferZoneValue;
+  vector<int> lower(numDims), upper(numDims);
+  for(int d = 0; d < numDims; d++){
+    lower[d] = -dimensionData[d].leftBufferSize;
+    upper[d] = dimensionData[d].localWidth + dimensionData[d].rightBufferSize;
+  }
+  ValueLayerFill<T> op;
+  op.dimensionData   = &dimensionData;
+  op.banks           = banks;
+  op.localValue      = localValue;
+  op.bufferZoneValue = bufferZoneValue;
+  op.doBufferZone    = doBufferZone;
+  op.doLocal         = doLocal;
+  vector<ValueLayerFill<T> > ops(1, op);
+  parallelSweep(lower, upper, ops);
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::writeValues(std::ostream& outfile, const T* dataSpace, bool writeSharedBoundaryAreas){
+  vector<int> lower(numDims), upper(numDims);
+  for(int d = 0; d < numDims; d++){
+    lower[d] = (writeSharedBoundaryAreas ? -dimensionData[d].leftBufferSize : 0);
+    upper[d] = dimensionData[d].localWidth + (writeSharedBoundaryAreas ? dimensionData[d].rightBufferSize : 0);
+  }
+  ValueLayerWriter<T> op;
+  op.dimensionData            = &dimensionData;
+  op.dataSpace                = dataSpace;
+  op.writeSharedBoundaryAreas = writeSharedBoundaryAreas;
+  vector<ValueLayerWriter<T> > ops(1, op);
+  parallelSweep(lower, upper, ops);
+  for(size_t i = 0; i < ops.size(); i++) outfile << ops[i].text;
+}
+
+template<typename T>
+vector<int> AbstractValueLayerND<T>::getSnapshotHeader(){
+  vector<int> header;
+  header.push_back(numDims);
+  header.push_back((int)sizeof(T));
+  header.push_back(std::numeric_limits<T>::is_integer ? (std::numeric_limits<T>::is_signed ? 'i' : 'u') : 'f');
+  for(int d = 0; d < numDims; d++){
+    header.push_back(dimensionData[d].globalCoordinateMin);
+    header.push_back(dimensionData[d].globalWidth);
+  }
+  return header;
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::getSnapshotDataTypes(MPI_Datatype& memoryType, MPI_Datatype& fileType){
+  vector<int> widths(numDims), localWidths(numDims), bufferOffsets(numDims), globalWidths(numDims), localOffsets(numDims);
+  for(int d = 0; d < numDims; d++){
+    DimensionDatum<T>& datum = dimensionData[d];
+    widths[d]        = datum.width;
+    localWidths[d]   = datum.localWidth;
+    bufferOffsets[d] = datum.leftBufferSize;
+    globalWidths[d]  = datum.globalWidth;
+    localOffsets[d]  = datum.localBoundariesMin - datum.globalCoordinateMin;
+  }
+  // Fortran order: dimension 0 varies fastest, as in the data space
+  MPI_Type_create_subarray(numDims, &widths[0], &localWidths[0], &bufferOffsets[0], MPI_ORDER_FORTRAN, getRawMPIDataType(), &memoryType);
+  MPI_Type_create_subarray(numDims, &globalWidths[0], &localWidths[0], &localOffsets[0], MPI_ORDER_FORTRAN, getRawMPIDataType(), &fileType);
+  MPI_Type_commit(&memoryType);
+  MPI_Type_commit(&fileType);
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::writeSnapshotData(const string& fileName, const T* dataSpace){
+  MPI_Comm comm = cartTopology->topologyComm;
+  MPI_File file;
+  if(MPI_File_open(comm, const_cast<char*>(fileName.c_str()), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    throw Repast_Error_61(fileName);
+  MPI_File_set_size(file, 0); // Truncate any earlier file of the same name
+
+  vector<int> header = getSnapshotHeader();
+  MPI_Offset headerBytes = SNAPSHOT_MAGIC_LENGTH + header.size() * sizeof(int);
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if(rank == 0){
+    MPI_File_write_at(file, 0, const_cast<char*>(SNAPSHOT_MAGIC), SNAPSHOT_MAGIC_LENGTH, MPI_CHAR, MPI_STATUS_IGNORE);
+    MPI_File_write_at(file, SNAPSHOT_MAGIC_LENGTH, &header[0], header.size(), MPI_INT, MPI_STATUS_IGNORE);
+  }
+
+  MPI_Datatype memoryType, fileType;
+  getSnapshotDataTypes(memoryType, fileType);
+  MPI_File_set_view(file, headerBytes, getRawMPIDataType(), fileType, const_cast<char*>("native"), MPI_INFO_NULL);
+  MPI_File_write_all(file, const_cast<T*>(dataSpace), 1, memoryType, MPI_STATUS_IGNORE);
+  MPI_File_close(&file);
+  MPI_Type_free(&memoryType);
+  MPI_Type_free(&fileType);
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::readSnapshotData(const string& fileName, T* dataSpace){
+  MPI_Comm comm = cartTopology->topologyComm;
+  MPI_File file;
+  if(MPI_File_open(comm, const_cast<char*>(fileName.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+    throw Repast_Error_61(fileName);
+
+  // Every process reads and checks the header, so all of them throw together on a mismatch
+  vector<int> expected = getSnapshotHeader();
+  MPI_Offset headerBytes = SNAPSHOT_MAGIC_LENGTH + expected.size() * sizeof(int);
+  MPI_Offset dataBytes   = sizeof(T);
+  for(int d = 0; d < numDims; d++) dataBytes *= dimensionData[d].globalWidth;
+  MPI_Offset fileBytes;
+  MPI_File_get_size(file, &fileBytes);
+
+  char magic[SNAPSHOT_MAGIC_LENGTH];
+  vector<int> header(expected.size(), 0);
+  int fixedFields = 3;                         // numDims, element size, element kind
+  std::string problem;
+  if(fileBytes < SNAPSHOT_MAGIC_LENGTH + fixedFields * (MPI_Offset)sizeof(int)) problem = "file is too short to hold a header";
+  else{
+    MPI_File_read_at_all(file, 0, magic, SNAPSHOT_MAGIC_LENGTH, MPI_CHAR, MPI_STATUS_IGNORE);
+    MPI_File_read_at_all(file, SNAPSHOT_MAGIC_LENGTH, &header[0], fixedFields, MPI_INT, MPI_STATUS_IGNORE);
+    if(!std::equal(magic, magic + SNAPSHOT_MAGIC_LENGTH, SNAPSHOT_MAGIC))    problem = "not a value layer snapshot";
+    else if(header[0] != expected[0])                                        problem = "it has " + VAL(header[0]) + " dimensions, the layer has " + VAL(expected[0]);
+    else if(header[1] != expected[1] || header[2] != expected[2])            problem = "its elements are of a different type";
+    else if(fileBytes < headerBytes + dataBytes)                             problem = "file is truncated";
+    else{
+      MPI_File_read_at_all(file, SNAPSHOT_MAGIC_LENGTH + fixedFields * sizeof(int), &header[fixedFields], expected.size() - fixedFields, MPI_INT, MPI_STATUS_IGNORE);
+      for(int d = 0; d < numDims && problem.empty(); d++){
+        if(header[fixedFields + 2 * d] != expected[fixedFields + 2 * d] || header[fixedFields + 2 * d + 1] != expected[fixedFields + 2 * d + 1])
+          problem = "global boundaries differ on dimension " + VAL(d);
+      }
+    }
+  }
+  if(!problem.empty()){
+    MPI_File_close(&file);
+    throw Repast_Error_62(fileName, problem);
+  }
+
+  MPI_Datatype memoryType, fileType;
+  getSnapshotDataTypes(memoryType, fileType);
+  MPI_File_set_view(file, headerBytes, getRawMPIDataType(), fileType, const_cast<char*>("native"), MPI_INFO_NULL);
+  MPI_File_read_all(file, dataSpace, 1, memoryType, MPI_STATUS_IGNORE);
+  MPI_File_close(&file);
+  MPI_Type_free(&memoryType);
+  MPI_Type_free(&fileType);
+}
+
+template<typename T>
+void AbstractValueLayerND<T>::copyBox(T* dataSpace, const vector<int>& boxMin, const vector<int>& boxMax, T*& buffer, bool toBuffer){
+  vector<int> location(boxMin);
+  while(true){
+    int indx = getIndex(location);
+    if(toBuffer) *buffer = dataSpace[indx];
+    else         dataSpace[indx] = *buffer;
+    buffer++;
+    int i = 0;
+    while(i < numDims && ++location[i] == boxMax[i]){
+      location[i] = boxMin[i];
+      i++;
+    }
+    if(i == numDims) return;
+  }
+}
+
 template<typename T>
 bool AbstractValueLayerND<T>::isInLocalBounds(vector<int> coords){
   for(int i = 0; i < numDims; i++){
@@ -677,7 +1309,7 @@ void AbstractValueLayerND<T>::getMPIDataType(vector<int> sideLengths, MPI_Dataty
   else{
     MPI_Datatype innerType;
     getMPIDataType(sideLengths, innerType, dimensionIndex - 1);
-    MPI_Type_hvector(sideLengths[dimensionIndex], // Count
+    MPI_Type_create_hvector(sideLengths[dimensionIndex], // Count
                      1,                                                                        // BlockLength: just one of the inner data type
                      strides[dimensionIndex],                                                  // Stride, in bytes
                      innerType,                                                                // Inner Datatype
@@ -826,6 +1458,11 @@ public:
    */
   virtual void synchronize();
 
+  /**
+   * Inherited from AbstractValueLayerND
+   */
+  virtual bool repartition();
+
   /**
    * Write the values in this ValueLayer to a .csv file.
    *
@@ -850,33 +1487,36 @@ public:
    */
   void write(string fileLocation, string filetag, bool writeSharedBoundaryAreas = false);
 
-
-private:
-
-
   /**
-   * Fills a dimension of space with the given value. Used for initialization
-   * and clearing only.
+   * Writes the whole value layer to one binary snapshot file, with all
+   * processes writing their local cells collectively through MPI-IO.
+   * Buffer zones are not written. This is a collective call.
    *
-   * @param localValue the value to be placed in local cells
-   * @param bufferZoneValue the value to be placed in non-local cells
-   * @param doBufferZone if true, places values in the buffer zone
-   * @param doLocal if true, places values in the local cells
-   * @param dataSpacePointer pointer to the first cell in the data array
-   * @param dimIndex index number of this dimension, for recursive calls
+   * The file format is:
+   *
+   * "RHPCVL01"                 8 bytes, identifies the file and format version
+   * N                          int, the number of dimensions
+   * element size, kind         int, int: sizeof(T) and 'f', 'i' or 'u'
+   * origin_0, extent_0 ...     int pairs, the global boundaries for each of the N dimensions
+   * values                     the values of every cell in the global space, dimension 0 varying fastest
+   *
+   * Integers and values are in the native representation of the
+   * machine that wrote the file.
+   *
+   * @param fileName name of the snapshot file; an existing file is replaced
    */
-  void fillDimension(T localValue, T bufferZoneValue, bool doBufferZone, bool doLocal, T* dataSpacePointer, int dimIndex);
+  void writeSnapshot(string fileName);
 
-  /*
-   * Writes one dimension's information to the specified csv file.
+  /**
+   * Sets the values of the local cells from a snapshot file written
+   * by writeSnapshot, then synchronizes the buffer zones. The layer that
+   * wrote the file must have had the same global boundaries and element
+   * type, but may have been split across a different number or
+   * arrangement of processes. This is a collective call.
    *
-   * @param outfile output file
-   * @param dataSpacePointer pointer to the data space to be written
-   * @param currentPosition position currently being written (for recursive calls)
-   * @param dimIndex dimension currently being written (for recursive calls)
-   * @param writeSharedBoundaryAreas if true, write the areas that are non-local to this process
+   * @param fileName name of the snapshot file
    */
-  void writeDimension(std::ofstream& outfile, T* dataSpacePointer, int* currentPosition, int dimIndex, bool writeSharedBoundaryAreas = false);
+  void readSnapshot(string fileName);
 
 };
 
@@ -951,11 +1591,27 @@ public:
    */
   virtual void synchronize();
 
+  /**
+   * Inherited from AbstractValueLayerND
+   */
+  virtual bool repartition();
+
   /**
    * Write this rank's data to a CSV file
    */
   virtual void write(string fileLocation, string filetag, bool writeSharedBoundaryAreas = false);
 
+  /**
+   * Write the current values to a snapshot file (see ValueLayerND::writeSnapshot)
+   */
+  void writeSnapshot(string fileName);
+
+  /**
+   * Read the current values from a snapshot file (see ValueLayerND::readSnapshot)
+   * and synchronize the buffer zones
+   */
+  void readSnapshot(string fileName);
+
   /**
    * Switch from one value layer to the other.
    */
@@ -1035,33 +1691,6 @@ public:
    */
   virtual void copySecondaryToCurrent();
 
-private:
-
-  /**
-   * Fills a dimension of space with the given value. Used for initialization
-   * and clearing only.
-   *
-   * @param localValue the value to be placed in local cells
-   * @param bufferZoneValue the value to be placed in non-local cells
-   * @param doBufferZone if true, places values in the buffer zone
-   * @param doLocal if true, places values in the local cells
-   * @param dataSpace1Pointer pointer to the first cell in the #1 data array
-   * @param dataSpace2Pointer pointer to the first cell in the #2 data array
-   * @param dimIndex index number of this dimension, for recursive calls
-   */
-  void fillDimension(T localValue, T bufferZoneValue, bool doBufferZone, bool doLocal, T* dataSpace1Pointer, T* dataSpace2Pointer, int dimIndex);
-
-  /*
-   * Writes one dimension's information to the specified csv file.
-   *
-   * @param outfile output file
-   * @param dataSpacePointer pointer to the data space to be written
-   * @param currentPosition position currently being written (for recursive calls)
-   * @param dimIndex dimension currently being written (for recursive calls)
-   * @param writeSharedBoundaryAreas if true, write the areas that are non-local to this process
-   */
-  void writeDimension(std::ofstream& outfile, T* dataSpacePointer, int* currentPosition, int dimIndex, bool writeSharedBoundaryAreas = false);
-
 };
 
 
@@ -1088,12 +1717,12 @@ ValueLayerND<T>::~ValueLayerND(){
 
 template<typename T>
 void ValueLayerND<T>::initialize(T initialValue, bool fillBufferZone, bool fillLocal){
-  fillDimension(initialValue, initialValue, fillBufferZone, fillLocal, dataSpace, AbstractValueLayerND<T>::numDims - 1);
+  AbstractValueLayerND<T>::fill(vector<T*>(1, dataSpace), initialValue, initialValue, fillBufferZone, fillLocal);
 }
 
 template<typename T>
 void ValueLayerND<T>::initialize(T initialLocalValue, T initialBufferZoneValue){
-  fillDimension(initialLocalValue, initialBufferZoneValue, true, true, dataSpace, AbstractValueLayerND<T>::numDims - 1);
+  AbstractValueLayerND<T>::fill(vector<T*>(1, dataSpace), initialLocalValue, initialBufferZoneValue, true, true);
 }
 
 template<typename T>
@@ -1169,29 +1798,20 @@ T ValueLayerND<T>::getValueAt(Point<int> location, bool& errFlag){
 
 template<typename T>
 void ValueLayerND<T>::synchronize(){
-  AbstractValueLayerND<T>::syncCount++;
-  if(AbstractValueLayerND<T>::syncCount > 9) AbstractValueLayerND<T>::syncCount = 0;
-  int mpiTag = AbstractValueLayerND<T>::instanceID * 10 + AbstractValueLayerND<T>::syncCount;
-  // Note: the syncCount and send/recv directions are used to create a unique tag value for the
-  // mpi sends and receives. The tag value must be unique in two ways: first, successive calls to this
-  // function must be different enough that they can't be confused. The 'syncCount' value is used to
-  // achieve this, and it will loop from 0-9 and then repeat. The second, the tag must sometimes
-  // differentiate between sends and receives that are going to the same rank. If a dimension
-  // has only 2 processes but wrap-around borders, then one process may be sending to the other
-  // process twice (once left and once right). The 'sendDir' and 'recvDir' values trap this
-
-  // For each entry in neighbors:
-  MPI_Status statuses[AbstractValueLayerND<T>::neighborCount * 2];
-  for(int i = 0; i < AbstractValueLayerND<T>::neighborCount; i++){
-    MPI_Isend(&dataSpace[AbstractValueLayerND<T>::neighborData[i].sendPtrOffset], 1, AbstractValueLayerND<T>::neighborData[i].datatype,
-        AbstractValueLayerND<T>::neighborData[i].rank, 10 * (AbstractValueLayerND<T>::neighborData[i].sendDir + 1) + mpiTag, AbstractValueLayerND<T>::cartTopology->topologyComm, &AbstractValueLayerND<T>::requests[i]);
-    MPI_Irecv(&dataSpace[AbstractValueLayerND<T>::neighborData[i].receivePtrOffset], 1, AbstractValueLayerND<T>::neighborData[i].datatype,
-        AbstractValueLayerND<T>::neighborData[i].rank, 10 * (AbstractValueLayerND<T>::neighborData[i].recvDir + 1) + mpiTag, AbstractValueLayerND<T>::cartTopology->topologyComm, &AbstractValueLayerND<T>::requests[AbstractValueLayerND<T>::neighborCount + i]);
-  }
-  int ret = MPI_Waitall(AbstractValueLayerND<T>::neighborCount * 2, AbstractValueLayerND<T>::requests, statuses);
+  AbstractValueLayerND<T>::startSynchronization(dataSpace);
+  AbstractValueLayerND<T>::finishSynchronization();
 }
 
 
+template<typename T>
+bool ValueLayerND<T>::repartition(){
+  vector<T*> banks(1, dataSpace);
+  if(!AbstractValueLayerND<T>::redistribute(banks)) return false;
+  dataSpace = banks[0];
+  synchronize();
+  return true;
+}
+
 template<typename T>
 void ValueLayerND<T>::write(string fileLocation, string fileTag, bool writeSharedBoundaryAreas){
   std::ofstream outfile;
@@ -1207,122 +1827,24 @@ void ValueLayerND<T>::write(string fileLocation, string fileTag, bool writeShare
   for(int i = 0; i < AbstractValueLayerND<T>::numDims; i++) outfile << "DIM_" << i << ",";
   outfile << "VALUE" << endl;
 
-  int* positions = new int[AbstractValueLayerND<T>::numDims];
-  for(int i = 0; i < AbstractValueLayerND<T>::numDims; i++) positions[i] = 0;
-
-  writeDimension(outfile, dataSpace, positions, AbstractValueLayerND<T>::numDims - 1, writeSharedBoundaryAreas);
+  AbstractValueLayerND<T>::writeValues(outfile, dataSpace, writeSharedBoundaryAreas);
 
   outfile.close();
 }
 
-
 template<typename T>
-void ValueLayerND<T>::fillDimension(T localValue, T bufferValue, bool doBufferZone, bool doLocal, T* dataSpacePointer, int dimIndex){
-  if(!doBufferZone && !doLocal) return;
-  int bufferEdge = AbstractValueLayerND<T>::dimensionData[dimIndex].leftBufferSize;
-  int localEdge  = bufferEdge + AbstractValueLayerND<T>::dimensionData[dimIndex].localWidth;
-  int upperBound = localEdge + AbstractValueLayerND<T>::dimensionData[dimIndex].rightBufferSize;
-
-  int pointerIncrement = AbstractValueLayerND<T>::places[dimIndex];
-
-
-  int i = 0;
-  for(; i < bufferEdge; i++){
-    if(doBufferZone){
-      if(dimIndex == 0){
-        *dataSpacePointer = bufferValue;
-      }
-      else{
-        fillDimension(bufferValue, bufferValue, doBufferZone, doLocal, dataSpacePointer, dimIndex - 1);
-      }
-    }
-    // Increment the pointers
-    dataSpacePointer += pointerIncrement;
-  }
-  for(; i < localEdge; i++){
-    if(doLocal){
-      if(dimIndex == 0){
-        *dataSpacePointer = localValue;
-      }
-      else{
-        fillDimension(localValue, bufferValue, doBufferZone, doLocal, dataSpacePointer, dimIndex - 1);
-      }
-    }
-    // Increment the pointers
-    dataSpacePointer += pointerIncrement;
-  }
-  if(doBufferZone){ // Note: we don't need to finish this at all if not doing buffer zone
-    for(; i < upperBound; i++){
-      if(dimIndex == 0){
-        *dataSpacePointer = bufferValue;
-      }
-      else{
-        fillDimension(bufferValue, bufferValue, doBufferZone, doLocal, dataSpacePointer, dimIndex - 1);
-      }
-    }
-    dataSpacePointer += pointerIncrement;
-  }
-
+void ValueLayerND<T>::writeSnapshot(string fileName){
+  AbstractValueLayerND<T>::writeSnapshotData(fileName, dataSpace);
 }
 
 template<typename T>
-void ValueLayerND<T>::writeDimension(std::ofstream& outfile, T* dataSpacePointer, int* currentPosition, int dimIndex, bool writeSharedBoundaryAreas){
-  int bufferEdge = AbstractValueLayerND<T>::dimensionData[dimIndex].leftBufferSize;
-  int localEdge  = bufferEdge + AbstractValueLayerND<T>::dimensionData[dimIndex].localWidth;
-  int upperBound = localEdge + AbstractValueLayerND<T>::dimensionData[dimIndex].rightBufferSize;
+void ValueLayerND<T>::readSnapshot(string fileName){
+  AbstractValueLayerND<T>::readSnapshotData(fileName, dataSpace);
+  synchronize();
+}
+
 
-  int pointerIncrement = AbstractValueLayerND<T>::places[dimIndex];
-  int i = 0;
-  for(; i < bufferEdge; i++){
-    currentPosition[dimIndex] = i;
-    if(writeSharedBoundaryAreas){
-      if(dimIndex == 0){
-        T val = *dataSpacePointer;
-        if(val != 0){
-          for(int j = 0; j < AbstractValueLayerND<T>::numDims; j++) outfile << (currentPosition[j] - AbstractValueLayerND<T>::dimensionData[j].leftBufferSize + AbstractValueLayerND<T>::dimensionData[j].localBoundariesMin) << ",";
-          outfile << val << endl;
-        }
-      }
-      else{
-        writeDimension(outfile, dataSpacePointer, currentPosition, dimIndex - 1, writeSharedBoundaryAreas);
-      }
-    }
-    // Increment the pointers
-    dataSpacePointer += pointerIncrement;
-  }
-  for(; i < localEdge; i++){
-    currentPosition[dimIndex] = i;
-    if(dimIndex == 0){
-        T val = *dataSpacePointer;
-        if(val != 0){
-          for(int j = 0; j < AbstractValueLayerND<T>::numDims; j++) outfile << (currentPosition[j] - AbstractValueLayerND<T>::dimensionData[j].leftBufferSize + AbstractValueLayerND<T>::dimensionData[j].localBoundariesMin) << ",";
-          outfile << val << endl;
-        }
-    }
-    else{
-      writeDimension(outfile, dataSpacePointer, currentPosition, dimIndex - 1, writeSharedBoundaryAreas);
-    }
-    // Increment the pointers
-    dataSpacePointer += pointerIncrement;
-  }
-  if(writeSharedBoundaryAreas){ // Note: we don't need to finish this at all if not doing buffer zone
-    for(; i < upperBound; i++){
-      currentPosition[dimIndex] = i;
-      if(dimIndex == 0){
-        T val = *dataSpacePointer;
-        if(val != 0){
-          for(int j = 0; j < AbstractValueLayerND<T>::numDims; j++) outfile << (currentPosition[j] - AbstractValueLayerND<T>::dimensionData[j].leftBufferSize + AbstractValueLayerND<T>::dimensionData[j].localBoundariesMin) << ",";
-          outfile << *dataSpacePointer << endl;
-        }
-      }
-      else{
-        writeDimension(outfile, dataSpacePointer, currentPosition, dimIndex - 1, writeSharedBoundaryAreas);
-      }
-    }
-    dataSpacePointer += pointerIncrement;
-  }
 
-}
 
 
 
@@ -1353,12 +1875,18 @@ ValueLayerNDSU<T>::~ValueLayerNDSU(){
 
 template<typename T>
 void ValueLayerNDSU<T>::initialize(T initialValue, bool fillBufferZone, bool fillLocal){
-  fillDimension(initialValue, initialValue, fillBufferZone, fillLocal, dataSpace1, dataSpace2, AbstractValueLayerND<T>::numDims - 1);
+  vector<T*> banks;
+  banks.push_back(dataSpace1);
+  banks.push_back(dataSpace2);
+  AbstractValueLayerND<T>::fill(banks, initialValue, initialValue, fillBufferZone, fillLocal);
 }
 
 template<typename T>
 void ValueLayerNDSU<T>::initialize(T initialLocalValue, T initialBufferZoneValue){
-  fillDimension(initialLocalValue, initialBufferZoneValue, true, true, dataSpace1, dataSpace2, AbstractValueLayerND<T>::numDims - 1);
+  vector<T*> banks;
+  banks.push_back(dataSpace1);
+  banks.push_back(dataSpace2);
+  AbstractValueLayerND<T>::fill(banks, initialLocalValue, initialBufferZoneValue, true, true);
 }
 
 template<typename T>
@@ -1410,26 +1938,23 @@ T ValueLayerNDSU<T>::getValueAt(vector<int> location, bool& errFlag){
 
 template<typename T>
 void ValueLayerNDSU<T>::synchronize(){
-  AbstractValueLayerND<T>::syncCount++;
-  if(AbstractValueLayerND<T>::syncCount > 9) AbstractValueLayerND<T>::syncCount = 0;
-  int mpiTag = AbstractValueLayerND<T>::instanceID * 10 + AbstractValueLayerND<T>::syncCount;
-  // Note: the syncCount and send/recv directions are used to create a unique tag value for the
-  // mpi sends and receives. The tag value must be unique in two ways: first, successive calls to this
-  // function must be different enough that they can't be confused. The 'syncCount' value is used to
-  // achieve this, and it will loop from 0-9 and then repeat. The second, the tag must sometimes
-  // differentiate between sends and receives that are going to the same rank. If a dimension
-  // has only 2 processes but wrap-around borders, then one process may be sending to the other
-  // process twice (once left and once right). The 'sendDir' and 'recvDir' values trap this
+  AbstractValueLayerND<T>::startSynchronization(currentDataSpace);
+  AbstractValueLayerND<T>::finishSynchronization();
+}
 
-  // For each entry in neighbors:
-  MPI_Status statuses[AbstractValueLayerND<T>::neighborCount * 2];
-  for(int i = 0; i < AbstractValueLayerND<T>::neighborCount; i++){
-    MPI_Isend(&currentDataSpace[AbstractValueLayerND<T>::neighborData[i].sendPtrOffset], 1, AbstractValueLayerND<T>::neighborData[i].datatype,
-        AbstractValueLayerND<T>::neighborData[i].rank, 10 * (AbstractValueLayerND<T>::neighborData[i].sendDir + 1) + mpiTag, AbstractValueLayerND<T>::cartTopology->topologyComm, &AbstractValueLayerND<T>::requests[i]);
-    MPI_Irecv(&currentDataSpace[AbstractValueLayerND<T>::neighborData[i].receivePtrOffset], 1, AbstractValueLayerND<T>::neighborData[i].datatype,
-        AbstractValueLayerND<T>::neighborData[i].rank, 10 * (AbstractValueLayerND<T>::neighborData[i].recvDir + 1) + mpiTag, AbstractValueLayerND<T>::cartTopology->topologyComm, &AbstractValueLayerND<T>::requests[AbstractValueLayerND<T>::neighborCount + i]);
-  }
-  int ret = MPI_Waitall(AbstractValueLayerND<T>::neighborCount * 2, AbstractValueLayerND<T>::requests, statuses);
+template<typename T>
+bool ValueLayerNDSU<T>::repartition(){
+  vector<T*> banks;
+  banks.push_back(dataSpace1);
+  banks.push_back(dataSpace2);
+  bool currentIsFirst = (currentDataSpace == dataSpace1);
+  if(!AbstractValueLayerND<T>::redistribute(banks)) return false;
+  dataSpace1 = banks[0];
+  dataSpace2 = banks[1];
+  currentDataSpace = (currentIsFirst ? dataSpace1 : dataSpace2);
+  otherDataSpace   = (currentIsFirst ? dataSpace2 : dataSpace1);
+  synchronize();
+  return true;
 }
 
 template<typename T>
@@ -1447,14 +1972,22 @@ void ValueLayerNDSU<T>::write(string fileLocation, string fileTag, bool writeSha
   for(int i = 0; i < AbstractValueLayerND<T>::numDims; i++) outfile << "DIM_" << i << ",";
   outfile << "VALUE" << endl;
 
-  int* positions = new int[AbstractValueLayerND<T>::numDims];
-  for(int i = 0; i < AbstractValueLayerND<T>::numDims; i++) positions[i] = 0;
-
-  writeDimension(outfile, currentDataSpace, positions, AbstractValueLayerND<T>::numDims - 1, writeSharedBoundaryAreas);
+  AbstractValueLayerND<T>::writeValues(outfile, currentDataSpace, writeSharedBoundaryAreas);
 
   outfile.close();
 }
 
+template<typename T>
+void ValueLayerNDSU<T>::writeSnapshot(string fileName){
+  AbstractValueLayerND<T>::writeSnapshotData(fileName, currentDataSpace);
+}
+
+template<typename T>
+void ValueLayerNDSU<T>::readSnapshot(string fileName){
+  AbstractValueLayerND<T>::readSnapshotData(fileName, currentDataSpace);
+  synchronize();
+}
+
 template<typename T>
 void ValueLayerNDSU<T>::switchValueLayer(){
   // Switch the data banks
@@ -1546,119 +2079,7 @@ void ValueLayerNDSU<T>::copySecondaryToCurrent(){
 }
 
 
-template<typename T>
-void ValueLayerNDSU<T>::fillDimension(T localValue, T bufferValue, bool doBufferZone, bool doLocal, T* dataSpace1Pointer, T* dataSpace2Pointer, int dimIndex){
-  if(!doBufferZone && !doLocal) return;
-  int bufferEdge = AbstractValueLayerND<T>::dimensionData[dimIndex].leftBufferSize;
-  int localEdge  = bufferEdge + AbstractValueLayerND<T>::dimensionData[dimIndex].localWidth;
-  int upperBound = localEdge + AbstractValueLayerND<T>::dimensionData[dimIndex].rightBufferSize;
-
-  int pointerIncrement = AbstractValueLayerND<T>::places[dimIndex];
-
-
-  int i = 0;
-  for(; i < bufferEdge; i++){
-    if(doBufferZone){
-      if(dimIndex == 0){
-        *dataSpace1Pointer = bufferValue;
-        *dataSpace2Pointer = bufferValue;
-      }
-      else{
-        fillDimension(bufferValue, bufferValue, doBufferZone, doLocal, dataSpace1Pointer, dataSpace2Pointer, dimIndex - 1);
-      }
-    }
-    // Increment the pointers
-    dataSpace1Pointer += pointerIncrement;
-    dataSpace2Pointer += pointerIncrement;
-  }
-  for(; i < localEdge; i++){
-    if(doLocal){
-      if(dimIndex == 0){
-        *dataSpace1Pointer = localValue;
-        *dataSpace2Pointer = localValue;
-      }
-      else{
-        fillDimension(localValue, bufferValue, doBufferZone, doLocal, dataSpace1Pointer, dataSpace2Pointer, dimIndex - 1);
-      }
-    }
-    // Increment the pointers
-    dataSpace1Pointer += pointerIncrement;
-    dataSpace2Pointer += pointerIncrement;
-  }
-  if(doBufferZone){ // Note: we don't need to finish this at all if not doing buffer zone
-    for(; i < upperBound; i++){
-      if(dimIndex == 0){
-        *dataSpace1Pointer = bufferValue;
-        *dataSpace2Pointer = bufferValue;
-      }
-      else{
-        fillDimension(bufferValue, bufferValue, doBufferZone, doLocal, dataSpace1Pointer, dataSpace2Pointer, dimIndex - 1);
-      }
-    }
-    dataSpace1Pointer += pointerIncrement;
-    dataSpace2Pointer += pointerIncrement;
-  }
-
-}
-
-template<typename T>
-void ValueLayerNDSU<T>::writeDimension(std::ofstream& outfile, T* dataSpacePointer, int* currentPosition, int dimIndex, bool writeSharedBoundaryAreas){
-  int bufferEdge = AbstractValueLayerND<T>::dimensionData[dimIndex].leftBufferSize;
-  int localEdge  = bufferEdge + AbstractValueLayerND<T>::dimensionData[dimIndex].localWidth;
-  int upperBound = localEdge + AbstractValueLayerND<T>::dimensionData[dimIndex].rightBufferSize;
-
-  int pointerIncrement = AbstractValueLayerND<T>::places[dimIndex];
-  int i = 0;
-  for(; i < bufferEdge; i++){
-    currentPosition[dimIndex] = i;
-    if(writeSharedBoundaryAreas){
-      if(dimIndex == 0){
-        T val = *dataSpacePointer;
-        if(val != 0){
-          for(int j = 0; j < AbstractValueLayerND<T>::numDims; j++) outfile << (currentPosition[j] - AbstractValueLayerND<T>::dimensionData[j].leftBufferSize + AbstractValueLayerND<T>::dimensionData[j].localBoundariesMin) << ",";
-          outfile << val << endl;
-        }
-      }
-      else{
-        writeDimension(outfile, dataSpacePointer, currentPosition, dimIndex - 1, writeSharedBoundaryAreas);
-      }
-    }
-    // Increment the pointers
-    dataSpacePointer += pointerIncrement;
-  }
-  for(; i < localEdge; i++){
-    currentPosition[dimIndex] = i;
-    if(dimIndex == 0){
-        T val = *dataSpacePointer;
-        if(val != 0){
-          for(int j = 0; j < AbstractValueLayerND<T>::numDims; j++) outfile << (currentPosition[j] - AbstractValueLayerND<T>::dimensionData[j].leftBufferSize + AbstractValueLayerND<T>::dimensionData[j].localBoundariesMin) << ",";
-          outfile << val << endl;
-        }
-    }
-    else{
-      writeDimension(outfile, dataSpacePointer, currentPosition, dimIndex - 1, writeSharedBoundaryAreas);
-    }
-    // Increment the pointers
-    dataSpacePointer += pointerIncrement;
-  }
-  if(writeSharedBoundaryAreas){ // Note: we don't need to finish this at all if not doing buffer zone
-    for(; i < upperBound; i++){
-      currentPosition[dimIndex] = i;
-      if(dimIndex == 0){
-        T val = *dataSpacePointer;
-        if(val != 0){
-          for(int j = 0; j < AbstractValueLayerND<T>::numDims; j++) outfile << (currentPosition[j] - AbstractValueLayerND<T>::dimensionData[j].leftBufferSize + AbstractValueLayerND<T>::dimensionData[j].localBoundariesMin) << ",";
-          outfile << *dataSpacePointer << endl;
-        }
-      }
-      else{
-        writeDimension(outfile, dataSpacePointer, currentPosition, dimIndex - 1, writeSharedBoundaryAreas);
-      }
-    }
-    dataSpacePointer += pointerIncrement;
-  }
 
-}
 
 
 
@@ -46,6 +46,8 @@
 #include <boost/unordered_map.hpp>
 #include <boost/smart_ptr.hpp>
 
+#include "AgentIdMap.h"
+
 namespace repast {
 
 template<typename V, typename E>
@@ -68,8 +70,8 @@ struct HashVertex {
  */
 template<typename V, typename E>
 struct NodeGetter: public std::unary_function<
-		typename boost::unordered_map<AgentId, Vertex<V, E>*, HashId>::value_type, V*> {
-	V* operator()(const typename boost::unordered_map<AgentId, Vertex<V, E>*, HashId>::value_type& value) const {
+		typename AgentIdMap<Vertex<V, E>*>::value_type, V*> {
+	V* operator()(const typename AgentIdMap<Vertex<V, E>*>::value_type& value) const {
 		return value.second->ptr.get();
 	}
 };
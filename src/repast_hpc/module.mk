@@ -8,10 +8,12 @@ AgentRequest.cpp \
 NetworkBuilder.cpp \
 SRManager.cpp \
 AgentStatus.cpp \
+Profiler.cpp \
 Properties.cpp \
 SVDataSetBuilder.cpp \
 Graph.cpp \
 Random.cpp \
+RandomStream.cpp \
 SVDataSet.cpp \
 GridComponents.cpp \
 RepastErrors.cpp \
@@ -21,9 +23,11 @@ RepastProcess.cpp \
 ValueLayer.cpp \
 initialize_random.cpp \
 Schedule.cpp \
+ThreadPool.cpp \
 Variable.cpp \
 io.cpp \
 SharedBaseGrid.cpp \
+SpaceFillingCurve.cpp \
 logger.cpp \
 SharedContext.cpp
 
@@ -57,6 +57,12 @@ const int EXPORTER_UPDATE_IMPORTERS = 1008;
 const int AGENT_MOVED_SENDERS = 1009;
 const int AGENT_MOVED_AGENT = 1010;
 
+const int SR_SPARSE_EXCHANGE_A = 1011;
+const int SR_SPARSE_EXCHANGE_B = 1012;
+
+const int AGENT_SYNC_STATE_COUNT = 1013;
+const int AGENT_SYNC_STATE_EXCESS = 1014;
+
 
 }
 
@@ -43,6 +43,10 @@
 #include "repast_hpc/Graph.h"
 #include "repast_hpc/ValueLayer.h"
 #include "repast_hpc/GridComponents.h"
+#include "repast_hpc/RepastProcess.h"
+#include "repast_hpc/SharedNetwork.h"
+#include "repast_hpc/NetworkPartitioner.h"
+#include "repast_hpc/SharedDiscreteSpace.h"
 
 #include "test.h"
 
@@ -50,7 +54,13 @@
 #include <boost/smart_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/unordered_set.hpp>
+#include <boost/mpi/packed_oarchive.hpp>
+#include <boost/mpi/packed_iarchive.hpp>
+#include <boost/serialization/export.hpp>
 #include <vector>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
 
 using namespace repast;
 using namespace boost;
@@ -493,10 +503,31 @@ TEST_F(ContextTest, AgentByType)
 		expected.insert(AgentId(i, 0, 1));
 	}
 
-	for (Context<TestAgent>::const_bytype_iterator iter = context.byTypeBegin(1); iter != context.byTypeEnd(0); ++iter) {
+	for (Context<TestAgent>::const_bytype_iterator iter = context.byTypeBegin(1); iter != context.byTypeEnd(1); ++iter) {
 		ASSERT_EQ(1, expected.erase((*iter)->getId()));
 	}
 	ASSERT_EQ(0, expected.size());
+
+	// removing agents keeps the per type indexes up to date
+	for (int i = 0; i < 10; i += 3) {
+		context.removeAgent(AgentId(i, 0, 1));
+	}
+	for (int i = 0; i < 10; i++) {
+		if (i % 3 != 0) expected.insert(AgentId(i, 0, 1));
+	}
+	for (Context<TestAgent>::const_bytype_iterator iter = context.byTypeBegin(1); iter != context.byTypeEnd(1); ++iter) {
+		ASSERT_EQ(1, expected.erase((*iter)->getId()));
+	}
+	ASSERT_EQ(0, expected.size());
+	ASSERT_EQ(10, countOf(context.byTypeBegin(0), context.byTypeEnd(0)));
+	ASSERT_TRUE(context.byTypeBegin(2) == context.byTypeEnd(2));
+
+	std::vector<TestAgent*> selected;
+	context.selectAgents(3, selected, 1);
+	ASSERT_EQ(3, selected.size());
+	for (size_t i = 0; i < selected.size(); i++) {
+		ASSERT_EQ(1, selected[i]->getId().agentType());
+	}
 }
 
 
@@ -1363,3 +1394,750 @@ TEST_F(ContextTest, AgentSelection_Filtered_ByType){
 		
 	}
 }
+
+struct RawPackage {
+	int id, proc, type;
+	double value;
+};
+
+struct SerializedPackage {
+	friend class boost::serialization::access;
+	template<class Archive>
+	void serialize(Archive& ar, const unsigned int version) {
+		ar & id;
+		ar & value;
+	}
+
+	repast::AgentId id;
+	double value;
+};
+
+TEST(ContentTraitsTest, RawPacket) {
+	ASSERT_TRUE(repast::is_raw_content<RawPackage>::value);
+	ASSERT_FALSE(repast::is_raw_content<SerializedPackage>::value);
+
+	std::vector<RawPackage>* content = new std::vector<RawPackage>;
+	for (int i = 0; i < 100; i++) {
+		RawPackage pkg = { i, 1, 2, i * 0.5 };
+		content->push_back(pkg);
+	}
+	Request_Packet<RawPackage> out(content, new std::map<std::string, std::vector<ProjectionInfoPacket*> >());
+
+	boost::mpi::communicator world;
+	boost::mpi::packed_oarchive::buffer_type buffer;
+	boost::mpi::packed_oarchive oa(world, buffer);
+	oa << out;
+	Request_Packet<RawPackage> in;
+	boost::mpi::packed_iarchive ia(world, buffer);
+	ia >> in;
+
+	ASSERT_EQ(100u, in.agentContentPtr->size());
+	for (int i = 0; i < 100; i++) {
+		const RawPackage& pkg = (*in.agentContentPtr)[i];
+		ASSERT_EQ(i, pkg.id);
+		ASSERT_EQ(1, pkg.proc);
+		ASSERT_EQ(2, pkg.type);
+		ASSERT_EQ(i * 0.5, pkg.value);
+	}
+	ASSERT_TRUE(in.projectionInfoPtr->empty());
+}
+
+class PooledAgent: public repast::Agent {
+private:
+	repast::AgentId id_;
+
+public:
+	PooledAgent(const repast::AgentId& id) : id_(id) {
+	}
+
+	repast::AgentId& getId() {
+		return id_;
+	}
+
+	const repast::AgentId& getId() const {
+		return id_;
+	}
+};
+
+TEST(SharedContextTest, RecycleNonLocalAgents) {
+	boost::mpi::communicator world;
+	SharedContext<PooledAgent> context(&world);
+	int other = world.rank() + 1;
+
+	// Without recycling, nothing is pooled
+	context.addAgent(new PooledAgent(AgentId(1, other, 0, other)));
+	context.removeAgent(AgentId(1, other, 0, other));
+	ASSERT_TRUE(context.recycledAgent(AgentId(2, other, 0, other)) == 0);
+
+	context.recycleNonLocalAgents(true);
+	PooledAgent* nonLocal = new PooledAgent(AgentId(3, other, 0, other));
+	ASSERT_EQ(nonLocal, context.addAgent(nonLocal));
+	context.addAgent(new PooledAgent(AgentId(4, world.rank(), 0)));
+	context.removeAgent(AgentId(3, other, 0, other));
+	context.removeAgent(AgentId(4, world.rank(), 0));
+	ASSERT_FALSE(context.contains(AgentId(3, other, 0, other)));
+
+	// Only the non-local agent is pooled, and only for its own type
+	ASSERT_TRUE(context.recycledAgent(AgentId(5, other, 1, other)) == 0);
+	PooledAgent* recycled = context.recycledAgent(AgentId(5, other, 0, other));
+	ASSERT_EQ(nonLocal, recycled);
+	ASSERT_EQ(AgentId(5, other, 0, other), recycled->getId());
+	ASSERT_TRUE(context.recycledAgent(AgentId(6, other, 0, other)) == 0);
+
+	context.addAgent(recycled);
+	ASSERT_EQ(recycled, context.getAgent(AgentId(5, other, 0, other)));
+}
+
+class ParallelAgent: public repast::Agent {
+private:
+	repast::AgentId id_;
+
+public:
+	double value;
+	int visits;
+
+	ParallelAgent(const repast::AgentId& id) : id_(id), value(-1), visits(0) {
+	}
+
+	repast::AgentId& getId() {
+		return id_;
+	}
+
+	const repast::AgentId& getId() const {
+		return id_;
+	}
+};
+
+struct DrawValue {
+	std::atomic<int> count;
+
+	DrawValue() : count(0) {
+	}
+
+	void operator()(ParallelAgent* agent, Random& random) {
+		agent->value = random.nextDouble();
+		agent->visits++;
+		count++;
+	}
+};
+
+TEST_F(ContextTest, ParallelForLocal) {
+	boost::mpi::communicator world;
+	SharedContext<ParallelAgent> threaded(&world);
+	SharedContext<ParallelAgent> serial(&world);
+	int other = world.rank() + 1;
+	for (int i = 0; i < 1000; i++) {
+		threaded.addAgent(new ParallelAgent(AgentId(i, world.rank(), i % 2)));
+		serial.addAgent(new ParallelAgent(AgentId(i, world.rank(), i % 2)));
+	}
+	threaded.addAgent(new ParallelAgent(AgentId(0, other, 0, other)));
+	serial.addAgent(new ParallelAgent(AgentId(0, other, 0, other)));
+
+	RepastProcess::instance()->useThreads(4);
+	DrawValue draw;
+	threaded.parallelForLocal(draw, 16);
+	ASSERT_EQ(1000, draw.count);
+	ASSERT_EQ(0, threaded.getAgent(AgentId(0, other, 0, other))->visits);
+
+	DrawValue typeOne;
+	threaded.parallelForLocal(1, typeOne, 16);
+	ASSERT_EQ(500, typeOne.count);
+
+	// The same draws are made without threads
+	RepastProcess::instance()->useThreads(1);
+	DrawValue serialDraw;
+	serial.parallelForLocal(serialDraw, 16);
+	for (int i = 0; i < 1000; i++) {
+		ParallelAgent* agent = threaded.getAgent(AgentId(i, world.rank(), i % 2));
+		ASSERT_EQ(1 + i % 2, agent->visits);
+		if (i % 2 == 0) {
+			ASSERT_EQ(serial.getAgent(agent->getId())->value, agent->value);
+		}
+		ASSERT_GE(agent->value, 0);
+	}
+}
+
+class StoredAgent: public ParallelAgent {
+public:
+	static int live;
+
+	StoredAgent(const repast::AgentId& id, double val) : ParallelAgent(id) {
+		value = val;
+		live++;
+	}
+
+	~StoredAgent() {
+		live--;
+	}
+};
+
+int StoredAgent::live = 0;
+
+TEST(SharedContextTest, AgentStore) {
+	boost::mpi::communicator world;
+	RepastProcess::init("./config.props");
+	boost::shared_ptr<AgentStore<StoredAgent> > store(new AgentStore<StoredAgent>(8));
+	{
+		SharedContext<ParallelAgent> context(&world);
+		std::vector<StoredAgent*> agents;
+		for (int i = 0; i < 20; i++) {
+			agents.push_back(store->create(AgentId(i, world.rank(), 0), i * 0.5));
+			ASSERT_EQ(agents.back(), context.addAgent(agents.back(), store));
+		}
+		ASSERT_EQ(20, StoredAgent::live);
+		ASSERT_EQ(20u, store->size());
+		ASSERT_EQ(24u, store->capacity());
+		ASSERT_EQ(2, store.use_count()); // Agents do not hold the store; the context does, once
+		ASSERT_EQ(agents[3], context.addAgent(store->create(AgentId(3, world.rank(), 0), 0.0), store));
+		store->destroy(store->create(AgentId(30, world.rank(), 0), 0.0));
+
+		// Agents are visited in the order they were created
+		int i = 0;
+		for (AgentStore<StoredAgent>::const_iterator iter = store->begin(); iter != store->end(); ++iter, ++i) {
+			if (i == 20) break;
+			ASSERT_EQ(agents[i], *iter);
+		}
+
+		context.removeAgent(agents[5]->getId());
+		ASSERT_FALSE(context.contains(AgentId(5, world.rank(), 0)));
+		ASSERT_EQ(20, StoredAgent::live);
+		// The slot of the removed agent is reused
+		StoredAgent* reused = store->create(AgentId(50, world.rank(), 0), 1.0);
+		ASSERT_EQ(agents[5], reused);
+		context.addAgent(reused, store);
+		ASSERT_EQ(1.0, context.getAgent(AgentId(50, world.rank(), 0))->value);
+		ASSERT_EQ(2.0, context.getAgent(AgentId(4, world.rank(), 0))->value);
+	}
+	// The duplicate of agent 3 was never added, so it is still in the store
+	ASSERT_EQ(1u, store->size());
+	store.reset();
+	ASSERT_EQ(0, StoredAgent::live);
+
+	// The context keeps the store until its agents are gone
+	{
+		SharedContext<ParallelAgent> context(&world);
+		store.reset(new AgentStore<StoredAgent>(8));
+		for (int i = 0; i < 10; i++) context.addAgent(store->create(AgentId(i, world.rank(), 0), i * 0.5), store);
+		store.reset();
+		ASSERT_EQ(10, StoredAgent::live);
+		context.removeAgent(AgentId(2, world.rank(), 0));
+		ASSERT_EQ(9, StoredAgent::live);
+	}
+	ASSERT_EQ(0, StoredAgent::live);
+}
+
+TEST(AgentIdMapTest, Operations) {
+	AgentIdMap<int> map;
+	std::map<AgentId, int> expected;
+	ASSERT_TRUE(map.find(AgentId(0, 0, 0)) == map.end());
+
+	// insert, then erase and reinsert many times, as with non-local agent churn
+	Random* random = Random::instance();
+	for (int round = 0; round < 20; round++) {
+		for (int i = 0; i < 500; i++) {
+			AgentId id((int) (random->nextDouble() * 2000), i % 3, i % 2);
+			bool present = expected.find(id) != expected.end();
+			if (present) {
+				ASSERT_EQ(1u, map.erase(id));
+				expected.erase(id);
+			} else {
+				ASSERT_TRUE(map.insert(std::make_pair(id, i)).second);
+				expected[id] = i;
+			}
+		}
+		ASSERT_EQ(expected.size(), map.size());
+		for (std::map<AgentId, int>::iterator iter = expected.begin(); iter != expected.end(); ++iter) {
+			AgentIdMap<int>::const_iterator found = map.find(iter->first);
+			ASSERT_TRUE(found != map.end());
+			ASSERT_EQ(iter->second, found->second);
+		}
+		size_t count = 0;
+		for (AgentIdMap<int>::iterator iter = map.begin(); iter != map.end(); ++iter, ++count)
+			ASSERT_EQ(expected[iter->first], iter->second);
+		ASSERT_EQ(expected.size(), count);
+	}
+
+	// Erasing while iterating leaves the other entries in place
+	for (AgentIdMap<int>::iterator iter = map.begin(); iter != map.end();) {
+		if (iter->second % 2 == 0) iter = map.erase(iter);
+		else ++iter;
+	}
+	for (AgentIdMap<int>::iterator iter = map.begin(); iter != map.end(); ++iter)
+		ASSERT_EQ(1, iter->second % 2);
+
+	AgentIdMap<int> copy(map);
+	map.clear();
+	ASSERT_TRUE(map.empty());
+	ASSERT_FALSE(copy.empty());
+	map[AgentId(1, 2, 3)] = 4;
+	ASSERT_EQ(4, map[AgentId(1, 2, 3)]);
+	ASSERT_EQ(1u, map.count(AgentId(1, 2, 3)));
+	ASSERT_EQ(0u, map.count(AgentId(1, 2, 4)));
+}
+
+struct FailingCopy {
+	static bool fail;
+	int value;
+
+	FailingCopy(int v = 0) : value(v) {
+	}
+
+	FailingCopy(const FailingCopy& other) : value(other.value) {
+		if (fail) throw std::runtime_error("copy failed");
+	}
+};
+
+bool FailingCopy::fail = false;
+
+TEST(AgentIdMapTest, FailedInsert) {
+	AgentIdMap<FailingCopy> map;
+	std::map<AgentId, int> expected;
+
+	// Churn leaves deleted entries behind; an insert that fails must not turn them into empty ones
+	Random* random = Random::instance();
+	for (int round = 0; round < 20; round++) {
+		for (int i = 0; i < 500; i++) {
+			AgentId id((int) (random->nextDouble() * 2000), 0, 0);
+			if (expected.find(id) != expected.end()) {
+				map.erase(id);
+				expected.erase(id);
+			} else {
+				map.insert(std::make_pair(id, FailingCopy(i)));
+				expected[id] = i;
+			}
+		}
+		for (int i = 0; i < 50; i++) {
+			std::pair<AgentId, FailingCopy> entry(AgentId(2000 + i, 0, 0), FailingCopy(i));
+			FailingCopy::fail = true;
+			ASSERT_THROW(map.insert(entry), std::runtime_error);
+			FailingCopy::fail = false;
+			ASSERT_TRUE(map.find(entry.first) == map.end());
+		}
+		ASSERT_EQ(expected.size(), map.size());
+		for (std::map<AgentId, int>::iterator iter = expected.begin(); iter != expected.end(); ++iter) {
+			AgentIdMap<FailingCopy>::const_iterator found = map.find(iter->first);
+			ASSERT_TRUE(found != map.end());
+			ASSERT_EQ(iter->second, found->second.value);
+		}
+	}
+}
+
+namespace {
+
+template<typename Map>
+void benchmarkAgentMap(const std::string& name, const std::vector<AgentId>& ids) {
+	Map map;
+	Timer timer;
+	timer.start();
+	for (size_t i = 0; i < ids.size(); i++)
+		map[ids[i]] = (int) i;
+	long double insert = timer.stop();
+
+	timer.start();
+	long sum = 0;
+	for (int round = 0; round < 10; round++)
+		for (size_t i = 0; i < ids.size(); i++)
+			sum += map.find(ids[i])->second;
+	long double lookup = timer.stop();
+
+	// ghost churn: a tenth of the entries are replaced every round
+	timer.start();
+	size_t churn = ids.size() / 10;
+	for (int round = 0; round < 10; round++) {
+		for (size_t i = 0; i < churn; i++)
+			map.erase(ids[(round * churn + i) % ids.size()]);
+		for (size_t i = 0; i < churn; i++)
+			map[ids[(round * churn + i) % ids.size()]] = (int) i;
+	}
+	long double churnTime = timer.stop();
+
+	timer.start();
+	for (size_t i = 0; i < ids.size(); i++)
+		map.erase(ids[i]);
+	long double erase = timer.stop();
+
+	std::cout << name << ": insert " << insert << " s, 10x lookup " << lookup << " s, churn " << churnTime
+			<< " s, erase " << erase << " s (" << sum % 2 << ")" << std::endl;
+}
+
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(AgentIdMapTest, DISABLED_Benchmark) {
+	std::vector<AgentId> ids;
+	for (int i = 0; i < 1000000; i++)
+		ids.push_back(AgentId(i, i % 64, i % 4));
+	std::random_shuffle(ids.begin(), ids.end(), uni_random);
+	benchmarkAgentMap<AgentIdMap<int> >("AgentIdMap", ids);
+	benchmarkAgentMap<boost::unordered_map<AgentId, int, HashId> >("boost::unordered_map", ids);
+}
+
+TEST(SharedContextTest, RandomSampling) {
+	boost::mpi::communicator world;
+	SharedContext<ParallelAgent> context(&world);
+	int other = world.rank() + 1;
+	for (int i = 0; i < 1000; i++)
+		context.addAgent(new ParallelAgent(AgentId(i, world.rank(), i % 4)));
+	for (int i = 0; i < 200; i++)
+		context.addAgent(new ParallelAgent(AgentId(i, other, 0, other)));
+	for (int i = 0; i < 1000; i += 2)
+		context.removeAgent(AgentId(i, world.rank(), i % 4));
+
+	std::set<ParallelAgent*> selected;
+	context.selectAgents(SharedContext<ParallelAgent>::LOCAL, 50, selected);
+	ASSERT_EQ(50u, selected.size());
+	for (std::set<ParallelAgent*>::iterator iter = selected.begin(); iter != selected.end(); ++iter) {
+		ASSERT_EQ(world.rank(), (*iter)->getId().currentRank());
+		ASSERT_EQ(1, (*iter)->getId().id() % 2);
+	}
+
+	std::vector<ParallelAgent*> nonLocal;
+	context.selectAgents(SharedContext<ParallelAgent>::NON_LOCAL, 20, nonLocal, 0);
+	ASSERT_EQ(20u, nonLocal.size());
+	for (size_t i = 0; i < nonLocal.size(); i++)
+		ASSERT_EQ(other, nonLocal[i]->getId().currentRank());
+
+	// Previously chosen agents are not chosen again
+	std::vector<ParallelAgent*> agents;
+	context.getRandomAgents(5, agents);
+	context.getRandomAgents(20, agents);
+	std::set<ParallelAgent*> distinct(agents.begin(), agents.end());
+	ASSERT_EQ(25u, agents.size());
+	ASSERT_EQ(25u, distinct.size());
+	agents.clear();
+	context.getRandomAgents(1000, agents);
+	ASSERT_EQ(700u, agents.size());
+
+	// Each agent is equally likely to be chosen
+	SharedContext<ParallelAgent> small(&world);
+	for (int i = 0; i < 10; i++)
+		small.addAgent(new ParallelAgent(AgentId(i, world.rank(), 0)));
+	std::map<int, int> counts;
+	for (int i = 0; i < 20000; i++) {
+		std::vector<ParallelAgent*> one;
+		small.selectAgents(1, one);
+		counts[one[0]->getId().id()]++;
+	}
+	for (int i = 0; i < 10; i++) {
+		ASSERT_GT(counts[i], 1700);
+		ASSERT_LT(counts[i], 2300);
+	}
+}
+
+struct PackageProvider {
+	SharedContext<ParallelAgent>* context;
+	std::vector<AgentId> provided;
+	std::vector<std::pair<int, int> > requests; // source and target of each request
+
+	PackageProvider(SharedContext<ParallelAgent>* c) : context(c) {
+	}
+
+	void provideContent(const AgentRequest& request, std::vector<RawPackage>& out) {
+		requests.push_back(std::make_pair(request.sourceProcess(), request.targetProcess()));
+		const std::vector<AgentId>& ids = request.requestedAgents();
+		for (size_t i = 0; i < ids.size(); i++) {
+			provided.push_back(ids[i]);
+			RawPackage package = { ids[i].id(), ids[i].startingRank(), ids[i].agentType(), context->getAgent(ids[i])->value };
+			out.push_back(package);
+		}
+	}
+};
+
+struct PackageReceiver {
+	std::vector<int> updated;
+	std::vector<double> values;
+
+	void updateAgent(const RawPackage& package) {
+		updated.push_back(package.id);
+		values.push_back(package.value);
+	}
+
+	ParallelAgent* createAgent(const RawPackage& package) {
+		return new ParallelAgent(AgentId(package.id, package.proc, package.type));
+	}
+};
+
+// Each process imports agents first to last - 1 from the next process
+void importNextAgents(SharedContext<ParallelAgent>& context, PackageProvider& provider, PackageReceiver& receiver,
+		int first, int last, bool cancel) {
+	RepastProcess* process = RepastProcess::instance();
+	int next = (process->rank() + 1) % process->worldSize();
+	AgentRequest request(process->rank());
+	for (int i = first; i < last; i++) {
+		if (cancel) request.addCancellation(AgentId(i, next, 0));
+		else request.addRequest(AgentId(i, next, 0));
+	}
+	process->requestAgents<ParallelAgent, RawPackage, PackageProvider, PackageReceiver, PackageReceiver>(
+			context, request, provider, receiver, receiver);
+}
+
+TEST(AgentStatesTest, ChangedAgents) {
+	boost::mpi::communicator world;
+	RepastProcess::init("./config.props");
+	if (world.size() < 2) GTEST_SKIP() << "needs agents imported from another process; run under mpirun with 2 or more processes";
+
+	RepastProcess* process = RepastProcess::instance();
+	SharedContext<ParallelAgent> context(&world);
+	for (int i = 0; i < 20; i++)
+		context.addAgent(new ParallelAgent(AgentId(i, world.rank(), 0)));
+	PackageProvider provider(&context);
+	PackageReceiver receiver;
+	importNextAgents(context, provider, receiver, 0, 10, false);
+
+	provider.provided.clear();
+	provider.requests.clear();
+	receiver.updated.clear();
+	process->synchronizeAgentStates<RawPackage>(provider, receiver);
+	ASSERT_EQ(10u, provider.provided.size());
+	ASSERT_EQ(10u, receiver.updated.size());
+	std::vector<std::pair<int, int> > fullRequests = provider.requests;
+
+	// Only the changed agents that are exported are sent ...
+	provider.provided.clear();
+	provider.requests.clear();
+	receiver.updated.clear();
+	process->agentChanged(AgentId(7, world.rank(), 0));
+	process->agentChanged(AgentId(2, world.rank(), 0));
+	process->agentChanged(AgentId(15, world.rank(), 0));
+	process->synchronizeChangedAgentStates<RawPackage>(provider, receiver);
+	std::sort(receiver.updated.begin(), receiver.updated.end());
+	ASSERT_EQ(2u, provider.provided.size());
+	ASSERT_EQ(2u, receiver.updated.size());
+	ASSERT_EQ(2, receiver.updated[0]);
+	ASSERT_EQ(7, receiver.updated[1]);
+	ASSERT_TRUE(fullRequests == provider.requests);
+
+	// ... and only once
+	provider.provided.clear();
+	receiver.updated.clear();
+	process->synchronizeChangedAgentStates<RawPackage>(provider, receiver);
+	ASSERT_EQ(0u, provider.provided.size());
+	ASSERT_EQ(0u, receiver.updated.size());
+
+	importNextAgents(context, provider, receiver, 0, 10, true);
+}
+
+TEST(AgentStatesTest, SplitPhase) {
+	boost::mpi::communicator world;
+	RepastProcess::init("./config.props");
+	if (world.size() < 2) GTEST_SKIP() << "needs agents imported from another process; run under mpirun with 2 or more processes";
+
+	RepastProcess* process = RepastProcess::instance();
+	int next = (world.rank() + 1) % world.size();
+	SharedContext<ParallelAgent> context(&world);
+	for (int i = 0; i < 20; i++) {
+		ParallelAgent* agent = new ParallelAgent(AgentId(i, world.rank(), 0));
+		agent->value = world.rank() * 100 + i;
+		context.addAgent(agent);
+	}
+	PackageProvider provider(&context);
+	PackageReceiver receiver;
+	importNextAgents(context, provider, receiver, 0, 10, false);
+
+	// The content that exceeds what was exchanged before follows the count;
+	// once the count is known, content is sent as soon as a sync begins
+	for (int round = 0; round < 4; round++) {
+		if (round == 2) importNextAgents(context, provider, receiver, 10, 15, false);
+		receiver.updated.clear();
+		receiver.values.clear();
+		AgentStatesSync<RawPackage>* sync = process->beginSynchronizeAgentStates<RawPackage>(provider);
+		try {
+			process->synchronizeAgentStates<RawPackage>(provider, receiver);
+			FAIL();
+		} catch (Repast_Error_63& e) {
+		}
+		process->finishSynchronizeAgentStates(sync, receiver);
+		ASSERT_EQ(round < 2 ? 10u : 15u, receiver.updated.size());
+		for (size_t i = 0; i < receiver.updated.size(); i++)
+			ASSERT_EQ(next * 100 + receiver.updated[i], receiver.values[i]);
+	}
+
+	// Fewer agents than before
+	receiver.updated.clear();
+	process->agentChanged(AgentId(3, world.rank(), 0));
+	process->synchronizeChangedAgentStates<RawPackage>(provider, receiver);
+	ASSERT_EQ(1u, receiver.updated.size());
+	ASSERT_EQ(3, receiver.updated[0]);
+
+	importNextAgents(context, provider, receiver, 0, 15, true);
+}
+
+BOOST_CLASS_EXPORT_GUID(repast::SpecializedProjectionInfoPacket<repast::RepastEdgeContent<ParallelAgent> >,
+		"SpecializedProjectionInfoPacket_PARALLEL_AGENT_EDGE");
+
+typedef SharedNetwork<ParallelAgent, RepastEdge<ParallelAgent>, RepastEdgeContent<ParallelAgent>,
+		RepastEdgeContentManager<ParallelAgent> > ParallelNetwork;
+
+// Provides, updates and creates agents that move with their edges
+struct MovingAgents {
+	SharedContext<ParallelAgent>* context;
+
+	MovingAgents(SharedContext<ParallelAgent>* c) : context(c) {
+	}
+
+	void provideContent(const AgentRequest& request, std::vector<SerializedPackage>& out) {
+		const std::vector<AgentId>& ids = request.requestedAgents();
+		for (size_t i = 0; i < ids.size(); i++) {
+			ParallelAgent* agent = context->getAgent(ids[i]);
+			SerializedPackage package;
+			package.id = agent->getId();
+			package.value = agent->value;
+			out.push_back(package);
+		}
+	}
+
+	void updateAgent(const SerializedPackage& package) {
+		context->getAgent(package.id)->value = package.value;
+	}
+
+	ParallelAgent* createAgent(const SerializedPackage& package) {
+		ParallelAgent* agent = new ParallelAgent(package.id);
+		agent->value = package.value;
+		return agent;
+	}
+};
+
+void countAllEdges(NetworkPartitioner<ParallelAgent, RepastEdge<ParallelAgent>, RepastEdgeContent<ParallelAgent>,
+		RepastEdgeContentManager<ParallelAgent> >& partitioner, int& edges, int& cutEdges) {
+	boost::mpi::communicator world;
+	int local[2];
+	partitioner.countEdges(local[0], local[1]);
+	int total[2];
+	boost::mpi::all_reduce(world, local, 2, total, std::plus<int>());
+	edges = total[0];
+	cutEdges = total[1];
+}
+
+TEST(NetworkPartitionerTest, Partition) {
+	boost::mpi::communicator world;
+	RepastProcess::init("./config.props");
+	RepastProcess* process = RepastProcess::instance();
+	int rank = world.rank();
+	int partner = ((rank ^ 1) < world.size() ? rank ^ 1 : -1);
+
+	SharedContext<ParallelAgent> context(&world);
+	RepastEdgeContentManager<ParallelAgent> edgeContentManager;
+	ParallelNetwork* net = new ParallelNetwork("network", false, &edgeContentManager);
+	context.addProjection(net);
+	for (int i = 0; i < 20; i++) {
+		ParallelAgent* agent = new ParallelAgent(AgentId(i, rank, 0));
+		agent->value = rank * 100 + i;
+		context.addAgent(agent);
+	}
+
+	// A chain on each process; agents 10 to 19 are also joined to all of the partner process's agents 10 to 19
+	MovingAgents agents(&context);
+	AgentRequest request(rank);
+	if (partner >= 0) for (int i = 10; i < 20; i++) request.addRequest(AgentId(i, partner, 0));
+	process->requestAgents<ParallelAgent, SerializedPackage, MovingAgents, MovingAgents, MovingAgents>(
+			context, request, agents, agents, agents);
+	for (int i = 0; i < 19; i++)
+		net->addEdge(context.getAgent(AgentId(i, rank, 0)), context.getAgent(AgentId(i + 1, rank, 0)));
+	if (partner >= 0) {
+		for (int i = 10; i < 20; i++)
+			for (int j = 10; j < 20; j++)
+				net->addEdge(context.getAgent(AgentId(i, rank, 0)), context.getAgent(AgentId(j, partner, 0)));
+	}
+
+	NetworkPartitioner<ParallelAgent, RepastEdge<ParallelAgent>, RepastEdgeContent<ParallelAgent>,
+			RepastEdgeContentManager<ParallelAgent> > partitioner(net);
+	int edges, cutEdges;
+	countAllEdges(partitioner, edges, cutEdges);
+	int paired = world.size() - world.size() % 2;
+	ASSERT_EQ(38 * world.size() + 100 * paired, edges);
+	ASSERT_EQ(100 * paired, cutEdges);
+
+	int marked = partitioner.partition(10, 0.5);
+	process->synchronizeAgentStatus<ParallelAgent, SerializedPackage, MovingAgents, MovingAgents, MovingAgents>(
+			context, agents, agents, agents);
+	int localCount = 0;
+	for (SharedContext<ParallelAgent>::const_local_iterator iter = context.localBegin(); iter != context.localEnd(); ++iter)
+		localCount++;
+	int totalCount;
+	boost::mpi::all_reduce(world, localCount, totalCount, std::plus<int>());
+	ASSERT_EQ(20 * world.size(), totalCount);
+
+	// Every edge is kept, and fewer of them cross processes
+	int edgesAfter, cutEdgesAfter;
+	countAllEdges(partitioner, edgesAfter, cutEdgesAfter);
+	ASSERT_EQ(edges, edgesAfter);
+	ASSERT_LE(cutEdgesAfter, cutEdges);
+	if (paired > 0) {
+		ASSERT_GT(marked, 0);
+		ASSERT_LT(cutEdgesAfter, cutEdges);
+	} else {
+		ASSERT_EQ(0, marked);
+	}
+
+	AgentRequest cancellations(rank);
+	for (SharedContext<ParallelAgent>::const_iterator iter = context.begin(); iter != context.end(); ++iter)
+		if ((*iter)->getId().currentRank() != rank) cancellations.addCancellation((*iter)->getId());
+	process->requestAgents<ParallelAgent, SerializedPackage, MovingAgents, MovingAgents, MovingAgents>(
+			context, cancellations, agents, agents, agents);
+}
+
+// Each local agent must be inside the local bounds, at the location it was put at
+void checkRebalancedAgents(SharedContext<ParallelAgent>& context, SharedDiscreteSpace<ParallelAgent, StrictBorders,
+		SimpleAdder<ParallelAgent> >* grid, int expectedTotal) {
+	boost::mpi::communicator world;
+	int localCount = 0;
+	std::vector<int> location;
+	for (SharedContext<ParallelAgent>::const_local_iterator iter = context.localBegin(); iter != context.localEnd(); ++iter) {
+		const AgentId& id = (*iter)->getId();
+		location.clear();
+		ASSERT_TRUE(grid->getLocation(id, location));
+		ASSERT_EQ(8 * id.startingRank() + id.id(), location[0]);
+		ASSERT_EQ(id.id() % 4, location[1]);
+		ASSERT_TRUE(grid->dimensions().contains(location));
+		ASSERT_EQ(id.startingRank() * 100 + id.id(), (*iter)->value);
+		localCount++;
+	}
+	int totalCount;
+	boost::mpi::all_reduce(world, localCount, totalCount, std::plus<int>());
+	ASSERT_EQ(expectedTotal, totalCount);
+}
+
+TEST(SharedGridTest, Rebalance) {
+	boost::mpi::communicator world;
+	RepastProcess::init("./config.props");
+	RepastProcess* process = RepastProcess::instance();
+	int n = world.size();
+	int rank = world.rank();
+
+	SharedContext<ParallelAgent> context(&world);
+	std::vector<int> procs(1, n);
+	procs.push_back(1);
+	SharedDiscreteSpace<ParallelAgent, StrictBorders, SimpleAdder<ParallelAgent> >* grid =
+			new SharedDiscreteSpace<ParallelAgent, StrictBorders, SimpleAdder<ParallelAgent> >("grid",
+					GridDimensions(Point<double>(0, 0), Point<double>(8 * n, 4)), procs, 1, &world);
+	context.addProjection(grid);
+
+	// One agent in each column of the slab, so that some lie next to every cut
+	for (int i = 0; i < 8; i++) {
+		ParallelAgent* agent = new ParallelAgent(AgentId(i, rank, 0));
+		agent->value = rank * 100 + i;
+		context.addAgent(agent);
+		grid->moveTo(agent->getId(), Point<int>(8 * rank + i, i % 4));
+	}
+
+	// More load on the first process moves its cut left; the agents beyond it move to the next process
+	MovingAgents agents(&context);
+	ASSERT_EQ(n > 1, grid->rebalance(rank == 0 ? 4 : 1, 0));
+	process->synchronizeAgentStatus<ParallelAgent, SerializedPackage, MovingAgents, MovingAgents, MovingAgents>(
+			context, agents, agents, agents);
+	process->synchronizeProjectionInfo<ParallelAgent, SerializedPackage, MovingAgents, MovingAgents, MovingAgents>(
+			context, agents, agents, agents);
+	if (n > 1 && rank == 0) {
+		ASSERT_LT(grid->dimensions().extents(0), 8);
+	}
+	checkRebalancedAgents(context, grid, 8 * n);
+
+	// Loads in proportion to the slab widths restore the even division for later tests
+	grid->rebalance(grid->dimensions().extents(0), 0);
+	process->synchronizeAgentStatus<ParallelAgent, SerializedPackage, MovingAgents, MovingAgents, MovingAgents>(
+			context, agents, agents, agents);
+	process->synchronizeProjectionInfo<ParallelAgent, SerializedPackage, MovingAgents, MovingAgents, MovingAgents>(
+			context, agents, agents, agents);
+	ASSERT_EQ(8, grid->dimensions().extents(0));
+	checkRebalancedAgents(context, grid, 8 * n);
+}
@@ -41,11 +41,18 @@
 
 #include "repast_hpc/GridComponents.h"
 #include "repast_hpc/MultipleOccupancy.h"
+#include "repast_hpc/DenseOccupancy.h"
+#include "repast_hpc/CellListOccupancy.h"
 #include "repast_hpc/SingleOccupancy.h"
+#include "repast_hpc/SpaceFillingCurve.h"
+#include "repast_hpc/CartesianTopology.h"
+#include "repast_hpc/RepastErrors.h"
+#include "repast_hpc/RepastProcess.h"
 #include "test.h"
 
 #include <gtest/gtest.h>
 #include <boost/unordered_set.hpp>
+#include <cmath>
 
 using namespace repast;
 using namespace std;
@@ -271,3 +278,304 @@ TEST(MultipleOccupancy, All)
 	mo.put(agents[2], pt);
 	ASSERT_EQ(agents[2].get(), mo.get(pt));
 }
+
+TEST(DenseOccupancy, All)
+{
+	DenseOccupancy<TestAgent, int> dense;
+	dense.init(GridDimensions(Point<double>(-2, 0), Point<double>(5, 4)));
+
+	vector<boost::shared_ptr<TestAgent> > agents;
+	for (int i = 0; i < 10; i++) {
+		agents.push_back(boost::shared_ptr<TestAgent>(new TestAgent(i, 0, 0)));
+	}
+
+	Point<int> pt(-2, 3);
+	ASSERT_EQ(NULL, dense.get(pt));
+	ASSERT_TRUE(dense.put(agents[0], pt));
+	ASSERT_TRUE(dense.put(agents[1], pt));
+	ASSERT_TRUE(dense.put(agents[1], pt));
+	ASSERT_EQ(agents[0].get(), dense.get(pt));
+
+	vector<TestAgent*> vec;
+	dense.getAll(pt, vec);
+	ASSERT_EQ(2, vec.size());
+	ASSERT_EQ(agents[1].get(), vec[1]);
+
+	dense.remove(agents[0], pt);
+	ASSERT_EQ(agents[1].get(), dense.get(pt));
+
+	// outside the dense region
+	Point<int> outside(10, 10);
+	dense.put(agents[2], outside);
+	dense.put(agents[3], outside);
+	vec.clear();
+	dense.getAll(outside, vec);
+	ASSERT_EQ(2, vec.size());
+	dense.remove(agents[2], outside);
+	ASSERT_EQ(agents[3].get(), dense.get(outside));
+
+	// the freed slot is reused and the neighboring cells are unaffected
+	Point<int> next(-1, 3);
+	dense.put(agents[4], next);
+	ASSERT_EQ(agents[4].get(), dense.get(next));
+	ASSERT_EQ(agents[1].get(), dense.get(pt));
+
+	// changing the region keeps what has been put
+	dense.init(GridDimensions(Point<double>(5, 5), Point<double>(10, 10)));
+	ASSERT_EQ(agents[1].get(), dense.get(pt));
+	ASSERT_EQ(agents[4].get(), dense.get(next));
+	ASSERT_EQ(agents[3].get(), dense.get(outside));
+	dense.remove(agents[3], outside);
+	ASSERT_EQ(NULL, dense.get(outside));
+}
+
+TEST(DenseOccupancy, SparseRegion)
+{
+	DenseOccupancy<TestAgent, int> dense;
+	GridDimensions bounds(Point<double>(0, 0), Point<double>(8, 8));
+	boost::shared_ptr<TestAgent> agent(new TestAgent(0, 0, 0));
+	initCellAccessor(dense, bounds, 1);
+	dense.put(agent, Point<int>(3, 3));
+
+	// A region mostly owned by other processes is held in the map; what was put is kept
+	initCellAccessor(dense, bounds, 0.1);
+	ASSERT_EQ(agent.get(), dense.get(Point<int>(3, 3)));
+	dense.put(agent, Point<int>(4, 4));
+	vector<TestAgent*> vec;
+	dense.getAll(Point<int>(4, 4), vec);
+	ASSERT_EQ(1, vec.size());
+	dense.remove(agent, Point<int>(3, 3));
+	ASSERT_EQ(NULL, dense.get(Point<int>(3, 3)));
+	ASSERT_EQ(agent.get(), dense.get(Point<int>(4, 4)));
+}
+
+TEST(SpaceFillingCurve, Blocks)
+{
+	repast::RepastProcess::init("./config.props");
+	// Each process gets a curve of its own, so it owns every block however many processes run
+	boost::mpi::communicator world;
+	boost::mpi::communicator self = world.split(world.rank());
+	GridDimensions dims(Point<double>(0, 0), Point<double>(16, 16));
+	SpaceFillingCurve curve(dims, 2, SpaceFillingCurve::HILBERT, false, &self);
+	ASSERT_EQ(16, curve.blockCount());
+
+	vector<double> pt;
+	pt.push_back(5);
+	pt.push_back(9);
+	ASSERT_EQ(9, curve.blockOf(pt));
+	ASSERT_EQ(0, curve.rankOf(pt));
+	GridDimensions block = curve.getBlockBounds(9);
+	ASSERT_EQ(4, block.origin(0));
+	ASSERT_EQ(8, block.origin(1));
+	ASSERT_EQ(4, block.extents(0));
+	ASSERT_EQ(4, block.extents(1));
+
+	GridDimensions bounds = curve.getBounds(0);
+	ASSERT_EQ(0, bounds.origin(0));
+	ASSERT_EQ(16, bounds.extents(1));
+	ASSERT_EQ(16, curve.ownedBlockCount(0));
+	ASSERT_EQ(0, curve.ownedBlockCount(1));
+
+	std::set<int> ranks;
+	curve.getRanksNear(pt, 2, ranks);
+	ASSERT_EQ(1, ranks.size());
+	ranks.clear();
+	curve.getNeighborRanks(0, 2, ranks);
+	ASSERT_EQ(0, ranks.size());
+
+	vector<double> loads(16, 0);
+	loads[3] = 10;
+	ASSERT_FALSE(curve.partition(loads));
+
+	try {
+		SpaceFillingCurve tooFine(dims, 13, SpaceFillingCurve::MORTON, false, &self);
+		FAIL();
+	} catch (Repast_Error_58&) {
+	}
+}
+
+TEST(CartesianTopology, PlaceCuts)
+{
+	// Load concentrated in the first slab: the cuts move into it
+	double loads[] = { 30, 10, 0, 0 };
+	double old[] = { 0, 25, 50, 75, 100 };
+	vector<double> slabLoads(loads, loads + 4), oldPositions(old, old + 5), positions;
+	CartesianTopology::placeCuts(slabLoads, oldPositions, 100, 2, true, positions);
+	double expected[] = { 0, 8, 17, 25, 100 };
+	for (int i = 0; i < 5; i++)
+		ASSERT_EQ(expected[i], positions[i]);
+
+	// Slabs are kept at least the minimum width
+	slabLoads[0] = 100;
+	slabLoads[1] = 0;
+	oldPositions[1] = 1;
+	CartesianTopology::placeCuts(slabLoads, oldPositions, 100, 2, true, positions);
+	ASSERT_EQ(2, positions[1]);
+	ASSERT_EQ(4, positions[2]);
+	ASSERT_EQ(6, positions[3]);
+
+	// Continuous spaces are cut anywhere, so a narrow extent still gives every slab a share
+	double narrow[] = { 0, 0.5, 1, 1.5, 2 };
+	vector<double> narrowPositions(narrow, narrow + 5);
+	CartesianTopology::placeCuts(slabLoads, narrowPositions, 2, 1, false, positions);
+	for (int i = 0; i < 4; i++)
+		ASSERT_DOUBLE_EQ(0.5, positions[i + 1] - positions[i]);
+	slabLoads.assign(4, 1);
+	slabLoads[0] = 5;
+	CartesianTopology::placeCuts(slabLoads, narrowPositions, 2, 0.1, false, positions);
+	ASSERT_DOUBLE_EQ(0.2, positions[1]);
+	ASSERT_DOUBLE_EQ(0.4, positions[2]);
+	CartesianTopology::placeCuts(slabLoads, narrowPositions, 2, 0, true, positions);
+	ASSERT_EQ(0, positions[1]); // Rounded to whole units
+}
+
+TEST(CartesianTopology, Rebalance)
+{
+	boost::mpi::communicator world;
+	int n = world.size();
+	vector<int> procs(1, n);
+	procs.push_back(1);
+	GridDimensions dims(Point<double>(-3, 0), Point<double>(10 * n, 1));
+	CartesianTopology topology(procs, false, &world);
+	ASSERT_EQ(n > 1, topology.rebalance(world.rank() == 0 ? 5 : 1, dims, 2));
+
+	// The slabs tile the space on whole units, and each point is found on its own slab
+	double lower = -3;
+	for (int r = 0; r < n; r++) {
+		GridDimensions bounds = topology.getDimensions(r, dims);
+		ASSERT_EQ(lower, bounds.origin(0));
+		ASSERT_GE(bounds.extents(0), 2);
+		ASSERT_EQ(floor(bounds.extents(0)), bounds.extents(0));
+		for (double x = bounds.origin(0); x < bounds.origin(0) + bounds.extents(0); x += 0.5) {
+			vector<double> pt(1, x);
+			pt.push_back(0.5);
+			ASSERT_EQ(r, topology.getRankContaining(pt, dims));
+		}
+		lower += bounds.extents(0);
+	}
+	ASSERT_EQ(-3 + 10 * n, lower);
+	if (n > 1) {
+		ASSERT_LT(topology.getDimensions(0, dims).extents(0), 10);
+	}
+
+	// A continuous space narrower than the number of processes
+	GridDimensions narrow(Point<double>(0, 0), Point<double>(0.5 * n, 1));
+	CartesianTopology continuous(procs, false, &world);
+	ASSERT_EQ(n > 1, continuous.rebalance(world.rank() == 0 ? 5 : 1, narrow, 0.1, 0, false));
+	for (int r = 0; r < n; r++)
+		ASSERT_GT(continuous.getDimensions(r, narrow).extents(0), 0);
+}
+
+TEST(CellListOccupancy, Queries)
+{
+	GridDimensions global(Point<double>(0, 0), Point<double>(100, 50));
+	vector<boost::shared_ptr<TestAgent> > agents;
+	vector<Point<double> > locations;
+	unsigned int state = 17;
+	for (int i = 0; i < 400; i++) {
+		agents.push_back(boost::shared_ptr<TestAgent>(new TestAgent(i, 0, 0)));
+		state = state * 1103515245 + 12345;
+		double x = (state >> 8) % 10000 / 100.0;
+		state = state * 1103515245 + 12345;
+		double y = (state >> 8) % 5000 / 100.0;
+		locations.push_back(Point<double>(x, y));
+	}
+
+	for (int periodic = 0; periodic < 2; periodic++) {
+		CellListOccupancy<TestAgent, double> cellList;
+		cellList.init(GridDimensions(Point<double>(20, 10), Point<double>(40, 30)));
+		cellList.setTopology(global, periodic == 1, 4);
+		for (size_t i = 0; i < agents.size(); i++) {
+			ASSERT_TRUE(cellList.put(agents[i], locations[i]));
+		}
+		// move some agents, as a grid does: put at the new location, then remove from the old
+		for (size_t i = 0; i < agents.size(); i += 7) {
+			Point<double> moved(99.5 - locations[i].getX(), locations[i].getY());
+			cellList.put(agents[i], moved);
+			cellList.remove(agents[i], locations[i]);
+			locations[i] = moved;
+		}
+		ASSERT_EQ(agents[1].get(), cellList.get(locations[1]));
+
+		Point<double> centers[] = { Point<double>(30, 20), Point<double>(1, 48), Point<double>(70, 5) };
+		for (int c = 0; c < 3; c++) {
+			for (double radius = 2; radius < 60; radius *= 3) {
+				std::set<TestAgent*> expected;
+				vector<std::pair<double, TestAgent*> > byDistance;
+				for (size_t i = 0; i < agents.size(); i++) {
+					double dx = fabs(locations[i].getX() - centers[c].getX());
+					double dy = fabs(locations[i].getY() - centers[c].getY());
+					if (periodic == 1 && dx > 50) dx = 100 - dx;
+					if (periodic == 1 && dy > 25) dy = 50 - dy;
+					if (dx * dx + dy * dy <= radius * radius) expected.insert(agents[i].get());
+					byDistance.push_back(std::make_pair(dx * dx + dy * dy, agents[i].get()));
+				}
+				vector<TestAgent*> found;
+				cellList.getWithin(centers[c], radius, found);
+				ASSERT_EQ(expected.size(), found.size());
+				ASSERT_TRUE(expected == std::set<TestAgent*>(found.begin(), found.end()));
+
+				std::sort(byDistance.begin(), byDistance.end(), NearerAgent<TestAgent>());
+				size_t count = (size_t) radius;
+				found.clear();
+				cellList.getNearest(centers[c], count, found);
+				ASSERT_EQ(count, found.size());
+				for (size_t i = 0; i < count; i++) {
+					ASSERT_EQ(byDistance[i].second, found[i]);
+				}
+			}
+		}
+
+		// changing the region keeps the agents
+		cellList.init(GridDimensions(Point<double>(0, 0), Point<double>(30, 30)));
+		vector<TestAgent*> all;
+		cellList.getWithin(Point<double>(50, 25), 200, all);
+		ASSERT_EQ(agents.size(), all.size());
+		all.clear();
+		cellList.getNearest(Point<double>(50, 25), 1000, all);
+		ASSERT_EQ(agents.size(), all.size());
+	}
+}
+
+TEST(CellListOccupancy, PeriodicImages)
+{
+	GridDimensions global(Point<double>(0, 0), Point<double>(10, 10));
+	boost::shared_ptr<TestAgent> agent(new TestAgent(0, 0, 0));
+	boost::shared_ptr<TestAgent> wrapped(new TestAgent(1, 0, 0));
+
+	// A single process: the region is the whole space
+	CellListOccupancy<TestAgent, double> cellList;
+	cellList.init(global);
+	cellList.setTopology(global, true, 5);
+	cellList.put(agent, Point<double>(6.9, 1));
+	vector<TestAgent*> found;
+	cellList.getWithin(Point<double>(2.5, 1), 4.5, found);
+	ASSERT_EQ(1u, found.size());
+	found.clear();
+	cellList.getWithin(Point<double>(9.5, 1), 3, found);
+	ASSERT_EQ(1u, found.size());
+	found.clear();
+	cellList.getWithin(Point<double>(1, 1), 4, found);
+	ASSERT_EQ(0u, found.size());
+
+	// A region with a buffer zone that wraps around: the copy from across the border is found once
+	cellList.init(GridDimensions(Point<double>(-2, 0), Point<double>(9, 10)));
+	cellList.put(wrapped, Point<double>(9, 5));
+	found.clear();
+	cellList.getWithin(Point<double>(0.5, 5), 2, found);
+	ASSERT_EQ(1u, found.size());
+	ASSERT_EQ(wrapped.get(), found[0]);
+	found.clear();
+	cellList.getWithin(Point<double>(2.5, 1), 4.5, found);
+	ASSERT_EQ(1u, found.size());
+	ASSERT_EQ(agent.get(), found[0]);
+	found.clear();
+	cellList.getNearest(Point<double>(0.5, 5), 2, found);
+	ASSERT_EQ(2u, found.size());
+	ASSERT_EQ(wrapped.get(), found[0]);
+
+	cellList.remove(wrapped, Point<double>(9, 5));
+	found.clear();
+	cellList.getWithin(Point<double>(0.5, 5), 2, found);
+	ASSERT_EQ(0u, found.size());
+}
@@ -35,6 +35,7 @@
 #include <gtest/gtest.h>
 
 #include "repast_hpc/Random.h"
+#include "repast_hpc/RandomStream.h"
 #include "repast_hpc/Properties.h"
 #include "repast_hpc/initialize_random.h"
 
@@ -150,3 +151,64 @@ TEST(Random, DistFromProps)
 	val = nGen->next();
 
 }
+
+TEST(RandomStream, Philox)
+{
+	// Known answers from the Random123 distribution
+	boost::uint32_t ctr[4] = { 0, 0, 0, 0 };
+	boost::uint32_t key[2] = { 0, 0 };
+	Philox4x32::encrypt(ctr, key);
+	ASSERT_EQ(0x6627e8d5u, ctr[0]);
+	ASSERT_EQ(0xe169c58du, ctr[1]);
+	ASSERT_EQ(0xbc57ac4cu, ctr[2]);
+	ASSERT_EQ(0x9b00dbd8u, ctr[3]);
+
+	boost::uint32_t ctr2[4] = { 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u };
+	boost::uint32_t key2[2] = { 0xa4093822u, 0x299f31d0u };
+	Philox4x32::encrypt(ctr2, key2);
+	ASSERT_EQ(0xd16cfe09u, ctr2[0]);
+	ASSERT_EQ(0x94fdccebu, ctr2[1]);
+	ASSERT_EQ(0x5001e420u, ctr2[2]);
+	ASSERT_EQ(0x24126ea1u, ctr2[3]);
+
+	Philox4x32 engine(1, 2, 3, 4, 5);
+	std::vector<boost::uint32_t> draws;
+	for (int i = 0; i < 11; i++)
+		draws.push_back(engine());
+	for (int skip = 0; skip < 10; skip++) {
+		Philox4x32 other(1, 2, 3, 4, 5);
+		other();
+		other.discard(skip);
+		ASSERT_EQ(draws[skip + 1], other());
+	}
+}
+
+TEST(RandomStream, Reproducible)
+{
+	AgentId id(10, 2, 1);
+	RandomStream stream(42, id, 3, 7);
+	double first = stream.nextDouble();
+	ASSERT_TRUE(first >= 0 && first < 1);
+
+	// The current rank is not part of the stream
+	AgentId moved(10, 2, 1, 5);
+	RandomStream same(42, moved, 3, 7);
+	ASSERT_EQ(first, same.nextDouble());
+
+	ASSERT_NE(first, RandomStream(42, id, 4, 7).nextDouble());
+	ASSERT_NE(first, RandomStream(42, id, 3, 8).nextDouble());
+	ASSERT_NE(first, RandomStream(43, id, 3, 7).nextDouble());
+	ASSERT_NE(first, RandomStream(42, AgentId(11, 2, 1), 3, 7).nextDouble());
+	ASSERT_NE(first, RandomStream(42, AgentId(10, 2, 0), 3, 7).nextDouble());
+
+	StreamIntUniformGenerator iGen = stream.createUniIntGenerator(20, 40);
+	for (int i = 0; i < 1000; i++) {
+		double val = iGen.next();
+		ASSERT_TRUE(val >= 20 && val <= 40);
+	}
+	StreamNormalGenerator nGen = stream.createNormalGenerator(0, 1);
+	double sum = 0;
+	for (int i = 0; i < 10000; i++)
+		sum += nGen.next();
+	ASSERT_NEAR(0, sum / 10000, 0.05);
+}
@@ -40,7 +40,17 @@
  */
 
 #include "repast_hpc/Schedule.h"
+#include "repast_hpc/ThreadPool.h"
+#include "repast_hpc/Profiler.h"
 #include <gtest/gtest.h>
+#include <boost/mpi.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
 
 using namespace repast;
 
@@ -127,5 +137,245 @@ TEST_F(ScheduleTest, Mix) {
 	ASSERT_EQ(4.0, agent.y);
 }
 
+class TickRecorder {
+
+public:
+	ScheduleRunner* runner;
+	std::vector<double> ticks;
+
+	TickRecorder(ScheduleRunner* r) : runner(r) {}
+
+	void Record() {
+		ticks.push_back(runner->currentTick());
+	}
+};
+
+TEST_F(ScheduleTest, MinimumRepeatingInterval) {
+	TestAgent tf;
+	ASSERT_EQ(0.0, s1.getMinimumRepeatingInterval());
+	s1.schedule_event(1, Schedule::FunctorPtr(new repast::MethodFunctor<TestAgent>(&tf, &TestAgent::OneTime)));
+	ASSERT_EQ(0.0, s1.getMinimumRepeatingInterval());
+	s1.schedule_event(1, 4, Schedule::FunctorPtr(new repast::MethodFunctor<TestAgent>(&tf, &TestAgent::Repeat)));
+	s1.schedule_event(1, 2, Schedule::FunctorPtr(new repast::MethodFunctor<TestAgent>(&tf, &TestAgent::Repeat)));
+	s1.schedule_event(1, 3, Schedule::FunctorPtr(new repast::MethodFunctor<TestAgent>(&tf, &TestAgent::Repeat)));
+	ASSERT_EQ(2.0, s1.getMinimumRepeatingInterval());
+}
+
+TEST(ScheduleRunnerTest, SynchronizationWindow) {
+	boost::mpi::communicator world;
+	ScheduleRunner runner(&world);
+	TickRecorder recorder(&runner);
+
+	runner.scheduleEvent(1, 1, Schedule::FunctorPtr(new repast::MethodFunctor<TickRecorder>(&recorder, &TickRecorder::Record)));
+	runner.scheduleEvent(1.5, Schedule::FunctorPtr(new repast::MethodFunctor<TickRecorder>(&recorder, &TickRecorder::Record)));
+	runner.scheduleEvent(2.25, Schedule::FunctorPtr(new repast::MethodFunctor<TickRecorder>(&recorder, &TickRecorder::Record)));
+	runner.scheduleEvent(2.75, Schedule::FunctorPtr(new repast::MethodFunctor<TickRecorder>(&recorder, &TickRecorder::Record)));
+	runner.scheduleStop(4);
+	runner.deriveSynchronizationInterval();
+	runner.run();
+
+	ASSERT_EQ(1.0, runner.getSynchronizationInterval());
+	double expected[] = {1, 1.5, 2, 2.25, 2.75, 3, 4};
+	ASSERT_EQ(7, recorder.ticks.size());
+	for (size_t i = 0; i < recorder.ticks.size(); i++) {
+		ASSERT_EQ(expected[i], recorder.ticks[i]);
+	}
+}
+
+class Recorder {
+
+public:
+	Schedule* schedule;
+	std::vector<std::pair<double, int> >* record;
+	int id;
+
+	Recorder(Schedule* s, std::vector<std::pair<double, int> >* r, int i) : schedule(s), record(r), id(i) {}
+
+	void Record() {
+		record->push_back(std::make_pair(schedule->getCurrentTick(), id));
+	}
+};
+
+TEST(CalendarQueueScheduleTest, Repeat) {
+	CalendarQueueSchedule s;
+	TestAgent tf;
+	s.schedule_event(1, 2, Schedule::FunctorPtr(new repast::MethodFunctor<TestAgent>(&tf, &TestAgent::Repeat)));
+	s.execute();
+	ASSERT_EQ(1, tf._result);
+	ASSERT_EQ(3.0, s.getNextTick());
+
+	int expected = 1;
+	for (int i = 1; i < 5; i++) {
+		s.execute();
+		ASSERT_EQ(++expected, tf._result);
+		ASSERT_EQ(3.0 + (i * 2), s.getNextTick());
+	}
+	ASSERT_EQ(2.0, s.getMinimumRepeatingInterval());
+}
+
+TEST(CalendarQueueScheduleTest, Ordering) {
+	CalendarQueueSchedule s;
+	std::vector<std::pair<double, int> > record;
+	std::vector<Recorder*> recorders;
+
+	// Enough events to force the bucket array to grow and shrink, with many
+	// sharing ticks so the same-tick ordering is exercised.
+	std::vector<std::pair<double, int> > expected;
+	for (int i = 0; i < 2000; i++) {
+		double tick = ((i * 7919) % 500) * 0.5;
+		Recorder* r = new Recorder(&s, &record, i);
+		recorders.push_back(r);
+		s.schedule_event(tick, Schedule::FunctorPtr(new repast::MethodFunctor<Recorder>(r, &Recorder::Record)));
+		expected.push_back(std::make_pair(tick, i));
+	}
+	std::stable_sort(expected.begin(), expected.end());
+
+	while (s.getNextTick() != -1)
+		s.execute();
+
+	ASSERT_EQ(expected.size(), record.size());
+	for (size_t i = 0; i < expected.size(); i++) {
+		ASSERT_EQ(expected[i].first, record[i].first);
+		ASSERT_EQ(expected[i].second, record[i].second);
+	}
+	for (size_t i = 0; i < recorders.size(); i++)
+		delete recorders[i];
+}
+
+TEST(CalendarQueueScheduleTest, RunnerBackend) {
+	boost::mpi::communicator world;
+	ScheduleRunner runner(&world, ScheduleRunner::CALENDAR_QUEUE);
+	TickRecorder recorder(&runner);
+	runner.scheduleEvent(5, Schedule::FunctorPtr(new repast::MethodFunctor<TickRecorder>(&recorder, &TickRecorder::Record)));
+	runner.scheduleEvent(1, 1.5, Schedule::FunctorPtr(new repast::MethodFunctor<TickRecorder>(&recorder, &TickRecorder::Record)));
+	runner.scheduleStop(5.5);
+	runner.run();
+
+	double expected[] = {1, 2.5, 4, 5, 5.5};
+	ASSERT_EQ(5, recorder.ticks.size());
+	for (size_t i = 0; i < recorder.ticks.size(); i++)
+		ASSERT_EQ(expected[i], recorder.ticks[i]);
+}
+
+class Counter {
+
+public:
+	std::atomic<int>* count;
+	int* seen;
+
+	Counter(std::atomic<int>* c, int* s) : count(c), seen(s) {}
+
+	void Increment() {
+		(*count)++;
+	}
 
+	void Check() {
+		*seen = *count;
+	}
+};
 
+TEST(ThreadPoolTest, Run) {
+	ThreadPool pool(4);
+	ASSERT_EQ(4, pool.size());
+	std::atomic<int> count(0);
+	int seen = 0;
+	Counter counter(&count, &seen);
+	std::vector<Functor*> tasks;
+	for (int i = 0; i < 1000; i++)
+		tasks.push_back(new repast::MethodFunctor<Counter>(&counter, &Counter::Increment));
+	pool.run(tasks);
+	ASSERT_EQ(1000, count);
+	pool.run(tasks);
+	ASSERT_EQ(2000, count);
+	for (size_t i = 0; i < tasks.size(); i++)
+		delete tasks[i];
+}
+
+class NestedRun: public Functor {
+
+public:
+	ThreadPool* pool;
+	std::vector<Functor*>* inner;
+
+	NestedRun(ThreadPool* p, std::vector<Functor*>* i) : pool(p), inner(i) {}
+
+	void operator()() {
+		pool->run(*inner);
+	}
+};
+
+TEST(ThreadPoolTest, NestedRun) {
+	ThreadPool pool(4);
+	std::atomic<int> count(0);
+	int seen = 0;
+	Counter counter(&count, &seen);
+	std::vector<Functor*> inner;
+	for (int i = 0; i < 10; i++)
+		inner.push_back(new repast::MethodFunctor<Counter>(&counter, &Counter::Increment));
+	std::vector<Functor*> outer;
+	for (int i = 0; i < 20; i++)
+		outer.push_back(new NestedRun(&pool, &inner));
+	for (int rep = 1; rep <= 50; rep++) {
+		pool.run(outer);
+		ASSERT_EQ(rep * 200, count);
+	}
+	for (size_t i = 0; i < inner.size(); i++)
+		delete inner[i];
+	for (size_t i = 0; i < outer.size(); i++)
+		delete outer[i];
+}
+
+TEST(CalendarQueueScheduleTest, ParallelEvents) {
+	ThreadPool pool(4);
+	CalendarQueueSchedule s;
+	s.setThreadPool(&pool);
+	std::atomic<int> count(0);
+	int seen = -1;
+	Counter counter(&count, &seen);
+
+	// The serial event splits the parallel events at tick 1 into two groups
+	Schedule::FunctorPtr inc(new repast::MethodFunctor<Counter>(&counter, &Counter::Increment));
+	for (int i = 0; i < 50; i++)
+		s.schedule_event(1, 1, inc)->get_event()->parallelSafe = true;
+	s.schedule_event(1, Schedule::FunctorPtr(new repast::MethodFunctor<Counter>(&counter, &Counter::Check)));
+	for (int i = 0; i < 50; i++)
+		s.schedule_event(1, inc)->get_event()->parallelSafe = true;
+
+	s.execute();
+	ASSERT_EQ(50, seen);
+	ASSERT_EQ(100, count);
+	ASSERT_EQ(2.0, s.getNextTick());
+	s.execute();
+	ASSERT_EQ(150, count);
+}
+
+TEST(ProfilerTest, Trace) {
+	boost::mpi::communicator world;
+	Profiler* profiler = Profiler::enable(&world);
+	ASSERT_EQ(profiler, Profiler::instance());
+
+	ScheduleRunner runner(&world);
+	TickRecorder recorder(&runner);
+	Schedule::FunctorPtr record(new repast::MethodFunctor<TickRecorder>(&recorder, &TickRecorder::Record));
+	profiler->setName(record.get(), "record");
+	runner.scheduleEvent(1, 1, record);
+	runner.scheduleStop(3);
+	runner.run();
+
+	std::string file = "profiler_test_" + boost::lexical_cast<std::string>(world.rank()) + ".json";
+	profiler->write(file);
+	Profiler::disable();
+	ASSERT_TRUE(Profiler::instance() == 0);
+
+	std::ifstream in(file.c_str());
+	std::stringstream trace;
+	trace << in.rdbuf();
+	in.close();
+	std::remove(file.c_str());
+
+	std::string json = trace.str();
+	ASSERT_EQ(0u, json.find("{\"traceEvents\":["));
+	ASSERT_NE(std::string::npos, json.find("\"name\":\"record\",\"cat\":\"functor\""));
+	ASSERT_NE(std::string::npos, json.find("\"name\":\"nextTickAllReduce\""));
+	ASSERT_NE(std::string::npos, json.find("\"args\":{\"tick\":3}"));
+}
@@ -42,11 +42,16 @@
 #include "repast_hpc/matrix.h"
 #include "repast_hpc/ValueLayer.h"
 #include "repast_hpc/GridComponents.h"
+#include "repast_hpc/DiffusionLayerND.h"
+#include "repast_hpc/RepastProcess.h"
 #include "test.h"
 
 #include <gtest/gtest.h>
 #include <boost/unordered_set.hpp>
 #include <stdlib.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 
 using namespace repast;
 using namespace std;
@@ -486,3 +491,328 @@ TEST(ValueLayer, ContinuousNonZeroOrigin)
 	testCopy(vl, other2);
 }
 
+// Processes are split over the first two dimensions where there are two,
+// so that the shell sent during an overlapped exchange includes corners
+template<int N, int R>
+void compareStencil(const StencilDiffusor<double, N, R>& stencil, bool periodic) {
+	int n = repast::RepastProcess::instance()->worldSize();
+	vector<int> procs(N, 1);
+	procs[0] = n;
+	if (N > 1 && n % 2 == 0) {
+		procs[0] = n / 2;
+		procs[1] = 2;
+	}
+	vector<double> origin(N, 0), extents(N, 12);
+	extents[0] = 17;
+	int cells = 1;
+	for (int d = 0; d < N; d++) {
+		extents[d] *= procs[d];
+		cells *= (int) extents[d];
+	}
+	GridDimensions dims((Point<double>(origin)), (Point<double>(extents)));
+	DiffusionLayerND<double> fast(procs, dims, R, periodic, 0, 1.5);
+	DiffusionLayerND<double> slow(procs, dims, R, periodic, 0, 1.5);
+	DiffusionLayerND<double> overlapped(procs, dims, R, periodic, 0, 1.5);
+
+	vector<int> location(N, 0);
+	bool err;
+	for (int i = 0; i < cells; i++) {
+		int rest = i;
+		for (int d = 0; d < N; d++) {
+			location[d] = rest % (int) extents[d];
+			rest /= (int) extents[d];
+		}
+		if (!fast.isInLocalBounds(location)) continue;
+		double value = (i * 7919) % 101;
+		fast.setValueAt(value, location, err);
+		slow.setValueAt(value, location, err);
+		overlapped.setValueAt(value, location, err);
+	}
+	fast.synchronize();
+	slow.synchronize();
+	overlapped.synchronize();
+
+	StencilDiffusor<double, N, R> copy(stencil);
+	for (int step = 0; step < 3; step++) {
+		fast.diffuse(stencil);
+		slow.diffuse(&copy);
+		if (step % 2 == 0) overlapped.diffuseAndSynchronize(stencil);
+		else overlapped.diffuseAndSynchronize(&copy);
+	}
+	for (int i = 0; i < cells; i++) {
+		int rest = i;
+		for (int d = 0; d < N; d++) {
+			location[d] = rest % (int) extents[d];
+			rest /= (int) extents[d];
+		}
+		if (!fast.isInLocalBounds(location)) continue;
+		ASSERT_NEAR(slow.getValueAt(location, err), fast.getValueAt(location, err), 1e-9);
+		ASSERT_NEAR(slow.getValueAt(location, err), overlapped.getValueAt(location, err), 1e-9);
+	}
+}
+
+TEST(DiffusionLayerND, Stencils) {
+	repast::RepastProcess::init("./config.props");
+	int n = repast::RepastProcess::instance()->worldSize();
+
+	compareStencil(StencilDiffusor<double, 2, 1>::moore(0.4, 0.05), true);
+	compareStencil(StencilDiffusor<double, 2, 1>::vonNeumann(0.5), false);
+	compareStencil(StencilDiffusor<double, 3, 1>::laplacian(0.1, 0.01), true);
+	compareStencil(StencilDiffusor<double, 2, 2>::vonNeumann(0.3), true);
+	compareStencil(StencilDiffusor<double, 1, 2>::moore(0.3), false);
+
+	double coefficients[9] = { 0, 0.1, 0, 0.2, 0.4, 0, 0, 0.3, 0 };
+	StencilDiffusor<double, 2, 1> custom(coefficients, 0.5);
+	ASSERT_DOUBLE_EQ(0.2, custom.weight(4));
+	compareStencil(custom, false);
+
+	vector<int> procs(1, n);
+	procs.push_back(1);
+	GridDimensions dims(Point<double>(0, 0), Point<double>(10 * n, 10));
+	DiffusionLayerND<double> layer(procs, dims, 1, true, 0, 0);
+	try {
+		layer.diffuse(StencilDiffusor<double, 2, 2>::moore(0.1));
+		FAIL();
+	} catch (Repast_Error_59& e) {
+	}
+}
+
+
+void compareBlocked(const vector<int>& procs, bool periodic, int bufferSize, int steps) {
+	int width = 15 * procs[0], height = 11 * procs[1];
+	GridDimensions dims(Point<double>(0, 0), Point<double>(width, height));
+	DiffusionLayerND<double> single(procs, dims, bufferSize, periodic, 0, 1.5);
+	DiffusionLayerND<double> blocked(procs, dims, bufferSize, periodic, 0, 1.5);
+	DiffusionLayerND<double> blockedStencil(procs, dims, bufferSize, periodic, 0, 1.5);
+
+	bool err;
+	for (int x = 0; x < width; x++) {
+		for (int y = 0; y < height; y++) {
+			if (!single.isInLocalBounds(Point<int>(x, y))) continue;
+			double value = ((x * height + y) * 7919) % 101;
+			single.setValueAt(value, Point<int>(x, y), err);
+			blocked.setValueAt(value, Point<int>(x, y), err);
+			blockedStencil.setValueAt(value, Point<int>(x, y), err);
+		}
+	}
+	single.synchronize();
+	blocked.synchronize();
+	blockedStencil.synchronize();
+
+	StencilDiffusor<double, 2, 1> stencil = StencilDiffusor<double, 2, 1>::moore(0.4, 0.02);
+	for (int step = 0; step < steps; step++) single.diffuse(&stencil);
+	blocked.diffuseSteps(&stencil, steps);
+	blockedStencil.diffuseSteps(stencil, steps);
+
+	for (int x = 0; x < width; x++) {
+		for (int y = 0; y < height; y++) {
+			if (!single.isInLocalBounds(Point<int>(x, y))) continue;
+			ASSERT_NEAR(single.getValueAt(Point<int>(x, y), err), blocked.getValueAt(Point<int>(x, y), err), 1e-9);
+			ASSERT_NEAR(single.getValueAt(Point<int>(x, y), err), blockedStencil.getValueAt(Point<int>(x, y), err), 1e-9);
+		}
+	}
+}
+
+TEST(DiffusionLayerND, TemporalBlocking) {
+	repast::RepastProcess::init("./config.props");
+	int n = repast::RepastProcess::instance()->worldSize();
+
+	// Slabs, and (with an even number of processes) a grid of blocks whose
+	// shrinking margins cross boundaries in both dimensions
+	vector<int> procs(1, n);
+	procs.push_back(1);
+	compareBlocked(procs, true, 3, 7);
+	compareBlocked(procs, false, 3, 7);
+	compareBlocked(procs, true, 1, 4);
+	compareBlocked(procs, false, 4, 2);
+	if (n % 2 == 0) {
+		vector<int> blocks(1, n / 2);
+		blocks.push_back(2);
+		compareBlocked(blocks, true, 3, 7);
+		compareBlocked(blocks, false, 4, 2);
+	}
+
+	GridDimensions dims(Point<double>(0, 0), Point<double>(10 * n, 10));
+	DiffusionLayerND<double> layer(procs, dims, 1, true, 0, 0);
+	StencilDiffusor<double, 2, 2> wide = StencilDiffusor<double, 2, 2>::moore(0.1);
+	try {
+		layer.diffuseSteps(&wide, 2);
+		FAIL();
+	} catch (Repast_Error_60& e) {
+	}
+}
+
+string readFile(const string& name) {
+	std::ifstream in(name.c_str());
+	std::ostringstream contents;
+	contents << in.rdbuf();
+	return contents.str();
+}
+
+TEST(DiffusionLayerND, ThreadedSweeps) {
+	repast::RepastProcess::init("./config.props");
+	if (repast::RepastProcess::instance()->worldSize() != 1) return;
+
+	vector<int> procs(3, 1);
+	GridDimensions dims(Point<double>(0, 0, 0), Point<double>(37, 30, 41));
+	DiffusionLayerND<double> serial(procs, dims, 1, false, 2, -1);
+	repast::RepastProcess::instance()->useThreads(4);
+	DiffusionLayerND<double> threaded(procs, dims, 1, false, 2, -1);
+
+	bool err;
+	for (int i = 0; i < 37 * 30 * 41; i += 7) {
+		Point<int> location(i % 37, (i / 37) % 30, i / (37 * 30));
+		repast::RepastProcess::instance()->useThreads(1);
+		serial.setValueAt(i % 13, location, err);
+		repast::RepastProcess::instance()->useThreads(4);
+		threaded.setValueAt(i % 13, location, err);
+	}
+
+	StencilDiffusor<double, 3, 1> stencil = StencilDiffusor<double, 3, 1>::moore(0.3, 0.01);
+	for (int step = 0; step < 3; step++) {
+		repast::RepastProcess::instance()->useThreads(1);
+		serial.diffuse(stencil);
+		repast::RepastProcess::instance()->useThreads(4);
+		threaded.diffuse(stencil);
+	}
+	for (int i = 0; i < 37 * 30 * 41; i++) {
+		Point<int> location(i % 37, (i / 37) % 30, i / (37 * 30));
+		ASSERT_EQ(serial.getValueAt(location, err), threaded.getValueAt(location, err));
+	}
+
+	threaded.write("./", "threaded", true);
+	repast::RepastProcess::instance()->useThreads(1);
+	serial.write("./", "serial", true);
+	string written = readFile("./ValueLayer_serial_0.csv");
+	ASSERT_TRUE(written.size() > 1000);
+	ASSERT_EQ(written, readFile("./ValueLayer_threaded_0.csv"));
+
+	repast::RepastProcess::instance()->useThreads(4);
+	threaded.initialize(5.0, -3.0);
+	repast::RepastProcess::instance()->useThreads(1);
+	ASSERT_EQ(5, threaded.getValueAt(Point<int>(36, 29, 40), err));
+	ASSERT_EQ(5, threaded.getSecondaryValueAt(Point<int>(0, 0, 0), err));
+	std::remove("./ValueLayer_serial_0.csv");
+	std::remove("./ValueLayer_threaded_0.csv");
+}
+
+TEST(ValueLayerND, Repartition) {
+	repast::RepastProcess::init("./config.props");
+	int n = repast::RepastProcess::instance()->worldSize();
+	int rank = repast::RepastProcess::instance()->rank();
+
+	vector<int> procs(1, n);
+	procs.push_back(1);
+	GridDimensions dims(Point<double>(0, 0), Point<double>(8 * n, 5));
+	ValueLayerNDSU<double> layer(procs, dims, 2, false, -1, -1);
+	bool err;
+	for (int x = 0; x < 8 * n; x++)
+		for (int y = 0; y < 5; y++)
+			if (layer.isInLocalBounds(Point<int>(x, y))) layer.setValueAt(x * 100 + y, Point<int>(x, y), err);
+	layer.synchronize();
+
+	// More load on the first process moves the boundaries; the values (and buffer zones) move with them
+	CartesianTopology* topology = repast::RepastProcess::instance()->getCartesianTopology(procs, false);
+	ASSERT_EQ(n > 1, topology->rebalance(rank == 0 ? 4 : 1, dims, 2));
+	ASSERT_EQ(n > 1, layer.repartition());
+	GridDimensions local = layer.getLocalBoundaries();
+	ASSERT_TRUE(local == topology->getDimensions(rank, dims));
+	if (n > 1 && rank == 0) {
+		ASSERT_LT(local.extents(0), 8);
+	}
+	for (int x = local.origin(0) - 2; x < local.origin(0) + local.extents(0) + 2; x++)
+		for (int y = 0; y < 5; y++)
+			if (x >= 0 && x < 8 * n) {
+				ASSERT_EQ(x * 100 + y, layer.getValueAt(Point<int>(x, y), err));
+			}
+	// The buffer zones at the (non-periodic) edges of the space keep the value the layer was built with
+	ASSERT_EQ(-1, layer.getValueAt(Point<int>(local.origin(0), 5), err));
+	if (rank == n - 1) {
+		ASSERT_EQ(-1, layer.getValueAt(Point<int>(8 * n, 2), err));
+	}
+
+	// Loads in proportion to the slab widths restore the even division for later tests
+	topology->rebalance(local.extents(0), dims, 2);
+	layer.repartition();
+	ASSERT_EQ(8, layer.getLocalBoundaries().extents(0));
+}
+
+TEST(ValueLayerND, Snapshots) {
+	repast::RepastProcess::init("./config.props");
+	int n = repast::RepastProcess::instance()->worldSize();
+	int rank = repast::RepastProcess::instance()->rank();
+
+	// Written by columns and read by rows, so (with more than one process) every
+	// process reads cells that other processes wrote
+	vector<int> byColumns(1, n);
+	byColumns.push_back(1);
+	vector<int> byRows(1, 1);
+	byRows.push_back(n);
+	GridDimensions dims(Point<double>(-5, 3), Point<double>(6 * n, 5 * n));
+	int xEnd = -5 + 6 * n, yEnd = 3 + 5 * n;
+	ValueLayerND<double> written(byColumns, dims, 2, true, 0, 0);
+	bool err;
+	for (int x = -5; x < xEnd; x++)
+		for (int y = 3; y < yEnd; y++)
+			if (written.isInLocalBounds(Point<int>(x, y))) written.setValueAt(x * 100 + y + 0.5, Point<int>(x, y), err);
+	written.writeSnapshot("./ValueLayer_snapshot.bin");
+
+	ValueLayerNDSU<double> read(byRows, dims, 2, true, -1, -1);
+	read.readSnapshot("./ValueLayer_snapshot.bin");
+	for (int x = -5; x < xEnd; x++)
+		for (int y = 3; y < yEnd; y++)
+			if (read.isInLocalBounds(Point<int>(x, y))) {
+				ASSERT_EQ(x * 100 + y + 0.5, read.getValueAt(Point<int>(x, y), err));
+			}
+	// Buffer zones are synchronized after reading (periodic wrap)
+	if (read.isInLocalBounds(Point<int>(xEnd - 1, 3))) {
+		ASSERT_EQ((xEnd - 1) * 100 + 3 + 0.5, read.getValueAt(Point<int>(-6, 3), err));
+	}
+
+	ValueLayerND<int> otherType(byColumns, dims, 2, true, 0, 0);
+	try {
+		otherType.readSnapshot("./ValueLayer_snapshot.bin");
+		FAIL();
+	} catch (Repast_Error_62& e) {
+	}
+	GridDimensions otherDims(Point<double>(-5, 3), Point<double>(6 * n, 5 * n + 1));
+	ValueLayerND<double> otherBounds(byColumns, otherDims, 2, true, 0, 0);
+	try {
+		otherBounds.readSnapshot("./ValueLayer_snapshot.bin");
+		FAIL();
+	} catch (Repast_Error_62& e) {
+	}
+	try {
+		read.readSnapshot("./ValueLayer_missing.bin");
+		FAIL();
+	} catch (Repast_Error_61& e) {
+	}
+
+	// A snapshot written after rebalancing moved the boundaries reads back into an even division
+	GridDimensions even(Point<double>(0, 0), Point<double>(8 * n, 4 * n));
+	ValueLayerNDSU<double> moved(byColumns, even, 2, false, -1, -1);
+	CartesianTopology* topology = repast::RepastProcess::instance()->getCartesianTopology(byColumns, false);
+	topology->rebalance(rank == 0 ? 4 : 1, even, 2);
+	moved.repartition();
+	if (n > 1 && rank == 0) {
+		ASSERT_LT(moved.getLocalBoundaries().extents(0), 8);
+	}
+	for (int x = 0; x < 8 * n; x++)
+		for (int y = 0; y < 4 * n; y++)
+			if (moved.isInLocalBounds(Point<int>(x, y))) moved.setValueAt(x * 100 + y, Point<int>(x, y), err);
+	moved.writeSnapshot("./ValueLayer_snapshot.bin");
+
+	ValueLayerNDSU<double> evenRows(byRows, even, 2, false, -1, -1);
+	evenRows.readSnapshot("./ValueLayer_snapshot.bin");
+	for (int x = 0; x < 8 * n; x++)
+		for (int y = 0; y < 4 * n; y++)
+			if (evenRows.isInLocalBounds(Point<int>(x, y))) {
+				ASSERT_EQ(x * 100 + y, evenRows.getValueAt(Point<int>(x, y), err));
+			}
+
+	// Loads in proportion to the slab widths restore the even division for later tests
+	topology->rebalance(moved.getLocalBoundaries().extents(0), even, 2);
+	moved.repartition();
+	ASSERT_EQ(8, moved.getLocalBoundaries().extents(0));
+	if (rank == 0) std::remove("./ValueLayer_snapshot.bin");
+}
@@ -38,10 +38,12 @@
 #include "repast_hpc/RepastProcess.h"
 #include "repast_hpc/SVDataSetBuilder.h"
 #include "repast_hpc/TDataSource.h"
+#include "repast_hpc/SRManager.h"
 #include "model.h"
 
 #include <set>
 #include <vector>
+#include <boost/random/mersenne_twister.hpp>
 
 namespace mpi = boost::mpi;
 using namespace std;
@@ -634,6 +636,32 @@ TEST(DataSet, WriteRecord)
 	delete RepastProcess::instance();
 }
 
+// The sparse exchange must find the same sources as the all-to-all exchange
+void compareSparseSources(mpi::communicator* comm, boost::mt19937& gen) {
+	vector<int> targets;
+	for (int r = 0; r < comm->size(); r++)
+		if (gen() % 3 == 0) targets.push_back(r);
+	vector<int> sparse, dense;
+	SRManager::retrieveSourcesSparse(comm, targets, sparse);
+	SRManager manager(comm);
+	manager.retrieveSources(targets, dense);
+	ASSERT_EQ(dense, sparse);
+}
+
+TEST(SRManager, SparseSources)
+{
+	mpi::communicator world;
+	boost::mt19937 gen(world.rank() + 1);
+
+	// The two halves of the world make different numbers of exchanges on
+	// their own communicators before all of them make exchanges on the world
+	mpi::communicator half = world.split(world.rank() % 2);
+	for (int round = 0; round < 3 + world.rank() % 2; round++)
+		compareSparseSources(&half, gen);
+	for (int round = 0; round < 4; round++)
+		compareSparseSources(&world, gen);
+}
+
 void testAgentRequestState(AgentRequest request, int expectedRequestsCount, int expectedCancellationsCount,
 						   AgentId* requestsContains, AgentId* requestsDoesNotContain, AgentId* cancellationsContains,
 						   AgentId* cancellationsDoesNotContain, AgentId* neitherContains, int expectedTargetSize, int expectedRequestsTargetSize,